@@ -0,0 +1,224 @@
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <atomic>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "AnalysisCache.hpp"
+
+const char ANALYSIS_CACHE_MAGIC[8] = {'C','H','E','N','G','A','C','\x1A'};
+const uint32_t ANALYSIS_CACHE_VERSION = 1;
+
+struct AnalysisCacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t entryBytes;
+    uint64_t buckets;
+    unsigned char reserved[40];
+};
+
+static_assert(sizeof(AnalysisCacheHeader) == 64, "the header is 64 bytes in the file");
+
+// data layout: score (float bits) 0-31, depth 32-39, bound 40-41, move 42-53 (x1, y1, x2, y2, 3 bits each)
+static uint64_t pack(const AnalysisEntry &_entry)
+{
+    uint32_t scoreBits;
+    std::memcpy(&scoreBits, &_entry.score, sizeof(scoreBits));
+    uint64_t move = (uint64_t)(_entry.move.x1 & 7) | ((uint64_t)(_entry.move.y1 & 7) << 3) | ((uint64_t)(_entry.move.x2 & 7) << 6) | ((uint64_t)(_entry.move.y2 & 7) << 9);
+    return (uint64_t)scoreBits | ((uint64_t)(_entry.depth & 0xFF) << 32) | ((uint64_t)_entry.bound << 40) | (move << 42);
+}
+
+static void unpack(uint64_t _data, AnalysisEntry &_entry)
+{
+    uint32_t scoreBits = (uint32_t)_data;
+    std::memcpy(&_entry.score, &scoreBits, sizeof(scoreBits));
+    _entry.depth = (int)((_data >> 32) & 0xFF);
+    _entry.bound = (TTBound)((_data >> 40) & 3);
+    _entry.move = Move{(std::int8_t)((_data >> 42) & 7), (std::int8_t)((_data >> 45) & 7), (std::int8_t)((_data >> 48) & 7), (std::int8_t)((_data >> 51) & 7)};
+}
+
+// bytes of a file with _buckets buckets
+static size_t fileBytes(uint64_t _buckets)
+{
+    return sizeof(AnalysisCacheHeader) + (size_t)_buckets*ANALYSIS_CACHE_BUCKET*2*sizeof(uint64_t);
+}
+
+// a file that was being created when the process died, its size is right but the header never got written
+static bool unfinished(const unsigned char* _header, size_t _bytes)
+{
+    for (size_t i = 0; i < sizeof(AnalysisCacheHeader); i++) { if (_header[i] != 0) { return false; } }
+    size_t buckets = (_bytes - sizeof(AnalysisCacheHeader)) / (ANALYSIS_CACHE_BUCKET*2*sizeof(uint64_t));
+    return buckets > 0 && (buckets & (buckets-1)) == 0 && fileBytes(buckets) == _bytes;
+}
+
+AnalysisCache::AnalysisCache()
+{
+    view = nullptr;
+    bytes = 0;
+    table = nullptr;
+    buckets = 0;
+#ifdef _WIN32
+    fileHandle = nullptr;
+    mappingHandle = nullptr;
+#endif
+}
+
+AnalysisCache::~AnalysisCache()
+{
+    close();
+}
+
+bool AnalysisCache::open(const std::string &_path, long _megabytes)
+{
+    close();
+    
+    uint64_t wanted = (uint64_t)(_megabytes > 0 ? _megabytes : 1)*1024*1024 / (ANALYSIS_CACHE_BUCKET*sizeof(Entry));
+    uint64_t newBuckets = 1;
+    while (newBuckets*2 <= wanted) { newBuckets *= 2; }
+    
+    // a new file (or an unfinished one) is sized here and gets its header once it's mapped
+    unsigned char header[sizeof(AnalysisCacheHeader)] = {};
+    bool fresh;
+#ifdef _WIN32
+    HANDLE file = CreateFileA(_path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) { return false; }
+    LARGE_INTEGER fileSize;
+    DWORD read = 0;
+    if (!GetFileSizeEx(file, &fileSize) || (fileSize.QuadPart > 0 && fileSize.QuadPart < (LONGLONG)sizeof(header))) { CloseHandle(file); return false; }
+    if (fileSize.QuadPart > 0 && (!ReadFile(file, header, sizeof(header), &read, nullptr) || read != sizeof(header))) { CloseHandle(file); return false; }
+    fresh = (fileSize.QuadPart == 0 || unfinished(header, (size_t)fileSize.QuadPart));
+    if (fresh)
+    {
+        fileSize.QuadPart = (LONGLONG)fileBytes(newBuckets);
+        if (!SetFilePointerEx(file, fileSize, nullptr, FILE_BEGIN) || !SetEndOfFile(file)) { CloseHandle(file); return false; }
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+    if (mapping == nullptr) { CloseHandle(file); return false; }
+    void* mapped = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    if (mapped == nullptr) { CloseHandle(mapping); CloseHandle(file); return false; }
+    fileHandle = file;
+    mappingHandle = mapping;
+    bytes = (size_t)fileSize.QuadPart;
+#else
+    int fd = ::open(_path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) { return false; }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (st.st_size > 0 && st.st_size < (off_t)sizeof(header))) { ::close(fd); return false; }
+    if (st.st_size > 0 && pread(fd, header, sizeof(header), 0) != (ssize_t)sizeof(header)) { ::close(fd); return false; }
+    fresh = (st.st_size == 0 || unfinished(header, (size_t)st.st_size));
+    if (fresh)
+    {
+        st.st_size = (off_t)fileBytes(newBuckets);
+        if (ftruncate(fd, st.st_size) != 0) { ::close(fd); return false; } // NOTE zero filled, i.e. every entry empty
+    }
+    void* mapped = mmap(nullptr, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd); // NOTE the mapping stays valid after the descriptor is closed
+    if (mapped == MAP_FAILED) { return false; }
+    bytes = (size_t)st.st_size;
+#endif
+    
+    view = (unsigned char*)mapped;
+    AnalysisCacheHeader* fileHeader = (AnalysisCacheHeader*)view;
+    if (fresh)
+    {
+        fileHeader->version = ANALYSIS_CACHE_VERSION;
+        fileHeader->entryBytes = (uint32_t)sizeof(Entry);
+        fileHeader->buckets = newBuckets;
+        std::memcpy(fileHeader->magic, ANALYSIS_CACHE_MAGIC, sizeof(ANALYSIS_CACHE_MAGIC)); // NOTE last, a header without its magic is still unfinished
+    }
+    else if (std::memcmp(fileHeader->magic, ANALYSIS_CACHE_MAGIC, sizeof(ANALYSIS_CACHE_MAGIC)) != 0 || fileHeader->version != ANALYSIS_CACHE_VERSION
+             || fileHeader->entryBytes != sizeof(Entry) || fileHeader->buckets == 0 || (fileHeader->buckets & (fileHeader->buckets-1)) != 0 || fileBytes(fileHeader->buckets) != bytes)
+    {
+        close();
+        return false;
+    }
+    
+    table = (Entry*)(view + sizeof(AnalysisCacheHeader));
+    buckets = (long)fileHeader->buckets;
+    return true;
+}
+
+void AnalysisCache::close()
+{
+    if (view == nullptr) { return; }
+#ifdef _WIN32
+    FlushViewOfFile(view, 0);
+    FlushFileBuffers((HANDLE)fileHandle);
+    UnmapViewOfFile(view);
+    CloseHandle((HANDLE)mappingHandle);
+    CloseHandle((HANDLE)fileHandle);
+    fileHandle = nullptr;
+    mappingHandle = nullptr;
+#else
+    msync(view, bytes, MS_SYNC);
+    munmap(view, bytes);
+#endif
+    view = nullptr;
+    bytes = 0;
+    table = nullptr;
+    buckets = 0;
+}
+
+bool AnalysisCache::isOpen() const
+{
+    return view != nullptr;
+}
+
+bool AnalysisCache::probe(uint64_t _key, AnalysisEntry &_entry) const
+{
+    if (table == nullptr) { return false; }
+    Entry* bucket = &table[(_key & (uint64_t)(buckets-1)) * ANALYSIS_CACHE_BUCKET];
+    for (int i = 0; i < ANALYSIS_CACHE_BUCKET; i++)
+    {
+        uint64_t data = bucket[i].data.load(std::memory_order_relaxed);
+        if (data == 0 || (bucket[i].check.load(std::memory_order_relaxed) ^ data) != _key) { continue; }
+        unpack(data, _entry);
+        return true;
+    }
+    return false;
+}
+
+void AnalysisCache::store(uint64_t _key, const AnalysisEntry &_entry)
+{
+    if (table == nullptr) { return; }
+    Entry* bucket = &table[(_key & (uint64_t)(buckets-1)) * ANALYSIS_CACHE_BUCKET];
+    
+    // the same position, then an empty entry, then the shallowest
+    Entry* victim = nullptr;
+    int victimDepth = 0;
+    for (int i = 0; i < ANALYSIS_CACHE_BUCKET; i++)
+    {
+        uint64_t data = bucket[i].data.load(std::memory_order_relaxed);
+        int depth = (data == 0 ? -1 : (int)((data >> 32) & 0xFF));
+        if (data != 0 && (bucket[i].check.load(std::memory_order_relaxed) ^ data) == _key)
+        {
+            if (depth > _entry.depth) { return; }
+            victim = &bucket[i];
+            break;
+        }
+        if (victim == nullptr || depth < victimDepth)
+        {
+            victim = &bucket[i];
+            victimDepth = depth;
+        }
+    }
+    
+    uint64_t data = pack(_entry);
+    victim->data.store(data, std::memory_order_relaxed);
+    victim->check.store(_key ^ data, std::memory_order_relaxed);
+}
+
+long AnalysisCache::size() const
+{
+    return buckets*ANALYSIS_CACHE_BUCKET;
+}
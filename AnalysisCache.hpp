@@ -0,0 +1,74 @@
+#ifndef ANALYSISCACHE_HPP
+#define ANALYSISCACHE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <atomic>
+
+#include "Search.hpp"
+#include "TranspositionTable.hpp"
+
+/* Analysis cache, the depth-first search's root results kept in a file from one run to the next
+ *
+ * The file is a 64 byte header followed by buckets of ANALYSIS_CACHE_BUCKET entries, memory-mapped so a result is in the file the moment it's stored and
+ * nothing has to be loaded or saved. Its size is fixed when it's created and never grows, a full bucket gives up its shallowest entry.
+ *
+ * Crash safety: every entry is two 64-bit words, the key stored XORed with the data like in TranspositionTable, so an entry that was only half written
+ * when the process (or the machine) went down no longer matches its key and is a miss. The header is checked on open and a file that isn't a cache is never
+ * written to. Any number of threads, and processes, can share one file.
+ *
+ * NOTE entries are keyed by GameState::positionKey and don't know the SearchOptions or evaluation that found them, use one file per setup
+*/
+
+const long ANALYSIS_CACHE_DEFAULT_MB = 16;
+const int ANALYSIS_CACHE_BUCKET = 4;
+
+struct AnalysisEntry
+{
+    int depth;
+    float score; // white-relative, mates counted from the position
+    TTBound bound;
+    Move move; // best move
+};
+
+class AnalysisCache
+{
+public:
+    AnalysisCache();
+    
+    ~AnalysisCache();
+    
+    AnalysisCache(const AnalysisCache&) = delete; // NOTE owns the mapping, a copy would unmap it a second time
+    AnalysisCache& operator=(const AnalysisCache&) = delete;
+    
+    bool open(const std::string &_path, long _megabytes); // maps the file, creating it with _megabytes (rounded down to a power of two buckets) if it doesn't exist, returns false if it can't be opened or isn't a cache
+    
+    void close(); // flushes and unmaps
+    
+    bool isOpen() const;
+    
+    bool probe(uint64_t _key, AnalysisEntry &_entry) const;
+    
+    void store(uint64_t _key, const AnalysisEntry &_entry); // NOTE a shallower result never replaces a deeper one of the same position
+    
+    long size() const; // entries
+
+private:
+    struct Entry
+    {
+        std::atomic<uint64_t> check; // key ^ data
+        std::atomic<uint64_t> data;
+    };
+    
+    unsigned char* view; // the whole file
+    size_t bytes;
+    Entry* table;
+    long buckets;
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#endif
+};
+
+#endif
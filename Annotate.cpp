@@ -0,0 +1,406 @@
+#include <string>
+#include <vector>
+#include <map>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+#include "Annotate.hpp"
+#include "StateTree.hpp"
+#include "Notation.hpp"
+
+// ---------- PGN ----------
+
+std::string PgnGame::tag(const std::string &_name) const
+{
+    for (const auto &tag : tags)
+    {
+        if (tag.first == _name) { return tag.second; }
+    }
+    return "";
+}
+
+// [Name "Value"], with \" and \\ inside the value
+static bool parseTag(const std::string &_line, std::string &_name, std::string &_value)
+{
+    size_t open = _line.find('"');
+    size_t close = _line.rfind('"');
+    if (_line.size() < 2 || _line[0] != '[' || open == std::string::npos || close == open) { return false; }
+    
+    std::istringstream name(_line.substr(1, open-1));
+    if (!(name >> _name)) { return false; }
+    _value.clear();
+    for (size_t i = open+1; i < close; i++)
+    {
+        if (_line[i] == '\\' && i+1 < close) { i++; }
+        _value += _line[i];
+    }
+    return true;
+}
+
+PgnReader::PgnReader(std::istream &_in) : in(_in)
+{
+    lineNumber = 0;
+}
+
+bool PgnReader::next(PgnGame &_game)
+{
+    _game.tags.clear();
+    _game.moves.clear();
+    _game.result = "*";
+    _game.line = 0;
+    bool started = false;
+    bool inComment = false;
+    int variationDepth = 0;
+    
+    std::string line;
+    while (true)
+    {
+        if (!pendingTag.empty())
+        {
+            line = pendingTag; // NOTE lineNumber is still that of this line
+            pendingTag.clear();
+        }
+        else if (std::getline(in, line)) { lineNumber++; }
+        else { break; }
+        if (!line.empty() && line.back() == '\r') { line.pop_back(); }
+        if (!inComment && !line.empty() && line[0] == '%') { continue; }
+        
+        size_t first = line.find_first_not_of(" \t");
+        if (!inComment && variationDepth == 0 && first != std::string::npos && line[first] == '[')
+        {
+            if (!_game.moves.empty())
+            {
+                pendingTag = line; // NOTE the game had no termination marker
+                return true;
+            }
+            std::string name, value;
+            if (parseTag(line.substr(first), name, value)) { _game.tags.push_back(std::make_pair(name, value)); }
+            if (!started) { _game.line = lineNumber; }
+            started = true;
+            continue;
+        }
+        
+        // movetext, a token ends at whitespace, a '.' or the start of a comment or variation
+        std::string token;
+        for (size_t i = 0; i <= line.size(); i++)
+        {
+            char c = (i < line.size() ? line[i] : ' ');
+            if (inComment)
+            {
+                if (c == '}') { inComment = false; }
+                continue;
+            }
+            if (c != '{' && c != ';' && c != '(' && c != ')' && c != ' ' && c != '\t' && c != '.')
+            {
+                token += c;
+                continue;
+            }
+            
+            if (!token.empty() && variationDepth == 0)
+            {
+                if (!started) { _game.line = lineNumber; }
+                started = true;
+                if (token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*")
+                {
+                    _game.result = token; // NOTE anything after the marker on the same line is dropped
+                    return true;
+                }
+                bool moveNumber = (token.find_first_not_of("0123456789") == std::string::npos);
+                if (!moveNumber && token[0] != '$')
+                {
+                    while (!token.empty() && (token.back() == '!' || token.back() == '?')) { token.pop_back(); }
+                    if (!token.empty()) { _game.moves.push_back(token); }
+                }
+            }
+            token.clear();
+            
+            if (c == '{') { inComment = true; }
+            else if (c == ';') { break; }
+            else if (c == '(') { variationDepth++; }
+            else if (c == ')' && variationDepth > 0) { variationDepth--; }
+        }
+    }
+    return started;
+}
+
+// ---------- ANNOTATION ----------
+
+struct Analysis
+{
+    float evaluation; // white's view
+    Move best; // x1 is -1 when there are no legal moves
+    std::string bestSan;
+};
+
+struct MoveNote
+{
+    float evaluation; // of the position after the move
+    float loss; // pawns, for the mover
+    std::string best; // SAN of the engine's choice when the move lost something
+};
+
+struct GameTotals
+{
+    long positions;
+    int inaccuracies;
+    int mistakes;
+    int blunders;
+    bool illegal;
+    int plies; // annotated, the illegal move comes right after them
+};
+
+// searches the current state of _st the way the options say
+static Analysis analyse(StateTree &_st, const AnnotateOptions &_options)
+{
+    GameState* root = _st.pastStates.back().get();
+    Analysis analysis;
+    analysis.best = Move{-1, -1, -1, -1};
+    
+    _st.genToDepth(1);
+    if (_st.legalMoveCount(root) == 0)
+    {
+        bool mated = kingAttacked(root, root->whiteTurn);
+        analysis.evaluation = (mated ? (root->whiteTurn ? -MATE_EVALUATION : MATE_EVALUATION) : 0);
+        return analysis;
+    }
+    
+    int bestIndex;
+    if (_options.search.mcts) { bestIndex = _st.searchMcts(_options.search.mctsPlayouts, 0); }
+    else if (_options.search.depthFirst) { bestIndex = _st.searchDepthFirst(_options.depth); }
+    else
+    {
+        _st.genToDepth(_options.depth); // NOTE the tree under the move played last time is kept, so only its last level is new
+        _st.minimaxEval(root);
+        bestIndex = _st.bestChildIndex(root);
+    }
+    analysis.evaluation = root->evaluation;
+    if (bestIndex != -1)
+    {
+        GameState* child = root->nextLevel[bestIndex].get();
+        analysis.best = Move{child->fromX, child->fromY, child->toX, child->toY};
+        analysis.bestSan = sanMove(_st, root, bestIndex);
+    }
+    return analysis;
+}
+
+// "[%eval 0.35]" or "[%eval #-2]" for a king captured within the search, empty for checkmate on the board
+static std::string evalComment(float _evaluation)
+{
+    std::ostringstream comment;
+    if (std::fabs(_evaluation) > MATE_EVALUATION/2)
+    {
+        int plies = (int)std::lround(MATE_EVALUATION - std::fabs(_evaluation)); // to the king's capture
+        if (plies == 0) { return ""; }
+        if (plies > 0 && plies <= MAX_SEARCH_PLY)
+        {
+            comment << "[%eval #" << (_evaluation < 0 ? "-" : "") << plies/2 << "]";
+            return comment.str();
+        }
+        _evaluation = (_evaluation < 0 ? -ANNOTATE_EVAL_CAP : ANNOTATE_EVAL_CAP); // NOTE the tree search scores a lost king like a piece, no distance
+    }
+    comment << "[%eval " << std::fixed << std::setprecision(2) << _evaluation << "]";
+    return comment.str();
+}
+
+static std::string tagEscape(const std::string &_value)
+{
+    std::string escaped;
+    for (char c : _value)
+    {
+        if (c == '"' || c == '\\') { escaped += '\\'; }
+        escaped += c;
+    }
+    return escaped;
+}
+
+static std::string annotator(const AnnotateOptions &_options)
+{
+    std::string evaluator = (_options.nnue != nullptr ? " nnue" : "");
+    if (_options.search.mcts) { return "chengine " + std::to_string(_options.search.mctsPlayouts) + " playouts " + describeSearch(_options.search) + evaluator; }
+    return "chengine depth " + std::to_string(_options.depth) + " " + describeSearch(_options.search) + evaluator;
+}
+
+static std::string annotateGame(const PgnGame &_game, const AnnotateOptions &_options, GameTotals &_totals)
+{
+    _totals = GameTotals{0, 0, 0, 0, false, 0};
+    std::string fen = _game.tag("FEN");
+    if (fen.empty()) { fen = START_FEN; }
+    
+    StateTree st;
+    std::vector<MoveNote> notes;
+    if (st.loadFEN(fen))
+    {
+        st.setNodeBudget(_options.nodeLimit);
+        st.searchOptions = _options.search;
+        st.nnue = _options.nnue;
+        st.analysisCache = _options.analysisCache;
+        
+        bool treeSearch = (!_options.search.mcts && !_options.search.depthFirst);
+        Analysis before = analyse(st, _options);
+        _totals.positions++;
+        for (const std::string &san : _game.moves)
+        {
+            GameState* current = st.pastStates.back().get();
+            Move move;
+            if (!parseSanMove(current, san, move)) { break; }
+            int index = st.findChild(current, move.x1, move.y1, move.x2, move.y2);
+            if (index == -1) { break; } // NOTE only if the node budget kept analyse() from generating
+            float played = current->nextLevel[index]->evaluation;
+            st.pushState(index);
+            
+            Analysis after = analyse(st, _options);
+            _totals.positions++;
+            
+            // NOTE the tree search scores every root move exactly, comparing with the same tree keeps the odd and even depth horizons from telling apart
+            float evaluation = (treeSearch ? played : after.evaluation);
+            auto cap = [](float _evaluation) { return std::min(std::max(_evaluation, -ANNOTATE_EVAL_CAP), ANNOTATE_EVAL_CAP); };
+            float loss = (current->whiteTurn ? cap(before.evaluation) - cap(evaluation) : cap(evaluation) - cap(before.evaluation));
+            bool engineMove = (move.x1 == before.best.x1 && move.y1 == before.best.y1 && move.x2 == before.best.x2 && move.y2 == before.best.y2);
+            if (engineMove) { loss = 0; } // NOTE a deeper look at the next position can score the engine's own choice lower, that's not the mover's fault
+            notes.push_back(MoveNote{evaluation, loss, before.bestSan});
+            before = after;
+        }
+    }
+    _totals.illegal = (notes.size() < _game.moves.size());
+    _totals.plies = (int)notes.size();
+    
+    std::ostringstream pgn;
+    for (const auto &tag : _game.tags)
+    {
+        if (tag.first != "Annotator") { pgn << "[" << tag.first << " \"" << tagEscape(tag.second) << "\"]\n"; }
+    }
+    pgn << "[Annotator \"" << tagEscape(annotator(_options)) << "\"]\n\n";
+    
+    // movetext, wrapped before 80 columns
+    GameState start(nullptr);
+    if (!parseFEN(fen, &start)) { parseFEN(START_FEN, &start); }
+    bool whiteTurn = start.whiteTurn;
+    int moveNumber = start.fullmoveNumber;
+    std::string line;
+    auto append = [&](const std::string &_token)
+    {
+        if (!line.empty() && line.size() + 1 + _token.size() > 79) { pgn << line << '\n'; line.clear(); }
+        line += (line.empty() ? "" : " ") + _token;
+    };
+    for (int i = 0; i < (int)_game.moves.size(); i++)
+    {
+        if (whiteTurn) { append(std::to_string(moveNumber) + "."); }
+        else if (i == 0) { append(std::to_string(moveNumber) + "..."); }
+        
+        if (i < (int)notes.size())
+        {
+            const MoveNote &note = notes[i];
+            std::string mark;
+            std::string verdict;
+            if (note.loss >= _options.blunder) { mark = "??"; verdict = "Blunder"; _totals.blunders++; }
+            else if (note.loss >= ANNOTATE_MISTAKE_SHARE*_options.blunder) { mark = "?"; verdict = "Mistake"; _totals.mistakes++; }
+            else if (note.loss >= ANNOTATE_INACCURACY_SHARE*_options.blunder) { mark = "?!"; verdict = "Inaccuracy"; _totals.inaccuracies++; }
+            append(_game.moves[i] + mark);
+            
+            std::string comment = evalComment(note.evaluation);
+            if (!verdict.empty() && !note.best.empty()) { comment += (comment.empty() ? "" : " ") + verdict + ". " + note.best + " was best."; }
+            if (!comment.empty()) { append("{" + comment + "}"); }
+        }
+        else
+        {
+            append(_game.moves[i]);
+            if (i == (int)notes.size()) { append("{illegal move, not annotated from here}"); }
+        }
+        if (!whiteTurn) { moveNumber++; }
+        whiteTurn = !whiteTurn;
+    }
+    append(_game.result);
+    pgn << line << "\n\n";
+    return pgn.str();
+}
+
+long runAnnotate(const AnnotateOptions &_options)
+{
+    std::ifstream input(_options.inputPath);
+    if (!input)
+    {
+        std::cerr << "Couldn't open " << _options.inputPath << '\n';
+        return -1;
+    }
+    std::ofstream file;
+    if (!_options.outputPath.empty())
+    {
+        file.open(_options.outputPath);
+        if (!file)
+        {
+            std::cerr << "Couldn't open " << _options.outputPath << '\n';
+            return -1;
+        }
+    }
+    std::ostream &out = (_options.outputPath.empty() ? std::cout : file);
+    
+    PgnReader reader(input);
+    std::mutex readMutex;
+    long nextIndex = 0;
+    
+    // finished games wait in pending until every game before them is written
+    std::mutex writeMutex;
+    std::condition_variable written;
+    std::map<long, std::string> pending;
+    long nextToWrite = 0;
+    long positions = 0;
+    long illegal = 0;
+    long inaccuracies = 0, mistakes = 0, blunders = 0;
+    
+    auto start = std::chrono::steady_clock::now();
+    
+    auto worker = [&]()
+    {
+        while (true)
+        {
+            PgnGame game;
+            long index;
+            {
+                std::lock_guard<std::mutex> lock(readMutex);
+                if (!reader.next(game)) { return; }
+                index = nextIndex++;
+            }
+            
+            GameTotals totals;
+            std::string annotated = annotateGame(game, _options, totals);
+            if (totals.illegal) { std::cerr << "Game " << index+1 << " (line " << game.line << ") has an illegal move after " << totals.plies << " plies\n"; }
+            
+            std::unique_lock<std::mutex> lock(writeMutex);
+            written.wait(lock, [&]() { return index < nextToWrite + ANNOTATE_MAX_PENDING; }); // NOTE keeps memory flat when one game takes much longer than the rest
+            pending[index] = std::move(annotated);
+            while (!pending.empty() && pending.begin()->first == nextToWrite)
+            {
+                out << pending.begin()->second;
+                pending.erase(pending.begin());
+                nextToWrite++;
+            }
+            positions += totals.positions;
+            illegal += (totals.illegal ? 1 : 0);
+            inaccuracies += totals.inaccuracies;
+            mistakes += totals.mistakes;
+            blunders += totals.blunders;
+            written.notify_all();
+        }
+    };
+    
+    int threads = (_options.threads > 0 ? _options.threads : 1);
+    std::vector<std::thread> pool;
+    for (int i = 0; i < threads; i++) { pool.emplace_back(worker); }
+    for (std::thread &thread : pool) { thread.join(); }
+    out << std::flush;
+    
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (seconds <= 0) { seconds = 1e-9; }
+    std::cerr << nextToWrite << " games (" << illegal << " with illegal moves), " << positions << " positions on " << threads << " threads in " << seconds << " s, "
+              << nextToWrite*60/seconds << " games/minute, " << positions/seconds << " positions/s\n";
+    std::cerr << blunders << " blunders, " << mistakes << " mistakes, " << inaccuracies << " inaccuracies\n";
+    return nextToWrite;
+}
@@ -0,0 +1,76 @@
+#ifndef ANNOTATE_HPP
+#define ANNOTATE_HPP
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <istream>
+
+#include "Search.hpp"
+
+class NnueNetwork;
+class AnalysisCache;
+
+// ---------- PGN ----------
+
+struct PgnGame
+{
+    std::vector<std::pair<std::string, std::string>> tags; // in the order of the file
+    std::vector<std::string> moves; // SAN of the main line, variations, comments, NAGs and "!?" left out
+    std::string result; // the termination marker, "*" if the file ended without one
+    long line; // where the game starts in the file
+    
+    std::string tag(const std::string &_name) const; // empty if there is no such tag
+};
+
+/* Reads the games of a PGN file one at a time
+ *
+ * Only the game being read is held, so files of any size stream through a buffered std::istream. A game ends at its termination marker (1-0, 0-1,
+ * 1/2-1/2, *), or at the next tag pair if the marker is missing. Comments ("{...}" and ";" to the end of the line), variations ("(...)", nested) and
+ * "%" escape lines are skipped.
+*/
+class PgnReader
+{
+public:
+    PgnReader(std::istream &_in);
+    
+    bool next(PgnGame &_game); // false once there are no more games
+
+private:
+    std::istream &in;
+    long lineNumber;
+    std::string pendingTag; // a tag line read past the end of a game without a marker, it belongs to the next one
+};
+
+// ---------- ANNOTATION ----------
+
+const float ANNOTATE_BLUNDER_DEFAULT = 2; // pawns lost against the best move
+const float ANNOTATE_MISTAKE_SHARE = 0.5; // of the blunder threshold, "?"
+const float ANNOTATE_INACCURACY_SHARE = 0.25; // "?!"
+const float ANNOTATE_EVAL_CAP = 10; // pawns, evaluations (mates included) are capped here before losses are taken so a won position stays won
+const int ANNOTATE_MAX_PENDING = 64; // finished games a worker may get ahead of the output by before it waits
+
+struct AnnotateOptions
+{
+    std::string inputPath; // PGN file
+    std::string outputPath; // empty means stdout
+    int depth; // levels to generate (plies to search with a depth-first search) per position
+    int threads; // games annotated at the same time, each with its own StateTree
+    long nodeLimit; // node budget per tree, 0 means unlimited
+    SearchOptions search; // NOTE search.depth is ignored in favour of depth
+    const NnueNetwork* nnue; // nullptr evaluates with StateTree::evaluate()
+    AnalysisCache* analysisCache; // nullptr searches every position, see StateTree::analysisCache
+    float blunder; // pawns, see ANNOTATE_*_SHARE for the smaller marks
+};
+
+/* Searches every position of every game of a PGN file and writes the games back annotated
+ *
+ * Each move gets a "[%eval]" comment (white's view, in pawns, "#n" for mates the search saw) and a move that loses at least an inaccuracy's worth
+ * against the best move is marked "?!", "?" or "??" with the engine's choice in the comment. The loss is the evaluation of the position before the move
+ * less that of the position after it, both searched to the same depth, from the mover's side. Games are read as the workers need them and written in
+ * the order of the input, a game with an illegal move is annotated up to it and passed through from there.
+ * Prints the totals and games per minute to std::cerr. Returns the number of games annotated, -1 if a file couldn't be opened
+*/
+long runAnnotate(const AnnotateOptions &_options);
+
+#endif
@@ -0,0 +1,158 @@
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <chrono>
+
+#include "Batch.hpp"
+#include "StateTree.hpp"
+#include "Notation.hpp"
+
+static std::string jsonEscape(const std::string &_text)
+{
+    std::string escaped;
+    for (char c : _text)
+    {
+        if (c == '"' || c == '\\') { escaped += '\\'; }
+        escaped += c;
+    }
+    return escaped;
+}
+
+static std::string csvEscape(const std::string &_text)
+{
+    if (_text.find_first_of(",\"") == std::string::npos) { return _text; }
+    std::string escaped = "\"";
+    for (char c : _text)
+    {
+        if (c == '"') { escaped += '"'; }
+        escaped += c;
+    }
+    return escaped + '"';
+}
+
+long runBatch(const BatchOptions &_options)
+{
+    std::ifstream input(_options.inputPath);
+    if (!input)
+    {
+        std::cerr << "Couldn't open " << _options.inputPath << '\n';
+        return -1;
+    }
+    std::ofstream file;
+    if (!_options.outputPath.empty())
+    {
+        file.open(_options.outputPath);
+        if (!file)
+        {
+            std::cerr << "Couldn't open " << _options.outputPath << '\n';
+            return -1;
+        }
+    }
+    std::ostream &out = (_options.outputPath.empty() ? std::cout : file);
+    
+    bool multiPV = (_options.search.multiPV > 1 && !_options.search.mcts);
+    if (_options.format == BatchFormat::CSV) { out << "id,fen,bestmove,evaluation,depth,nodes,ms,pv" << (multiPV ? ",lines" : "") << '\n'; }
+    
+    long positions = 0;
+    long skipped = 0;
+    long totalNodes = 0;
+    auto batchStart = std::chrono::steady_clock::now();
+    
+    std::string line;
+    long lineNumber = 0;
+    while (std::getline(input, line))
+    {
+        lineNumber++;
+        if (line.empty() || line[0] == '#' || line.find_first_not_of(" \t\r") == std::string::npos) { continue; }
+        
+        GameState position(nullptr);
+        std::string id;
+        if (!parseEPD(line, &position, id))
+        {
+            std::cerr << "Skipping malformed line " << lineNumber << '\n';
+            skipped++;
+            continue;
+        }
+        if (id.empty()) { id = std::to_string(lineNumber); }
+        std::string fen = toFEN(&position);
+        
+        auto start = std::chrono::steady_clock::now();
+        
+        StateTree st;
+        st.loadFEN(fen);
+        st.setNodeBudget(_options.nodeLimit);
+        st.trace = _options.trace;
+        st.searchOptions = _options.search;
+        st.nnue = _options.nnue;
+        st.analysisCache = _options.analysisCache;
+        
+        GameState* root = st.pastStates.back().get();
+        int bestMoveIndex;
+        int depth;
+        long nodes;
+        if (_options.search.mcts)
+        {
+            bestMoveIndex = st.searchMcts(_options.search.mctsPlayouts, 0);
+            depth = (int)st.principalVariation.size();
+            nodes = st.mctsPlayouts;
+        }
+        else if (_options.search.depthFirst)
+        {
+            bestMoveIndex = st.searchDepthFirst(_options.depth);
+            depth = (st.iterations.empty() ? 0 : st.iterations.back().depth);
+            nodes = st.searchNodes;
+        }
+        else
+        {
+            for (int level = 0; level < _options.depth; level++)
+            {
+                st.genLevel();
+                if (st.budgetReached) { break; }
+            }
+            st.minimaxEval(root);
+            bestMoveIndex = st.bestChildIndex(root);
+            depth = st.subtreeDepth(root);
+            nodes = st.liveNodes;
+        }
+        st.traceSearch(root, bestMoveIndex);
+        std::string bestMove = "none";
+        int x1, y1, x2, y2;
+        if (bestMoveIndex != -1 && st.childMove(root, root->nextLevel[bestMoveIndex].get(), x1, y1, x2, y2)) { bestMove = uciMove(x1, y1, x2, y2); }
+        
+        long ms = (long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        
+        if (_options.format == BatchFormat::CSV)
+        {
+            out << csvEscape(id) << ',' << fen << ',' << bestMove << ',' << root->evaluation << ',' << depth << ',' << nodes << ',' << ms << ',' << uciLine(st.principalVariation);
+            if (multiPV)
+            {
+                // "evaluation line" per line, best first, separated by semicolons
+                out << ',';
+                for (int i = 0; i < (int)st.multiPVLines.size(); i++) { out << (i > 0 ? ";" : "") << st.multiPVLines[i].evaluation << ' ' << uciLine(st.multiPVLines[i].pv); }
+            }
+            out << '\n';
+        }
+        else
+        {
+            out << "{\"id\":\"" << jsonEscape(id) << "\",\"fen\":\"" << fen << "\",\"bestmove\":\"" << bestMove << "\",\"evaluation\":" << root->evaluation
+                << ",\"depth\":" << depth << ",\"nodes\":" << nodes << ",\"ms\":" << ms << ",\"pv\":\"" << uciLine(st.principalVariation) << '"';
+            if (multiPV)
+            {
+                out << ",\"lines\":[";
+                for (int i = 0; i < (int)st.multiPVLines.size(); i++) { out << (i > 0 ? "," : "") << "{\"evaluation\":" << st.multiPVLines[i].evaluation << ",\"pv\":\"" << uciLine(st.multiPVLines[i].pv) << "\"}"; }
+                out << ']';
+            }
+            out << "}\n";
+        }
+        
+        positions++;
+        totalNodes += nodes;
+    }
+    
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - batchStart).count();
+    if (seconds <= 0) { seconds = 1e-9; }
+    std::cerr << positions << " positions (" << skipped << " skipped) in " << seconds << " s, "
+              << positions/seconds << " positions/s, " << totalNodes/seconds << " nodes/s\n";
+    
+    return positions;
+}
@@ -0,0 +1,35 @@
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#include <string>
+
+#include "SearchTrace.hpp"
+#include "Search.hpp"
+
+class NnueNetwork;
+class AnalysisCache;
+
+enum struct BatchFormat : int {CSV, JSON}; // JSON is one object per line
+
+struct BatchOptions
+{
+    std::string inputPath; // EPD file, one position per line, blank lines and lines starting with '#' are skipped
+    std::string outputPath; // empty means stdout
+    int depth; // levels to generate (plies to search with a depth-first search) per position
+    long nodeLimit; // node budget per position (see StateTree::setNodeBudget()), 0 means unlimited
+    SearchOptions search; // NOTE search.depth is ignored, depth is used for both searches
+    const NnueNetwork* nnue; // nullptr evaluates with StateTree::evaluate()
+    AnalysisCache* analysisCache; // nullptr searches every position, see StateTree::analysisCache
+    BatchFormat format;
+    SearchTrace* trace; // nullptr unless tracing
+};
+
+/* Streams the positions of an EPD file through a fresh StateTree each and writes one result row per position
+ * 
+ * Rows hold the id, FEN, best move (UCI), evaluation, depth reached, nodes (live GameStates for the tree, visited ones for a depth-first search, playouts for the Monte Carlo search, whose depth is the length of its line), milliseconds and the principal variation (UCI), followed by
+ * the best search.multiPV moves' evaluations and lines when that is above 1 (tree and depth-first search). The totals and positions/nodes per second go to std::cerr so they don't end up in the results.
+ * Returns the number of positions analysed, -1 if a file couldn't be opened
+*/
+long runBatch(const BatchOptions &_options);
+
+#endif
@@ -0,0 +1,107 @@
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <chrono>
+
+#include "Bench.hpp"
+#include "StateTree.hpp"
+#include "Notation.hpp"
+#include "Nnue.hpp"
+
+static const int BENCH_PASSES = 5; // every mode is timed over the leaves this many times, the fastest pass counts
+
+static void collectLeaves(GameState* _gs, std::vector<GameState*> &_leaves)
+{
+    if (_gs->nextLevel.empty()) { _leaves.push_back(_gs); }
+    for (auto &child : _gs->nextLevel) { collectLeaves(child.get(), _leaves); }
+}
+
+// fastest of BENCH_PASSES passes over _leaves in ns, NOTE the pawn hash is cleared before each pass
+static double timeLeaves(StateTree &_st, std::vector<GameState*> &_leaves, bool _nnue)
+{
+    double best = 0;
+    for (int pass = 0; pass < BENCH_PASSES; pass++)
+    {
+        _st.pawnHash.clear();
+        auto start = std::chrono::steady_clock::now();
+        if (_nnue) { for (GameState* leaf : _leaves) { _st.evaluateNnue(leaf); } }
+        else { for (GameState* leaf : _leaves) { _st.evaluate(leaf); } }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        if (pass == 0 || ns < best) { best = ns; }
+    }
+    return best;
+}
+
+long benchEvaluation(const std::string &_inputPath, int _depth, const NnueNetwork* _nnue)
+{
+    std::ifstream input(_inputPath);
+    if (!input)
+    {
+        std::cerr << "Couldn't open " << _inputPath << '\n';
+        return -1;
+    }
+    
+    long leaves = 0;
+    double plainNs = 0;
+    double uncachedNs = 0;
+    double cachedNs = 0;
+    double nnueNs = 0;
+    long hits = 0;
+    long probes = 0;
+    
+    std::string line;
+    long lineNumber = 0;
+    while (std::getline(input, line))
+    {
+        lineNumber++;
+        if (line.empty() || line[0] == '#' || line.find_first_not_of(" \t\r") == std::string::npos) { continue; }
+        
+        GameState position(nullptr);
+        std::string id;
+        if (!parseEPD(line, &position, id))
+        {
+            std::cerr << "Skipping malformed line " << lineNumber << '\n';
+            continue;
+        }
+        
+        StateTree st;
+        st.searchOptions.checkpointInterval = 1; // NOTE the leaves keep their boards, only the evaluation is timed
+        st.loadFEN(toFEN(&position));
+        st.genLevels(_depth);
+        std::vector<GameState*> positionLeaves;
+        collectLeaves(st.pastStates.back().get(), positionLeaves);
+        
+        st.pawnStructure = false;
+        plainNs += timeLeaves(st, positionLeaves, false);
+        
+        st.pawnStructure = true;
+        st.pawnHash.resize(0);
+        uncachedNs += timeLeaves(st, positionLeaves, false);
+        
+        st.pawnHash.resize(PAWN_HASH_DEFAULT_KB);
+        cachedNs += timeLeaves(st, positionLeaves, false);
+        hits += st.pawnHash.hits;
+        probes += st.pawnHash.hits + st.pawnHash.misses;
+        
+        if (_nnue != nullptr)
+        {
+            st.nnue = _nnue;
+            nnueNs += timeLeaves(st, positionLeaves, true);
+        }
+        
+        leaves += (long)positionLeaves.size();
+    }
+    
+    if (leaves == 0)
+    {
+        std::cout << "No leaves to time\n";
+        return 0;
+    }
+    std::cout << leaves << " leaves at depth " << _depth << ", ns per leaf:\n";
+    std::cout << "  material only:         " << plainNs/leaves << '\n';
+    std::cout << "  pawn structure:        " << uncachedNs/leaves << '\n';
+    std::cout << "  pawn structure + hash: " << cachedNs/leaves << " (" << 100.0*hits/probes << "% hits)\n";
+    if (_nnue != nullptr) { std::cout << "  nnue:                  " << nnueNs/leaves << '\n'; }
+    return leaves;
+}
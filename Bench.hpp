@@ -0,0 +1,18 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <string>
+
+class NnueNetwork;
+
+/* Leaf evaluation benchmark
+ *
+ * Builds the tree of every position of an EPD file _depth levels deep and times StateTree::evaluate() over its leaves, in the order a search meets them, three ways:
+ * the plain material and advancement sum (pawnStructure off), the pawn structure terms recomputed at every leaf (pawn hash off) and the same terms through the pawn hash.
+ * The pawn hash is cleared before every pass so its hit rate is what one search over those leaves would see. With _nnue a fourth pass times evaluateNnue(), the leaves' accumulators
+ * updated from their parents'. Prints ns per leaf and the hit rate to std::cout.
+ * Returns the number of leaves timed, -1 if the file couldn't be opened
+*/
+long benchEvaluation(const std::string &_inputPath, int _depth, const NnueNetwork* _nnue);
+
+#endif
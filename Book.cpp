@@ -0,0 +1,184 @@
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <random>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Book.hpp"
+
+const size_t BOOK_ENTRY_SIZE = 16;
+
+OpeningBook::OpeningBook()
+{
+    data = nullptr;
+    size = 0;
+    entries = 0;
+    policy = BookPolicy::WEIGHTED;
+    minWeight = 1;
+    rng.seed(std::random_device{}());
+#ifdef _WIN32
+    fileHandle = nullptr;
+    mappingHandle = nullptr;
+#endif
+}
+
+OpeningBook::~OpeningBook()
+{
+    close();
+}
+
+bool OpeningBook::open(const std::string &_path)
+{
+    close();
+    
+#ifdef _WIN32
+    HANDLE file = CreateFileA(_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) { return false; }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0 || fileSize.QuadPart % BOOK_ENTRY_SIZE != 0) { CloseHandle(file); return false; }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) { CloseHandle(file); return false; }
+    const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) { CloseHandle(mapping); CloseHandle(file); return false; }
+    fileHandle = file;
+    mappingHandle = mapping;
+    size = (size_t)fileSize.QuadPart;
+#else
+    int fd = ::open(_path.c_str(), O_RDONLY);
+    if (fd < 0) { return false; }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0 || st.st_size % BOOK_ENTRY_SIZE != 0) { ::close(fd); return false; }
+    void* view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd); // NOTE the mapping stays valid after the descriptor is closed
+    if (view == MAP_FAILED) { return false; }
+    size = (size_t)st.st_size;
+#endif
+    
+    data = (const unsigned char*)view;
+    entries = size / BOOK_ENTRY_SIZE;
+    return true;
+}
+
+void OpeningBook::close()
+{
+    if (data == nullptr) { return; }
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+    CloseHandle((HANDLE)mappingHandle);
+    CloseHandle((HANDLE)fileHandle);
+    fileHandle = nullptr;
+    mappingHandle = nullptr;
+#else
+    munmap((void*)data, size);
+#endif
+    data = nullptr;
+    size = 0;
+    entries = 0;
+}
+
+bool OpeningBook::isOpen() const
+{
+    return data != nullptr;
+}
+
+void OpeningBook::seed(unsigned int _seed)
+{
+    rng.seed(_seed);
+}
+
+uint64_t OpeningBook::entryKey(size_t _i) const
+{
+    const unsigned char* e = data + _i*BOOK_ENTRY_SIZE;
+    uint64_t key = 0;
+    for (int b = 0; b < 8; b++) { key = (key << 8) | e[b]; }
+    return key;
+}
+
+void OpeningBook::entryMove(size_t _i, BookMove &_move) const
+{
+    const unsigned char* e = data + _i*BOOK_ENTRY_SIZE;
+    int move = (e[8] << 8) | e[9];
+    _move.x2 = move & 7;
+    _move.y2 = (move >> 3) & 7;
+    _move.x1 = (move >> 6) & 7;
+    _move.y1 = (move >> 9) & 7;
+    _move.promotion = (move >> 12) & 7;
+    _move.weight = (e[10] << 8) | e[11];
+}
+
+size_t OpeningBook::firstEntry(uint64_t _key) const
+{
+    size_t low = 0;
+    size_t high = entries;
+    while (low < high)
+    {
+        size_t mid = low + (high-low)/2;
+        if (entryKey(mid) < _key) { low = mid+1; }
+        else { high = mid; }
+    }
+    return low;
+}
+
+bool OpeningBook::contains(uint64_t _key) const
+{
+    if (data == nullptr) { return false; }
+    
+    for (size_t i = firstEntry(_key); i < entries && entryKey(i) == _key; i++)
+    {
+        BookMove move;
+        entryMove(i, move);
+        if (move.weight >= minWeight) { return true; }
+    }
+    return false;
+}
+
+bool OpeningBook::probe(uint64_t _key, BookMove &_move)
+{
+    if (data == nullptr) { return false; }
+    
+    size_t low = firstEntry(_key);
+    std::vector<BookMove> candidates;
+    long totalWeight = 0;
+    for (size_t i = low; i < entries && entryKey(i) == _key; i++)
+    {
+        BookMove move;
+        entryMove(i, move);
+        if (move.weight < minWeight) { continue; }
+        candidates.push_back(move);
+        totalWeight += move.weight;
+    }
+    if (candidates.empty()) { return false; }
+    
+    size_t choice = 0;
+    BookPolicy mode = (totalWeight == 0 ? BookPolicy::UNIFORM : policy); // only zero weights left when minWeight is 0
+    switch(mode)
+    {
+        case (BookPolicy::BEST):
+            for (size_t i = 1; i < candidates.size(); i++)
+            {
+                if (candidates[i].weight > candidates[choice].weight) { choice = i; }
+            }
+            break;
+        case (BookPolicy::WEIGHTED):
+        {
+            long pick = std::uniform_int_distribution<long>(0, totalWeight-1)(rng);
+            while (pick >= candidates[choice].weight) { pick -= candidates[choice].weight; choice++; }
+            break;
+        }
+        case (BookPolicy::UNIFORM):
+            choice = std::uniform_int_distribution<size_t>(0, candidates.size()-1)(rng);
+            break;
+    }
+    
+    _move = candidates[choice];
+    return true;
+}
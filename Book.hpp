@@ -0,0 +1,64 @@
+#ifndef BOOK_HPP
+#define BOOK_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <random>
+
+enum struct BookPolicy : int {BEST, WEIGHTED, UNIFORM}; // BEST always plays the highest weight, WEIGHTED picks randomly in proportion to weight, UNIFORM ignores weights
+
+struct BookMove
+{
+    int x1, y1, x2, y2; // NOTE Polyglot writes castling as the king taking its own rook (e1h1), only the board can tell that apart from a rook move
+    int promotion; // Polyglot encoding, 0 none, 1 knight, 2 bishop, 3 rook, 4 queen
+    int weight;
+};
+
+/* Read-only Polyglot .bin opening book
+ * 
+ * The file is memory-mapped, entries are 16 bytes big-endian (key, move, weight, learn) sorted by key so a probe is a binary search for the first matching key followed by a linear walk over its moves
+*/
+class OpeningBook
+{
+public:
+    OpeningBook();
+    
+    ~OpeningBook();
+    
+    OpeningBook(const OpeningBook&) = delete; // NOTE owns the mapping, a copy would unmap it a second time
+    OpeningBook& operator=(const OpeningBook&) = delete;
+    
+    bool open(const std::string &_path); // maps the file, returns false if it can't be opened or isn't a whole number of entries
+    
+    void close();
+    
+    bool isOpen() const;
+    
+    bool probe(uint64_t _key, BookMove &_move); // picks a move for the position with key _key according to policy, returns false if the position is not in the book
+    
+    bool contains(uint64_t _key) const; // true if probe() would find a move for _key, without picking one (so without touching the RNG)
+    
+    BookPolicy policy;
+    int minWeight; // moves with a smaller weight are never played
+    
+    void seed(unsigned int _seed);
+    
+private:
+    const unsigned char* data;
+    size_t size; // bytes mapped
+    size_t entries;
+    std::mt19937 rng;
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#endif
+    
+    uint64_t entryKey(size_t _i) const;
+    
+    size_t firstEntry(uint64_t _key) const; // binary search for the first entry with key _key, or where it would be
+    
+    void entryMove(size_t _i, BookMove &_move) const;
+};
+
+#endif
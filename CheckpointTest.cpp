@@ -0,0 +1,123 @@
+#include <string>
+#include <iostream>
+
+#include "StateTree.hpp"
+#include "Zobrist.hpp"
+#include "Notation.hpp"
+
+/*
+ * checkpointtest - checks that StateTree::materialize() replays a dropped board to the one the move generator made, for several checkpoint
+ * intervals: the same squares as a tree that kept every board, and the boardKey and positionKey stored when the GameState was generated
+ *
+ * Usage: make test
+ *
+ * Prints every case that fails and exits with 1 if there were any
+ */
+
+const int CHECKPOINT_DEPTH = 4;
+const int CHECKPOINT_MAX_INTERVAL = 5;
+
+const char* CHECKPOINT_FENS[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1", // castling both ways, rook moves giving it up
+    "r3k2r/8/8/8/8/8/8/R3K2R b KQkq - 0 7", // black to move, the checkpoints fall on the other plies
+    "4k3/3p4/8/4P3/8/8/8/4K3 b - - 0 1", // en passant after d7d5, below the current state's children that keep their boards
+    "8/P5k1/8/8/8/8/1p4K1/8 w - - 0 1", // promotions on both sides
+};
+
+struct Replay
+{
+    long nodes;
+    long dropped;
+    bool matches;
+};
+
+// walks _gs and _reference (the same tree grown with every board kept) side by side, materializing every dropped board and dropping it again
+static void replayTree(StateTree &_st, GameState* _gs, const GameState* _reference, const std::string &_case, Replay &_replay)
+{
+    _replay.nodes++;
+    bool replayed = _st.materialize(_gs);
+    if (replayed) { _replay.dropped++; }
+    
+    bool sameBoard = true;
+    for (int x = 0; x < 8; x++)
+    {
+        for (int y = 0; y < 8; y++) { sameBoard = sameBoard && _gs->board[x][y] == _reference->board[x][y]; }
+    }
+    bool sameKeys = (zobristBoardKey(_gs) == _gs->boardKey && (_gs->positionKey == 0 || zobristKey(_gs) == _gs->positionKey));
+    if (_replay.matches && (!sameBoard || !sameKeys))
+    {
+        std::cout << " ##### FAIL " << _case << ": " << (replayed ? "replayed" : "kept") << " board after " << uciMove(_gs->fromX, _gs->fromY, _gs->toX, _gs->toY)
+                  << (sameBoard ? "" : " differs from the reference tree") << (sameKeys ? "" : " doesn't match its stored keys") << " ##### \n";
+        _replay.matches = false;
+    }
+    if (replayed) { _gs->board.drop(); }
+    
+    if (_gs->nextLevel.size() != _reference->nextLevel.size())
+    {
+        if (_replay.matches) { std::cout << " ##### FAIL " << _case << ": " << _gs->nextLevel.size() << " children, the reference tree has " << _reference->nextLevel.size() << " ##### \n"; }
+        _replay.matches = false;
+        return;
+    }
+    for (int i = 0; i < (int)_gs->nextLevel.size(); i++) { replayTree(_st, _gs->nextLevel[i].get(), _reference->nextLevel[i].get(), _case, _replay); }
+}
+
+int main()
+{
+    int failures = 0;
+    int total = 0;
+    
+    for (const char* fen : CHECKPOINT_FENS)
+    {
+        StateTree reference;
+        reference.loadFEN(fen);
+        reference.searchOptions.checkpointInterval = 1;
+        reference.genLevels(CHECKPOINT_DEPTH);
+        
+        for (int interval = 1; interval <= CHECKPOINT_MAX_INTERVAL; interval++)
+        {
+            total++;
+            std::string name = std::string(fen) + " every " + std::to_string(interval) + " plies";
+            StateTree st;
+            if (!st.loadFEN(fen))
+            {
+                std::cout << " ##### FAIL can't set up " << fen << " ##### \n";
+                failures++;
+                continue;
+            }
+            st.searchOptions.checkpointInterval = interval;
+            st.genLevels(CHECKPOINT_DEPTH);
+            
+            Replay replay{0, 0, true};
+            replayTree(st, st.pastStates.back().get(), reference.pastStates.back().get(), name, replay);
+            if (replay.matches && (interval == 1 ? replay.dropped != 0 : replay.dropped == 0))
+            {
+                std::cout << " ##### FAIL " << name << ": " << replay.dropped << " of " << replay.nodes << " boards were dropped ##### \n";
+                replay.matches = false;
+            }
+            if (!replay.matches) { failures++; }
+        }
+    }
+    
+    // a copy of a dropped board stays dropped, assigning a present one brings it back
+    {
+        total++;
+        BoardHandle board;
+        board[4][0] = PieceType::W_KING;
+        BoardHandle kept(board);
+        board.drop();
+        BoardHandle copy(board);
+        BoardHandle assigned;
+        assigned = board;
+        bool droppedCopies = !copy.present() && !assigned.present();
+        assigned = kept;
+        if (!droppedCopies || !kept.present() || !assigned.present() || assigned[4][0] != PieceType::W_KING)
+        {
+            std::cout << " ##### FAIL copying a dropped BoardHandle ##### \n";
+            failures++;
+        }
+    }
+    
+    std::cout << total-failures << "/" << total << " checkpoint checks passed\n";
+    return (failures == 0 ? 0 : 1);
+}
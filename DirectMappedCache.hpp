@@ -0,0 +1,101 @@
+#ifndef DIRECTMAPPEDCACHE_HPP
+#define DIRECTMAPPEDCACHE_HPP
+
+#include <cstdint>
+#include <vector>
+
+/* Direct-mapped cache, the table behind PawnHashTable and EvalCache
+ *
+ * One Entry per slot and the low bits of the key pick the slot, colliding keys simply overwrite each other. Entry needs a uint64_t member called key,
+ * the cache only ever compares that and leaves the rest of the Entry to the caller.
+ *
+ * NOTE A zeroed Entry has to be the right answer for key 0 since that's what a fresh slot holds.
+ * NOTE Not thread safe, every StateTree has its own caches.
+*/
+
+template <typename Entry>
+class DirectMappedCache
+{
+public:
+    DirectMappedCache(long _kilobytes); // see resize()
+    
+    void resize(long _kilobytes); // entries are rounded down to a power of two and only allocated on the first probe, 0 turns the cache off so every probe misses
+    
+    void clear(); // forgets every entry and zeroes the counters
+    
+    Entry& probe(uint64_t _key, bool &_hit); // the slot for _key, if !_hit the caller has to fill all of it in (key included)
+    
+    long size() const; // entries, 0 if off
+    
+    double hitRate() const; // hits/(hits+misses) since the last clear()
+    
+    long hits;
+    long misses;
+
+private:
+    std::vector<Entry> table;
+    long entries; // table.size() once allocated
+    Entry scratch; // handed out while the cache is off
+};
+
+template <typename Entry>
+DirectMappedCache<Entry>::DirectMappedCache(long _kilobytes)
+{
+    hits = 0;
+    misses = 0;
+    entries = 0;
+    resize(_kilobytes);
+}
+
+template <typename Entry>
+void DirectMappedCache<Entry>::resize(long _kilobytes)
+{
+    long wanted = (_kilobytes > 0 ? _kilobytes*1024 / (long)sizeof(Entry) : 0);
+    entries = 1;
+    while (entries*2 <= wanted) { entries *= 2; }
+    if (wanted == 0) { entries = 0; }
+    
+    table.clear();
+    table.shrink_to_fit();
+    clear();
+}
+
+template <typename Entry>
+void DirectMappedCache<Entry>::clear()
+{
+    if (!table.empty()) { table.assign(table.size(), Entry{}); }
+    hits = 0;
+    misses = 0;
+}
+
+template <typename Entry>
+Entry& DirectMappedCache<Entry>::probe(uint64_t _key, bool &_hit)
+{
+    if (entries == 0)
+    {
+        misses++;
+        _hit = false;
+        return scratch;
+    }
+    if (table.empty()) { table.assign(entries, Entry{}); }
+    
+    Entry &entry = table[_key & (uint64_t)(entries-1)];
+    _hit = (entry.key == _key);
+    if (_hit) { hits++; }
+    else { misses++; }
+    return entry;
+}
+
+template <typename Entry>
+long DirectMappedCache<Entry>::size() const
+{
+    return entries;
+}
+
+template <typename Entry>
+double DirectMappedCache<Entry>::hitRate() const
+{
+    return (hits + misses > 0 ? (double)hits / (hits + misses) : 0);
+}
+
+#endif
@@ -0,0 +1,354 @@
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+#include "Endgame.hpp"
+
+// ---------- KPK BITBASE ----------
+
+const int KPK_POSITIONS = 24*64*64*2; // pawn on files a-d of ranks 2-7, strong king, weak king, side to move
+
+enum KpkResult : uint8_t {KPK_INVALID=0, KPK_UNKNOWN=1, KPK_DRAW=2, KPK_WIN=4}; // NOTE bits, so the results of every move can be ORed together
+
+static uint64_t kpkBits[KPK_POSITIONS/64]; // set for a win
+
+static int distance(int _a, int _b)
+{
+    return std::max(std::abs(_a%8 - _b%8), std::abs(_a/8 - _b/8));
+}
+
+static bool pawnAttacks(int _pawn, int _square)
+{
+    return _square/8 == _pawn/8 + 1 && std::abs(_square%8 - _pawn%8) == 1;
+}
+
+static int kpkIndex(int _strongKing, int _pawn, int _weakKing, bool _strongToMove)
+{
+    int pawnIndex = 4*(_pawn/8 - 1) + _pawn%8;
+    return (((pawnIndex*64 + _strongKing)*64 + _weakKing) << 1) | (_strongToMove ? 0:1);
+}
+
+// the result that can be told without looking at any move
+static KpkResult kpkClassify(int _strongKing, int _pawn, int _weakKing, bool _strongToMove)
+{
+    if (_strongKing == _weakKing || _strongKing == _pawn || _weakKing == _pawn || distance(_strongKing, _weakKing) <= 1) { return KPK_INVALID; }
+    if (_strongToMove)
+    {
+        if (pawnAttacks(_pawn, _weakKing)) { return KPK_INVALID; } // the weak side left its king in check
+        
+        // promotes without losing the queen
+        int promotion = _pawn + 8;
+        if (_pawn/8 == 6 && _strongKing != promotion && _weakKing != promotion && (distance(_weakKing, promotion) > 1 || distance(_strongKing, promotion) == 1)) { return KPK_WIN; }
+        return KPK_UNKNOWN;
+    }
+    
+    if (distance(_weakKing, _pawn) == 1 && distance(_strongKing, _pawn) > 1) { return KPK_DRAW; } // takes the pawn
+    
+    // no move, mate or stalemate
+    for (int dy = -1; dy <= 1; dy++)
+    {
+        for (int dx = -1; dx <= 1; dx++)
+        {
+            int x = _weakKing%8 + dx;
+            int y = _weakKing/8 + dy;
+            if ((dx == 0 && dy == 0) || x < 0 || x > 7 || y < 0 || y > 7) { continue; }
+            int square = 8*y + x;
+            if (distance(square, _strongKing) > 1 && !pawnAttacks(_pawn, square) && square != _pawn) { return KPK_UNKNOWN; }
+        }
+    }
+    return (pawnAttacks(_pawn, _weakKing) ? KPK_WIN : KPK_DRAW);
+}
+
+// ORs together the results of every move, NOTE moves into an illegal position add KPK_INVALID, i.e. nothing
+static KpkResult kpkStep(const std::vector<uint8_t> &_results, int _strongKing, int _pawn, int _weakKing, bool _strongToMove)
+{
+    int moved = _strongToMove ? _strongKing : _weakKing;
+    int results = 0;
+    for (int dy = -1; dy <= 1; dy++)
+    {
+        for (int dx = -1; dx <= 1; dx++)
+        {
+            int x = moved%8 + dx;
+            int y = moved/8 + dy;
+            if ((dx == 0 && dy == 0) || x < 0 || x > 7 || y < 0 || y > 7) { continue; }
+            if (_strongToMove) { results |= _results[kpkIndex(8*y + x, _pawn, _weakKing, false)]; }
+            else { results |= _results[kpkIndex(_strongKing, _pawn, 8*y + x, true)]; }
+        }
+    }
+    
+    if (_strongToMove)
+    {
+        // pushes, NOTE promoting is already classified as a win or (if the queen is lost) not worth trying
+        int push = _pawn + 8;
+        if (_pawn/8 < 6 && push != _strongKing && push != _weakKing)
+        {
+            results |= _results[kpkIndex(_strongKing, push, _weakKing, false)];
+            if (_pawn/8 == 1 && push+8 != _strongKing && push+8 != _weakKing) { results |= _results[kpkIndex(_strongKing, push+8, _weakKing, false)]; }
+        }
+        return (results & KPK_WIN ? KPK_WIN : (results & KPK_UNKNOWN ? KPK_UNKNOWN : KPK_DRAW));
+    }
+    return (results & KPK_DRAW ? KPK_DRAW : (results & KPK_UNKNOWN ? KPK_UNKNOWN : KPK_WIN));
+}
+
+// retrograde analysis, whatever is still unknown once a pass changes nothing is a draw
+static void kpkGenerate()
+{
+    std::vector<uint8_t> results(KPK_POSITIONS);
+    for (int i = 0; i < KPK_POSITIONS; i++)
+    {
+        int pawnIndex = i >> 13;
+        results[i] = kpkClassify((i >> 7) & 63, 8*(pawnIndex/4 + 1) + pawnIndex%4, (i >> 1) & 63, (i & 1) == 0);
+    }
+    
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (int i = 0; i < KPK_POSITIONS; i++)
+        {
+            if (results[i] != KPK_UNKNOWN) { continue; }
+            int pawnIndex = i >> 13;
+            results[i] = kpkStep(results, (i >> 7) & 63, 8*(pawnIndex/4 + 1) + pawnIndex%4, (i >> 1) & 63, (i & 1) == 0);
+            if (results[i] != KPK_UNKNOWN) { changed = true; }
+        }
+    }
+    
+    for (int i = 0; i < KPK_POSITIONS; i++)
+    {
+        if (results[i] == KPK_WIN) { kpkBits[i/64] |= 1ULL << (i%64); }
+    }
+}
+
+bool kpkWin(int _strongKing, int _pawn, int _weakKing, bool _strongToMove)
+{
+    if (_pawn/8 < 1 || _pawn/8 > 6) { return false; }
+    if (_pawn%8 > 3) // mirrored onto files a-d
+    {
+        _strongKing ^= 7;
+        _pawn ^= 7;
+        _weakKing ^= 7;
+    }
+    int index = kpkIndex(_strongKing, _pawn, _weakKing, _strongToMove);
+    return (kpkBits[index/64] >> (index%64)) & 1;
+}
+
+// ---------- EVALUATORS ----------
+
+// a position of a registered ending mirrored so the stronger side is white
+struct EndgamePosition
+{
+    int strongKing; // squares are 8*y+x
+    int weakKing;
+    bool strongToMove;
+    int pieces; // besides the kings
+    PieceType kinds[ENDGAME_MAX_PIECES]; // NOTE the stronger side's are white PieceTypes
+    int squares[ENDGAME_MAX_PIECES];
+};
+
+typedef float (*EndgameEvaluator)(const EndgamePosition &_pos, bool &_exact); // from the stronger side's view
+
+struct EndgameEntry
+{
+    EndgameEvaluator evaluator;
+    bool strongWhite;
+};
+
+static std::unordered_map<uint64_t, EndgameEntry> endgames;
+
+static float pieceValue(PieceType _piece)
+{
+    switch(_piece)
+    {
+        case (PieceType::W_PAWN): return 1;
+        case (PieceType::W_KNIGHT): return 3;
+        case (PieceType::W_BISHOP): return 3;
+        case (PieceType::W_ROOK): return 5;
+        case (PieceType::W_QUEEN): return 9;
+        default: return 0;
+    }
+}
+
+// 0 in the middle four squares, 6 in a corner
+static int centerDistance(int _square)
+{
+    int x = _square%8;
+    int y = _square/8;
+    return std::max(3-x, x-4) + std::max(3-y, y-4);
+}
+
+static float evalDraw(const EndgamePosition &_pos, bool &_exact)
+{
+    _exact = true;
+    return 0;
+}
+
+static float evalKPK(const EndgamePosition &_pos, bool &_exact)
+{
+    _exact = true;
+    int pawn = _pos.squares[0];
+    if (!kpkWin(_pos.strongKing, pawn, _pos.weakKing, _pos.strongToMove)) { return 0; }
+    return ENDGAME_WIN_EVALUATION + 1 + 0.5*(pawn/8); // NOTE a pawn push that keeps the win is progress
+}
+
+// mating material against a lone king, drive it to the edge and bring the king up
+static float evalKXK(const EndgamePosition &_pos, bool &_exact)
+{
+    _exact = false;
+    float material = 0;
+    for (int i = 0; i < _pos.pieces; i++) { material += pieceValue(_pos.kinds[i]); }
+    return ENDGAME_WIN_EVALUATION + material + 0.3*centerDistance(_pos.weakKing) + 0.1*(7 - distance(_pos.strongKing, _pos.weakKing));
+}
+
+static float evalKBBK(const EndgamePosition &_pos, bool &_exact)
+{
+    if ((_pos.squares[0]%8 + _pos.squares[0]/8) % 2 == (_pos.squares[1]%8 + _pos.squares[1]/8) % 2)
+    {
+        _exact = false; // can't mate with bishops on one color, only if the lone king walks into it
+        return 0;
+    }
+    return evalKXK(_pos, _exact);
+}
+
+static float evalKNNK(const EndgamePosition &_pos, bool &_exact)
+{
+    _exact = false; // no forced mate, only a helpmate
+    return 0;
+}
+
+// mate only comes in a corner of the bishop's color
+static float evalKBNK(const EndgamePosition &_pos, bool &_exact)
+{
+    _exact = false;
+    int bishop = (_pos.kinds[0] == PieceType::W_BISHOP ? _pos.squares[0] : _pos.squares[1]);
+    bool dark = (bishop%8 + bishop/8) % 2 == 0; // like a1
+    int corners[2] = {dark ? 0:7, dark ? 63:56};
+    int cornerDistance = 14;
+    for (int corner : corners) { cornerDistance = std::min(cornerDistance, std::abs(_pos.weakKing%8 - corner%8) + std::abs(_pos.weakKing/8 - corner/8)); }
+    return ENDGAME_WIN_EVALUATION + 6 + 0.2*(14 - cornerDistance) + 0.1*(7 - distance(_pos.strongKing, _pos.weakKing));
+}
+
+// ---------- REGISTRY ----------
+
+static int materialShift(PieceType _piece)
+{
+    switch(_piece)
+    {
+        case (PieceType::W_PAWN): return 0;
+        case (PieceType::W_KNIGHT): return 4;
+        case (PieceType::W_BISHOP): return 8;
+        case (PieceType::W_ROOK): return 12;
+        case (PieceType::W_QUEEN): return 16;
+        case (PieceType::B_PAWN): return 20;
+        case (PieceType::B_KNIGHT): return 24;
+        case (PieceType::B_BISHOP): return 28;
+        case (PieceType::B_ROOK): return 32;
+        case (PieceType::B_QUEEN): return 36;
+        default: return -1;
+    }
+}
+
+uint64_t materialKey(const std::array<std::array<PieceType,8>,8> &_board)
+{
+    uint64_t key = 0;
+    for (int y = 0; y < 8; y++)
+    {
+        for (int x = 0; x < 8; x++)
+        {
+            int shift = materialShift(_board[x][y]);
+            if (shift != -1) { key += 1ULL << shift; }
+        }
+    }
+    return key;
+}
+
+// _code names the stronger side's pieces then the weaker side's, e.g. "KBNK"
+static void registerEndgame(const std::string &_code, EndgameEvaluator _evaluator)
+{
+    for (bool strongWhite : {true, false})
+    {
+        uint64_t key = 0;
+        bool strong = true;
+        for (size_t i = 1; i < _code.size(); i++)
+        {
+            if (_code[i] == 'K')
+            {
+                strong = false;
+                continue;
+            }
+            PieceType piece = (PieceType)(strong == strongWhite ? _code[i] : _code[i] + 32); // NOTE black PieceTypes are the lower case letters
+            key += 1ULL << materialShift(piece);
+        }
+        endgames[key] = EndgameEntry{_evaluator, strongWhite};
+    }
+}
+
+// builds the bitbase and the registry before main() runs
+static struct EndgameInit
+{
+    EndgameInit()
+    {
+        kpkGenerate();
+        
+        registerEndgame("KK", evalDraw);
+        registerEndgame("KNK", evalDraw);
+        registerEndgame("KBK", evalDraw);
+        registerEndgame("KNNK", evalKNNK);
+        registerEndgame("KPK", evalKPK);
+        registerEndgame("KBNK", evalKBNK);
+        registerEndgame("KBBK", evalKBBK);
+        for (const char* code : {"KQK", "KRK", "KQQK", "KQRK", "KQBK", "KQNK", "KRRK", "KRBK", "KRNK"}) { registerEndgame(code, evalKXK); }
+    }
+} endgameInit;
+
+bool endgameEvaluate(const GameState* _gs, float &_evaluation, bool &_exact)
+{
+    auto found = endgames.find(materialKey(_gs->board));
+    if (found == endgames.end()) { return false; }
+    bool strongWhite = found->second.strongWhite;
+    
+    EndgamePosition pos;
+    pos.strongKing = pos.weakKing = -1;
+    pos.strongToMove = (_gs->whiteTurn == strongWhite);
+    pos.pieces = 0;
+    for (int y = 0; y < 8; y++)
+    {
+        for (int x = 0; x < 8; x++)
+        {
+            PieceType piece = _gs->board[x][y];
+            if (piece == PieceType::EMPTY) { continue; }
+            bool white = (int)piece < COLOR_THRESHOLD;
+            int square = (strongWhite ? 8*y + x : 8*(7-y) + x);
+            if (piece == PieceType::W_KING || piece == PieceType::B_KING)
+            {
+                if (white == strongWhite) { pos.strongKing = square; }
+                else { pos.weakKing = square; }
+                continue;
+            }
+            pos.kinds[pos.pieces] = (PieceType)(strongWhite ? (int)piece : (white ? (int)piece + 32 : (int)piece - 32));
+            pos.squares[pos.pieces] = square;
+            pos.pieces++;
+        }
+    }
+    if (pos.strongKing == -1 || pos.weakKing == -1) { return false; }
+    
+    // the side to move could take the other king, the search has to see that
+    int otherKing = (pos.strongToMove ? pos.weakKing : pos.strongKing);
+    int otherY = (strongWhite ? otherKing/8 : 7 - otherKing/8);
+    if (squareAttacked(_gs->board, otherKing%8, otherY, _gs->whiteTurn)) { return false; }
+    
+    float evaluation = found->second.evaluator(pos, _exact);
+    _evaluation = (strongWhite ? evaluation : -evaluation);
+    return true;
+}
+
+bool endgameProbe(const GameState* _gs, float &_evaluation)
+{
+    float evaluation;
+    bool exact;
+    if (!endgameEvaluate(_gs, evaluation, exact) || !exact) { return false; }
+    _evaluation = evaluation;
+    return true;
+}
@@ -0,0 +1,31 @@
+#ifndef ENDGAME_HPP
+#define ENDGAME_HPP
+
+#include <cstdint>
+
+#include "StateTree.hpp"
+
+/* Endgame knowledge, the endings that plain material can't score
+ *
+ * A registry of evaluators keyed by material signature (the count of every piece type of either color). Each one is written for the stronger side as
+ * white and registered for both colors, the position is mirrored before it's called. Evaluators either know the result (KPK from the bitbase, bare
+ * kings and a lone minor piece are draws), which lets the searches stop at the GameState as they do for a tablebase hit, or give a scaled score that
+ * leads the search towards the win (KQK, KRK, KBBK, KBNK, ...): ENDGAME_WIN_EVALUATION plus terms for driving the lone king to the edge or the right corner.
+ *
+ * The KPK bitbase is built by retrograde analysis before main() runs, one bit for each of the 196608 positions with the pawn on files a-d (24 KB).
+ *
+ * NOTE evaluations from here depend on the side to move, positions where the side to move could take the other king are never scored
+*/
+
+const float ENDGAME_WIN_EVALUATION = 1000; // a known win, below TB_WIN_EVALUATION so a tablebase win still counts for more, above any material evaluation
+const int ENDGAME_MAX_PIECES = 4; // most pieces (kings included) of any registered ending
+
+bool endgameEvaluate(const GameState* _gs, float &_evaluation, bool &_exact); // white-relative evaluation of _gs if its material has an evaluator, _exact if it's the known result, false otherwise
+
+bool endgameProbe(const GameState* _gs, float &_evaluation); // endgameEvaluate() that only answers with known results, the way tbProbeWDL() does
+
+bool kpkWin(int _strongKing, int _pawn, int _weakKing, bool _strongToMove); // bitbase lookup, squares are 8*y+x from the pawn's side (it moves up), false for a draw or an illegal position
+
+uint64_t materialKey(const std::array<std::array<PieceType,8>,8> &_board); // 4 bits per piece type and color, kings left out
+
+#endif
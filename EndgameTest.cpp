@@ -0,0 +1,157 @@
+#include <string>
+#include <cctype>
+#include <cmath>
+#include <iostream>
+
+#include "StateTree.hpp"
+#include "Notation.hpp"
+#include "Endgame.hpp"
+
+/*
+ * endgametest - checks the KPK bitbase against the known count of won positions and a few textbook ones, and that endgameEvaluate() scores a
+ * position with colors swapped and the board flipped as the exact negation
+ *
+ * Usage: make test
+ *
+ * Prints every case that fails and exits with 1 if there were any
+ */
+
+const long KPK_KNOWN_WINS = 222564; // pawn on any file, either side to move
+
+struct KpkCase
+{
+    const char* strongKing;
+    const char* pawn;
+    const char* weakKing;
+    bool strongToMove;
+    bool win;
+};
+
+const KpkCase KPK_CASES[] = {
+    {"e6", "e5", "e8", true, true},
+    {"e6", "e5", "e8", false, true},
+    {"e5", "e4", "e7", true, false}, // black has the opposition
+    {"e5", "e4", "e7", false, true}, // white has it
+    {"b6", "a5", "a8", true, false}, // rook pawn, the king can't be shut out of the corner
+    {"b6", "a5", "a8", false, false},
+    {"h6", "h5", "h8", true, false},
+    {"a1", "d7", "h1", true, true}, // promotes
+    {"a1", "d2", "d3", false, false}, // takes the pawn
+};
+
+struct MirrorCase
+{
+    const char* fen;
+    int result; // 1 a known win for white, -1 for black, 0 a known draw, 2 a scaled score (not exact)
+};
+
+const MirrorCase MIRROR_CASES[] = {
+    {"4k3/8/4K3/4P3/8/8/8/8 w - - 0 1", 1},
+    {"8/8/8/4p3/4k3/8/4K3/8 b - - 0 1", 0}, // Ke5/Pe4/ke7 with the colors swapped
+    {"8/8/8/4p3/4k3/8/4K3/8 w - - 0 1", -1},
+    {"k7/8/1K6/P7/8/8/8/8 w - - 0 1", 0},
+    {"8/8/8/8/p7/1k6/8/K7 b - - 0 1", 0},
+    {"8/8/3k4/8/3K4/8/8/7r w - - 0 1", 2},
+    {"8/8/8/8/8/2k5/8/KBN5 b - - 0 1", 2},
+    {"8/8/8/8/8/2k5/8/K6N w - - 0 1", 0},
+};
+
+static bool parseSquare(const std::string &_text, int &_square)
+{
+    if (_text.size() != 2 || _text[0] < 'a' || _text[0] > 'h' || _text[1] < '1' || _text[1] > '8') { return false; }
+    _square = 8*(_text[1]-'1') + _text[0]-'a';
+    return true;
+}
+
+// the same position with white and black swapped, ranks flipped and the other side to move
+static std::string mirrorFEN(const std::string &_fen)
+{
+    std::string board = _fen.substr(0, _fen.find(' '));
+    std::string mirrored;
+    size_t end = board.size();
+    while (true)
+    {
+        size_t start = board.rfind('/', end-1);
+        size_t from = (start == std::string::npos ? 0 : start+1);
+        for (size_t i = from; i < end; i++)
+        {
+            char c = board[i];
+            mirrored += (std::isupper(c) ? (char)std::tolower(c) : (char)std::toupper(c));
+        }
+        if (start == std::string::npos) { break; }
+        mirrored += '/';
+        end = start;
+    }
+    char side = _fen[_fen.find(' ')+1];
+    return mirrored + (side == 'w' ? " b" : " w") + " - - 0 1";
+}
+
+int main()
+{
+    int failures = 0;
+    int total = 0;
+    
+    // every legal position, the bitbase leaves illegal ones unset, NOTE files e-h go through kpkWin()'s mirroring
+    total++;
+    long wins = 0;
+    for (int pawn = 8; pawn < 56; pawn++)
+    {
+        for (int strongKing = 0; strongKing < 64; strongKing++)
+        {
+            for (int weakKing = 0; weakKing < 64; weakKing++)
+            {
+                wins += kpkWin(strongKing, pawn, weakKing, true) + kpkWin(strongKing, pawn, weakKing, false);
+            }
+        }
+    }
+    if (wins != KPK_KNOWN_WINS)
+    {
+        std::cout << " ##### FAIL the KPK bitbase has " << wins << " wins, expected " << KPK_KNOWN_WINS << " ##### \n";
+        failures++;
+    }
+    
+    for (const KpkCase &test : KPK_CASES)
+    {
+        total++;
+        int strongKing, pawn, weakKing;
+        if (!parseSquare(test.strongKing, strongKing) || !parseSquare(test.pawn, pawn) || !parseSquare(test.weakKing, weakKing))
+        {
+            std::cout << " ##### FAIL can't set up K" << test.strongKing << " P" << test.pawn << " k" << test.weakKing << " ##### \n";
+            failures++;
+            continue;
+        }
+        if (kpkWin(strongKing, pawn, weakKing, test.strongToMove) != test.win)
+        {
+            std::cout << " ##### FAIL K" << test.strongKing << " P" << test.pawn << " k" << test.weakKing << (test.strongToMove ? " white" : " black") << " to move should be a " << (test.win ? "win" : "draw") << " ##### \n";
+            failures++;
+        }
+    }
+    
+    for (const MirrorCase &test : MIRROR_CASES)
+    {
+        total++;
+        std::string mirror = mirrorFEN(test.fen);
+        GameState gs(nullptr), flipped(nullptr);
+        float evaluation, flippedEvaluation;
+        bool exact, flippedExact;
+        if (!parseFEN(test.fen, &gs) || !parseFEN(mirror, &flipped) || !endgameEvaluate(&gs, evaluation, exact) || !endgameEvaluate(&flipped, flippedEvaluation, flippedExact))
+        {
+            std::cout << " ##### FAIL no endgame evaluation for " << test.fen << " or " << mirror << " ##### \n";
+            failures++;
+            continue;
+        }
+        
+        bool right;
+        if (test.result == 2) { right = !exact && std::fabs(evaluation) >= ENDGAME_WIN_EVALUATION; }
+        else if (test.result == 0) { right = exact && evaluation == 0; }
+        else { right = exact && evaluation*test.result >= ENDGAME_WIN_EVALUATION; }
+        if (!right || flippedExact != exact || flippedEvaluation != -evaluation)
+        {
+            std::cout << " ##### FAIL " << test.fen << " is " << evaluation << (exact ? " (exact)" : "") << ", " << mirror << " is " << flippedEvaluation << (flippedExact ? " (exact)" : "") << " ##### \n";
+            failures++;
+        }
+    }
+    
+    std::cout << total-failures << "/" << total << " endgame checks passed\n";
+    return (failures == 0 ? 0 : 1);
+}
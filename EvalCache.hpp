@@ -0,0 +1,26 @@
+#ifndef EVALCACHE_HPP
+#define EVALCACHE_HPP
+
+#include <cstdint>
+
+#include "DirectMappedCache.hpp"
+
+/* Evaluation cache, a direct-mapped and lossy store of evaluate() results
+ *
+ * Keyed by GameState::boardKey and the side to move, which the NNUE and the endgame evaluators (Endgame.hpp) look at. The same leaf is reached through
+ * different move orders in the tree, and by every iteration of a depth-first search, so it only has to be scored once.
+ *
+ * NOTE Not thread safe, every StateTree has its own cache.
+*/
+
+const long EVAL_CACHE_DEFAULT_KB = 1024;
+
+struct EvalEntry // NOTE zeroed it's the right answer for key 0, an empty board evaluates to 0
+{
+    uint64_t key;
+    float evaluation; // white-relative
+};
+
+typedef DirectMappedCache<EvalEntry> EvalCache;
+
+#endif
@@ -1,7 +1,21 @@
 #include <string>
 #include <iostream>
+#include <cstdlib>
+#include <thread>
 
 #include "StateTree.hpp"
+#include "Zobrist.hpp"
+#include "Tablebase.hpp"
+#include "Batch.hpp"
+#include "SelfPlay.hpp"
+#include "Bench.hpp"
+#include "Nnue.hpp"
+#include "Mate.hpp"
+#include "Annotate.hpp"
+#include "Server.hpp"
+#include "TranspositionTable.hpp"
+#include "AnalysisCache.hpp"
+#include "Notation.hpp"
 
 /*
  * NOTE Different compilations have different effects!
@@ -14,17 +28,483 @@
  * 
  */
 
-// ATTENTION genLevels(x) then minimaxEval() must be called before pushComputerState()!!!
+// ATTENTION genLevels(x) (or genToDepth(x)) must be called before pushComputerState()!!!
 
 // ATTENTION Relevent tree should be being preserved when moves are made so keep that in mind when generating move levels
 
 // ATTENTION Check that post on chess.com that you first read to see evaluation function suggestions
 
-void getPlayerMove(int &_x1, int &_y1, int &_x2, int &_y2);
+void getPlayerMove(StateTree &_st, int &_x1, int &_y1, int &_x2, int &_y2); // a SAN or UCI move, or the old two prompts for squares ("E2" then "E4")
 
-int main()
+void growTree(StateTree &_st, int _levels);
+
+void reportBudget(StateTree &_st);
+
+void printStats(StateTree &_st);
+
+/*
+ * Options:
+ * --mem-mb N   cap the state tree at roughly N megabytes
+ * --nodes N    cap the state tree at N GameStates
+ * --book FILE       Polyglot .bin opening book
+ * --book-keys FILE  781 "0x..." Zobrist keys to use instead of the built-in Polyglot Random64 table
+ * --book-mode MODE  best, weighted (default) or uniform
+ * --syzygy DIR      Syzygy tablebase directory (needs a build with SYZYGY=...)
+ * --fen FEN         start from FEN instead of the initial position
+ * --trace FILE      stream the shape of every search to FILE (JSON Lines), summarize it with tracesum
+ * --search SPEC     tree (default), dfs, a depth-first alpha-beta search, or mcts, a Monte Carlo tree search, followed by any of -null, -lmr, -futility,
+ *                   -qsearch, -see, -pvs, -aspiration, -staged to switch off the depth-first search's selective techniques, e.g. "dfs,-null", or -light for random playouts
+ * --multipv K       search the best K moves for exact scores and lines (tree and depth-first search)
+ * --checkpoint K    the tree search keeps the boards of every Kth ply only and replays the moves to get the others back (default 4), 1 keeps every board
+ * --mcts-playouts N playouts per move for the Monte Carlo search (default 20000)
+ * --mcts-threads N  threads sharing the Monte Carlo search (default 1)
+ * --clock S         play on a clock of S seconds (the computer's in a game against the player, both sides' in self-play) instead of a fixed depth, see also:
+ *   --increment S     seconds added after every move
+ *   --moves-to-go N   the clock gets another S seconds every N moves (default never)
+ * --pawn-hash KB    size of the pawn structure cache (default 256), 0 turns it off
+ * --eval-cache KB   size of the evaluation cache (default 1024), 0 turns it off
+ * --analysis-cache FILE   keep the depth-first search's results in FILE from run to run (see AnalysisCache.hpp), a position already searched deep enough is answered from it, see also:
+ *   --analysis-cache-mb MB  size of FILE when it's created (default 16)
+ * --nnue FILE       evaluate with the neural network in FILE (see Nnue.hpp) instead of the hand-written evaluation
+ * --write-material-nnue FILE   write a network that only counts material to FILE and exit
+ * --mate N          look for a mate in at most N moves by the side to move (--fen, or every position of --batch FILE) and exit, see also:
+ *   --mate-nodes N    give up after N nodes per position (default no limit)
+ *   --mate-table MB   size of the proof-number table (default 64)
+ * --bench-eval FILE time the leaf evaluation over the trees of an EPD file's positions (--depth levels) and exit
+ * --batch FILE      analyse every position of an EPD file and exit, see also:
+ *   --depth N         levels per position (default 3)
+ *   --format FORMAT   csv (default) or json
+ *   --out FILE        write results to FILE instead of stdout
+ * --server          host many games over a line protocol on stdin/stdout (see Server.hpp), see also:
+ *   --threads M       worker threads shared by every game (default: number of cores)
+ *   --tt MB           size of the transposition table they share (default 64)
+ *   --slice N         nodes a search runs for before the next one in the queue gets the worker (default 20000)
+ * --annotate FILE   search every position of the games of a PGN file and write the games back with evaluations and marked mistakes, then exit, see also:
+ *   --depth N, --out FILE, --threads M   as for --batch and --selfplay
+ *   --blunder P       pawns lost against the best move that make a "??" (default 2), half that is a "?", a quarter a "?!"
+ * --selfplay N      play N engine-vs-engine games and exit, see also:
+ *   --threads M       games played at once (default: number of cores)
+ *   --white-depth N, --black-depth N   levels per move (default --depth)
+ *   --white-time S, --black-time S     seconds per move instead of a fixed depth (tree search) or --mcts-playouts (Monte Carlo search)
+ *   --white-clock S, --black-clock S   per side --clock (default --clock)
+ *   --white-search SPEC, --black-search SPEC   per side --search (default --search)
+ *   --white-eval E, --black-eval E   per side evaluation, classic or nnue (default nnue with --nnue, classic otherwise)
+ *   --openings FILE   FEN/EPD start positions, used in turn
+ *   --pgn FILE        append finished games to FILE
+ *   --max-plies N     adjudicate unfinished games as draws (default 300)
+ */
+int main(int argc, char* argv[])
 {
     StateTree st;
+    SearchTrace trace;
+    
+    BatchOptions batch;
+    batch.depth = 3;
+    batch.format = BatchFormat::CSV;
+    batch.trace = nullptr;
+    batch.nnue = nullptr;
+    
+    long memoryMegabytes = 0; // NOTE applied once every option is read, bytesPerNode() depends on --search and --checkpoint
+    
+    bool server = false;
+    long ttMegabytes = TT_DEFAULT_MB;
+    long sliceNodes = SERVER_DEFAULT_SLICE;
+    
+    AnalysisCache analysisCache;
+    std::string analysisCachePath;
+    long analysisCacheMegabytes = ANALYSIS_CACHE_DEFAULT_MB;
+    
+    AnnotateOptions annotate;
+    annotate.blunder = ANNOTATE_BLUNDER_DEFAULT;
+    
+    SelfPlayOptions selfPlay;
+    selfPlay.games = 0;
+    selfPlay.threads = (int)std::thread::hardware_concurrency();
+    selfPlay.white = SelfPlaySide{0, 0};
+    selfPlay.black = SelfPlaySide{0, 0};
+    selfPlay.maxPlies = 300;
+    std::string whiteSearch;
+    std::string blackSearch;
+    std::string benchPath;
+    NnueNetwork network;
+    std::string whiteEval;
+    std::string blackEval;
+    int mateMoves = 0;
+    long mateNodes = 0;
+    long mateTable = MATE_TABLE_DEFAULT_MB;
+    double clockSeconds = 0;
+    double whiteClockSeconds = -1; // NOTE -1 means --clock
+    double blackClockSeconds = -1;
+    double increment = 0;
+    int movesPerPeriod = 0;
+    
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if ((arg == "--mem-mb" || arg == "--nodes") && i+1 < argc)
+        {
+            long value = std::atol(argv[++i]);
+            if (value <= 0)
+            {
+                std::cout << "Budget must be positive!\n";
+                return 1;
+            }
+            if (arg == "--mem-mb") { memoryMegabytes = value; }
+            else
+            {
+                memoryMegabytes = 0;
+                st.setNodeBudget(value);
+            }
+        }
+        else if (arg == "--book" && i+1 < argc)
+        {
+            if (!st.book.open(argv[++i]))
+            {
+                std::cout << "Couldn't open book " << argv[i] << '\n';
+                return 1;
+            }
+        }
+        else if (arg == "--book-keys" && i+1 < argc)
+        {
+            if (!loadZobristKeys(argv[++i]))
+            {
+                std::cout << "Couldn't read 781 keys from " << argv[i] << '\n';
+                return 1;
+            }
+            StateTree start;
+            if (zobristKey(start.pastStates.back().get()) != POLYGLOT_START_KEY)
+            {
+                std::cout << "Warning: keys don't reproduce Polyglot's starting position key, book moves will not be found\n";
+            }
+            st.pastStates.back()->boardKey = zobristBoardKey(st.pastStates.back().get()); // NOTE computed with the old keys
+            st.pastStates.back()->positionKey = zobristKey(st.pastStates.back().get());
+        }
+        else if (arg == "--syzygy" && i+1 < argc)
+        {
+            if (!tbInit(argv[++i]))
+            {
+                std::cout << "No tablebases found in " << argv[i] << '\n';
+                return 1;
+            }
+            std::cout << "Tablebases loaded for up to " << tbLargest() << " pieces\n";
+        }
+        else if (arg == "--book-mode" && i+1 < argc)
+        {
+            std::string mode = argv[++i];
+            if (mode == "best") { st.book.policy = BookPolicy::BEST; }
+            else if (mode == "weighted") { st.book.policy = BookPolicy::WEIGHTED; }
+            else if (mode == "uniform") { st.book.policy = BookPolicy::UNIFORM; }
+            else
+            {
+                std::cout << "Unknown book mode " << mode << '\n';
+                return 1;
+            }
+        }
+        else if (arg == "--fen" && i+1 < argc)
+        {
+            if (!st.loadFEN(argv[++i]))
+            {
+                std::cout << "Bad FEN " << argv[i] << '\n';
+                return 1;
+            }
+        }
+        else if (arg == "--trace" && i+1 < argc)
+        {
+            if (!trace.open(argv[++i]))
+            {
+                std::cout << "Couldn't open " << argv[i] << '\n';
+                return 1;
+            }
+            st.trace = &trace;
+            batch.trace = &trace;
+        }
+        else if (arg == "--search" && i+1 < argc)
+        {
+            if (!parseSearchSpec(argv[++i], st.searchOptions))
+            {
+                std::cout << "Bad search " << argv[i] << '\n';
+                return 1;
+            }
+        }
+        else if (arg == "--multipv" && i+1 < argc)
+        {
+            st.searchOptions.multiPV = std::atoi(argv[++i]);
+            if (st.searchOptions.multiPV < 1)
+            {
+                std::cout << "--multipv must be positive!\n";
+                return 1;
+            }
+        }
+        else if (arg == "--checkpoint" && i+1 < argc)
+        {
+            st.searchOptions.checkpointInterval = std::atoi(argv[++i]);
+            if (st.searchOptions.checkpointInterval < 1)
+            {
+                std::cout << "--checkpoint must be positive!\n";
+                return 1;
+            }
+        }
+        else if ((arg == "--mcts-playouts" || arg == "--mcts-threads") && i+1 < argc)
+        {
+            long value = std::atol(argv[++i]);
+            if (value <= 0)
+            {
+                std::cout << arg << " must be positive!\n";
+                return 1;
+            }
+            if (arg == "--mcts-playouts") { st.searchOptions.mctsPlayouts = value; }
+            else { st.searchOptions.mctsThreads = (int)value; }
+        }
+        else if ((arg == "--clock" || arg == "--white-clock" || arg == "--black-clock" || arg == "--increment") && i+1 < argc)
+        {
+            double seconds = std::atof(argv[++i]);
+            if (seconds < 0)
+            {
+                std::cout << arg << " can't be negative!\n";
+                return 1;
+            }
+            if (arg == "--clock") { clockSeconds = seconds; }
+            else if (arg == "--white-clock") { whiteClockSeconds = seconds; }
+            else if (arg == "--black-clock") { blackClockSeconds = seconds; }
+            else { increment = seconds; }
+        }
+        else if (arg == "--moves-to-go" && i+1 < argc)
+        {
+            movesPerPeriod = std::atoi(argv[++i]);
+            if (movesPerPeriod < 0)
+            {
+                std::cout << "--moves-to-go can't be negative!\n";
+                return 1;
+            }
+        }
+        else if (arg == "--white-search" && i+1 < argc) { whiteSearch = argv[++i]; }
+        else if (arg == "--black-search" && i+1 < argc) { blackSearch = argv[++i]; }
+        else if (arg == "--pawn-hash" && i+1 < argc)
+        {
+            long kilobytes = std::atol(argv[++i]);
+            if (kilobytes < 0)
+            {
+                std::cout << "Pawn hash size can't be negative!\n";
+                return 1;
+            }
+            st.pawnHash.resize(kilobytes);
+        }
+        else if (arg == "--eval-cache" && i+1 < argc)
+        {
+            long kilobytes = std::atol(argv[++i]);
+            if (kilobytes < 0)
+            {
+                std::cout << "Evaluation cache size can't be negative!\n";
+                return 1;
+            }
+            st.evalCache.resize(kilobytes);
+        }
+        else if (arg == "--analysis-cache" && i+1 < argc) { analysisCachePath = argv[++i]; }
+        else if (arg == "--analysis-cache-mb" && i+1 < argc)
+        {
+            analysisCacheMegabytes = std::atol(argv[++i]);
+            if (analysisCacheMegabytes <= 0)
+            {
+                std::cout << "--analysis-cache-mb must be positive!\n";
+                return 1;
+            }
+        }
+        else if (arg == "--bench-eval" && i+1 < argc) { benchPath = argv[++i]; }
+        else if ((arg == "--mate" || arg == "--mate-nodes" || arg == "--mate-table") && i+1 < argc)
+        {
+            long value = std::atol(argv[++i]);
+            if (value <= 0)
+            {
+                std::cout << arg << " must be positive!\n";
+                return 1;
+            }
+            if (arg == "--mate") { mateMoves = (int)value; }
+            else if (arg == "--mate-nodes") { mateNodes = value; }
+            else { mateTable = value; }
+        }
+        else if (arg == "--nnue" && i+1 < argc)
+        {
+            if (!network.load(argv[++i]))
+            {
+                std::cout << "Couldn't load a network from " << argv[i] << '\n';
+                return 1;
+            }
+            st.nnue = &network;
+        }
+        else if (arg == "--write-material-nnue" && i+1 < argc)
+        {
+            if (!writeMaterialNetwork(argv[++i]))
+            {
+                std::cout << "Couldn't write " << argv[i] << '\n';
+                return 1;
+            }
+            return 0;
+        }
+        else if (arg == "--white-eval" && i+1 < argc) { whiteEval = argv[++i]; }
+        else if (arg == "--black-eval" && i+1 < argc) { blackEval = argv[++i]; }
+        else if (arg == "--batch" && i+1 < argc) { batch.inputPath = argv[++i]; }
+        else if (arg == "--out" && i+1 < argc) { batch.outputPath = argv[++i]; }
+        else if (arg == "--depth" && i+1 < argc)
+        {
+            batch.depth = std::atoi(argv[++i]);
+            if (batch.depth < 1)
+            {
+                std::cout << "Depth must be positive!\n";
+                return 1;
+            }
+        }
+        else if (arg == "--server") { server = true; }
+        else if (arg == "--tt" && i+1 < argc)
+        {
+            ttMegabytes = std::atol(argv[++i]);
+            if (ttMegabytes <= 0)
+            {
+                std::cout << "--tt must be positive!\n";
+                return 1;
+            }
+        }
+        else if (arg == "--slice" && i+1 < argc)
+        {
+            sliceNodes = std::atol(argv[++i]);
+            if (sliceNodes <= 0)
+            {
+                std::cout << "--slice must be positive!\n";
+                return 1;
+            }
+        }
+        else if (arg == "--annotate" && i+1 < argc) { annotate.inputPath = argv[++i]; }
+        else if (arg == "--blunder" && i+1 < argc)
+        {
+            annotate.blunder = (float)std::atof(argv[++i]);
+            if (annotate.blunder <= 0)
+            {
+                std::cout << "--blunder must be positive!\n";
+                return 1;
+            }
+        }
+        else if (arg == "--selfplay" && i+1 < argc) { selfPlay.games = std::atoi(argv[++i]); }
+        else if (arg == "--threads" && i+1 < argc) { selfPlay.threads = std::atoi(argv[++i]); }
+        else if (arg == "--white-depth" && i+1 < argc) { selfPlay.white.depth = std::atoi(argv[++i]); }
+        else if (arg == "--black-depth" && i+1 < argc) { selfPlay.black.depth = std::atoi(argv[++i]); }
+        else if (arg == "--white-time" && i+1 < argc) { selfPlay.white.seconds = std::atof(argv[++i]); }
+        else if (arg == "--black-time" && i+1 < argc) { selfPlay.black.seconds = std::atof(argv[++i]); }
+        else if (arg == "--openings" && i+1 < argc) { selfPlay.openingsPath = argv[++i]; }
+        else if (arg == "--pgn" && i+1 < argc) { selfPlay.pgnPath = argv[++i]; }
+        else if (arg == "--max-plies" && i+1 < argc) { selfPlay.maxPlies = std::atoi(argv[++i]); }
+        else if (arg == "--format" && i+1 < argc)
+        {
+            std::string format = argv[++i];
+            if (format == "csv") { batch.format = BatchFormat::CSV; }
+            else if (format == "json") { batch.format = BatchFormat::JSON; }
+            else
+            {
+                std::cout << "Unknown format " << format << '\n';
+                return 1;
+            }
+        }
+        else
+        {
+            std::cout << "Unknown option " << arg << '\n';
+            return 1;
+        }
+    }
+    
+    if (memoryMegabytes > 0) { st.setMemoryBudgetMB(memoryMegabytes); }
+    st.clock.set(clockSeconds, increment, movesPerPeriod);
+    selfPlay.white.clock.set(whiteClockSeconds >= 0 ? whiteClockSeconds : clockSeconds, increment, movesPerPeriod);
+    selfPlay.black.clock.set(blackClockSeconds >= 0 ? blackClockSeconds : clockSeconds, increment, movesPerPeriod);
+    
+    if (!benchPath.empty()) { return (benchEvaluation(benchPath, batch.depth, st.nnue) < 0 ? 1 : 0); }
+    
+    if (mateMoves > 0)
+    {
+        if (!batch.inputPath.empty()) { return (solveMates(batch.inputPath, mateMoves, mateNodes, mateTable) < 0 ? 1 : 0); }
+        MateSearch search(st, mateTable);
+        printMateResult(std::cout, search.solve(mateMoves, mateNodes), mateMoves);
+        return 0;
+    }
+    
+    if (!analysisCachePath.empty())
+    {
+        if (!analysisCache.open(analysisCachePath, analysisCacheMegabytes))
+        {
+            std::cout << "Couldn't open " << analysisCachePath << " as an analysis cache\n";
+            return 1;
+        }
+        st.analysisCache = &analysisCache;
+    }
+    
+    if (server)
+    {
+        ServerOptions options;
+        options.threads = selfPlay.threads;
+        options.ttMegabytes = ttMegabytes;
+        options.search = st.searchOptions;
+        options.nnue = st.nnue;
+        options.analysisCache = st.analysisCache;
+        options.nodeLimit = st.nodeBudget;
+        options.sliceNodes = sliceNodes;
+        return runServer(options, std::cin, std::cout);
+    }
+    
+    if (!annotate.inputPath.empty())
+    {
+        annotate.outputPath = batch.outputPath;
+        annotate.depth = batch.depth;
+        annotate.threads = selfPlay.threads;
+        annotate.nodeLimit = st.nodeBudget;
+        annotate.search = st.searchOptions;
+        annotate.nnue = st.nnue;
+        annotate.analysisCache = st.analysisCache;
+        return (runAnnotate(annotate) < 0 ? 1 : 0);
+    }
+    
+    if (selfPlay.games > 0)
+    {
+        if (selfPlay.white.depth < 1) { selfPlay.white.depth = batch.depth; }
+        if (selfPlay.black.depth < 1) { selfPlay.black.depth = batch.depth; }
+        // per side specs apply on top of --search
+        selfPlay.white.search = st.searchOptions;
+        selfPlay.black.search = st.searchOptions;
+        if (!parseSearchSpec(whiteSearch, selfPlay.white.search))
+        {
+            std::cout << "Bad search " << whiteSearch << '\n';
+            return 1;
+        }
+        if (!parseSearchSpec(blackSearch, selfPlay.black.search))
+        {
+            std::cout << "Bad search " << blackSearch << '\n';
+            return 1;
+        }
+        if ((selfPlay.white.search.depthFirst && selfPlay.white.seconds > 0) || (selfPlay.black.search.depthFirst && selfPlay.black.seconds > 0))
+        {
+            std::cout << "--white-time and --black-time need the tree search!\n";
+            return 1;
+        }
+        selfPlay.white.nnue = st.nnue;
+        selfPlay.black.nnue = st.nnue;
+        for (const std::string &eval : {whiteEval, blackEval})
+        {
+            if (!eval.empty() && eval != "classic" && !(eval == "nnue" && network.loaded()))
+            {
+                std::cout << "Bad evaluation " << eval << (eval == "nnue" ? " (needs --nnue)" : "") << '\n';
+                return 1;
+            }
+        }
+        if (!whiteEval.empty()) { selfPlay.white.nnue = (whiteEval == "nnue" ? &network : nullptr); }
+        if (!blackEval.empty()) { selfPlay.black.nnue = (blackEval == "nnue" ? &network : nullptr); }
+        selfPlay.nodeLimit = st.nodeBudget;
+        return (runSelfPlay(selfPlay) < 0 ? 1 : 0);
+    }
+    
+    if (!batch.inputPath.empty())
+    {
+        batch.nodeLimit = st.nodeBudget;
+        batch.search = st.searchOptions;
+        batch.nnue = st.nnue;
+        batch.analysisCache = st.analysisCache;
+        return (runBatch(batch) < 0 ? 1 : 0);
+    }
     
     char playerIsWhite;
     std::string str1;
@@ -39,18 +519,20 @@ int main()
     }
     
     int levels;
+    int maxLevels = (st.searchOptions.depthFirst || st.searchOptions.mcts ? 8 : 4); // NOTE the depth-first search doesn't keep the tree in memory, the Monte Carlo search ignores levels
     std::string str2;
-    std::cout << "Number of computer levels? (between 1 and 4, inclusive): ";
+    std::cout << "Number of computer levels? (between 1 and " << maxLevels << ", inclusive): ";
     std::getline(std::cin, str2);
-    levels = std::stoi(str2);
+    levels = std::atoi(str2.c_str()); // NOTE 0 for anything that isn't a number, which is rejected below
     
-    if (levels < 1 || levels > 4)
+    if (levels < 1 || levels > maxLevels)
     {
         std::cout << "Can't do that!\n";
         return 1;
     }
+    st.searchOptions.depth = levels;
     
-    st.genLevels(levels);
+    growTree(st, levels);
     
     st.printCurrent();
     
@@ -60,45 +542,89 @@ int main()
         if (playerIsWhite == 'n')
         {
             st.pushComputerState();
+            printStats(st);
             std::cout << st.moveList.back();
             st.printCurrent();
             std::cout << st.pastStates[st.pastStates.size()-1]->evaluation << '\n';
-            st.genLevels(1);
+            growTree(st, levels);
         }
         
         bool validMove = false;
         while (!validMove)
         {
             int x1,y1,x2,y2;
-            getPlayerMove(x1,y1,x2,y2);
+            getPlayerMove(st,x1,y1,x2,y2);
             validMove = st.pushPlayerState(x1,y1,x2,y2);
             st.printCurrent();
             std::cout << st.pastStates[st.pastStates.size()-1]->evaluation << '\n';
         }
-        st.genLevels(1);
+        growTree(st, levels);
         
         if (playerIsWhite == 'y')
         {
             st.pushComputerState();
+            printStats(st);
             st.printCurrent();
             std::cout << st.pastStates[st.pastStates.size()-1]->evaluation << '\n';
-            st.genLevels(1);
+            growTree(st, levels);
         }
     }
     
     return 0;
 }
 
-void getPlayerMove(int &_x1, int &_y1, int &_x2, int &_y2)
+void growTree(StateTree &_st, int _levels)
+{
+    // while in book the computer's reply needs no search, one level is enough to verify moves against, the depth-first search never needs more
+    // and on a clock pushComputerState() grows the tree search's tree for as long as the move's time allows
+    _st.genToDepth(_st.inBook() || _st.searchOptions.depthFirst || _st.searchOptions.mcts || _st.clock.running() ? 1 : _levels);
+    reportBudget(_st);
+}
+
+void reportBudget(StateTree &_st)
+{
+    if (_st.budgetReached)
+    {
+        std::cout << "Memory budget reached: " << _st.liveNodes << " nodes (~" << _st.liveNodes*_st.bytesPerNode()/(1024*1024) << " MB), searching the partial tree\n";
+    }
+}
+
+void printStats(StateTree &_st)
+{
+    // NOTE covers everything since the last computer move, including the levels generated while the player was to move
+    if (SEARCH_STATS_ENABLED)
+    {
+        _st.stats.print(std::cout);
+        _st.stats.reset();
+        std::cout << "Pawn hash: " << 100*_st.pawnHash.hitRate() << "% hits\n";
+        std::cout << "Evaluation cache: " << _st.evalCache.hits << " hits, " << _st.evalCache.misses << " misses (" << 100*_st.evalCache.hitRate() << "%)\n";
+        _st.pawnHash.hits = 0;
+        _st.pawnHash.misses = 0;
+        _st.evalCache.hits = 0;
+        _st.evalCache.misses = 0;
+    }
+}
+
+void getPlayerMove(StateTree &_st, int &_x1, int &_y1, int &_x2, int &_y2)
 {
     std::string move1;
     std::string move2;
-    std::cout << "Move From\n>";
-    std::getline(std::cin, move1);
-    _x1 = (int)move1[0] - 'A';
-    _y1 = (int)move1[1] - '0'-1;
+    std::cout << "Move (e.g. Nf3, O-O, e2e4) or Move From\n>";
+    if (!std::getline(std::cin, move1)) { std::exit(0); } // NOTE input closed, there's no one left to play
+    Move move;
+    if (parseMove(_st.pastStates.back().get(), move1, move))
+    {
+        _x1 = move.x1;
+        _y1 = move.y1;
+        _x2 = move.x2;
+        _y2 = move.y2;
+        return;
+    }
+    // NOTE anything too short to be a square comes out as -1, off the board, and pushPlayerState() asks again
+    _x1 = (move1.size() >= 2 ? (int)move1[0] - 'A' : -1);
+    _y1 = (move1.size() >= 2 ? (int)move1[1] - '0'-1 : -1);
     std::cout << "Move To\n>";
-    std::getline(std::cin, move2);
-    _x2 = (int)move2[0] - 'A';
-    _y2 = (int)move2[1] - '0'-1;
+    if (!std::getline(std::cin, move2)) { std::exit(0); }
+    _x2 = (move2.size() >= 2 ? (int)move2[0] - 'A' : -1);
+    _y2 = (move2.size() >= 2 ? (int)move2[1] - '0'-1 : -1);
 }
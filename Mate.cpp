@@ -0,0 +1,301 @@
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <iostream>
+#include <fstream>
+
+#include "Mate.hpp"
+#include "Notation.hpp"
+
+MateTable::MateTable(long _megabytes)
+{
+    long wanted = std::max(_megabytes, 1L)*1024*1024 / (long)sizeof(MateEntry);
+    long entries = 2;
+    while (entries*2 <= wanted) { entries *= 2; }
+    table.assign(entries, MateEntry{0, 0, 0, 0});
+}
+
+bool MateTable::lookup(uint64_t _key, uint32_t &_proof, uint32_t &_disproof, uint32_t &_work) const
+{
+    uint64_t bucket = _key & (table.size()-2);
+    for (uint64_t i = bucket; i < bucket+2; i++)
+    {
+        const MateEntry &entry = table[i];
+        if (entry.key != _key || (entry.proof == 0 && entry.disproof == 0)) { continue; } // NOTE 0 and 0 never gets stored, it marks an empty slot
+        _proof = entry.proof;
+        _disproof = entry.disproof;
+        _work = entry.work;
+        return true;
+    }
+    return false;
+}
+
+void MateTable::store(uint64_t _key, uint32_t _proof, uint32_t _disproof, uint32_t _work)
+{
+    // NOTE replacing the cheaper entry keeps the tiny positions near the leaves from pushing out the ones it took a long search to settle,
+    // with a single slot a descendant could keep evicting a child of the node being searched and the search would go round in circles
+    uint64_t bucket = _key & (table.size()-2);
+    MateEntry* slot = &table[bucket];
+    if (table[bucket+1].key == _key || (slot->key != _key && table[bucket+1].work < slot->work)) { slot = &table[bucket+1]; }
+    *slot = MateEntry{_key, _proof, _disproof, _work};
+}
+
+void MateTable::clear()
+{
+    std::fill(table.begin(), table.end(), MateEntry{0, 0, 0, 0});
+}
+
+MateSearch::MateSearch(StateTree &_st, long _tableMegabytes) : st(_st), table(_tableMegabytes)
+{
+    attackerWhite = true;
+    nodes = 0;
+    maxNodes = 0;
+}
+
+MateResult MateSearch::solve(int _maxMoves, long _maxNodes)
+{
+    auto start = std::chrono::steady_clock::now();
+    GameState* root = st.pastStates.back().get();
+    attackerWhite = root->whiteTurn;
+    nodes = 0;
+    maxNodes = _maxNodes;
+    table.clear();
+    
+    MateResult result;
+    result.mateIn = 0;
+    result.ruledOut = 0;
+    result.exhausted = false;
+    for (int moves = 1; moves <= _maxMoves; moves++)
+    {
+        mid(root, moves, PROOF_INFINITY, PROOF_INFINITY);
+        uint32_t proof, disproof;
+        numbers(root, moves, proof, disproof);
+        if (proof == 0)
+        {
+            result.mateIn = moves;
+            break;
+        }
+        if (disproof != 0)
+        {
+            result.exhausted = true; // neither proven nor disproven, the node limit hit
+            break;
+        }
+        result.ruledOut = moves;
+    }
+    
+    // the line, attacker's quickest mate against the defender's longest resistance
+    GameState* gs = root;
+    int movesLeft = result.mateIn;
+    while (result.mateIn > 0 && legalChildren(gs))
+    {
+        bool attacking = (gs->whiteTurn == attackerWhite);
+        int childMoves = (attacking ? movesLeft-1 : movesLeft);
+        int pick = -1;
+        int pickMoves = 0;
+        for (int i = 0; i < (int)gs->nextLevel.size(); i++)
+        {
+            int moves = shortestMate(gs->nextLevel[i].get(), childMoves);
+            if (moves >= 0 && (pick == -1 || (attacking ? moves < pickMoves : moves > pickMoves)))
+            {
+                pick = i;
+                pickMoves = moves;
+            }
+        }
+        if (pick == -1) { break; } // NOTE only if the node limit stopped a re-search
+        
+        GameState* child = gs->nextLevel[pick].get();
+        result.line.push_back(Move{child->fromX, child->fromY, child->toX, child->toY});
+        gs = child;
+        movesLeft = pickMoves;
+    }
+    root->nextLevel.clear();
+    
+    result.nodes = nodes;
+    result.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+void MateSearch::mid(GameState* _gs, int _movesLeft, uint32_t _proofThreshold, uint32_t _disproofThreshold)
+{
+    long startNodes = nodes;
+    nodes++;
+    bool attacking = (_gs->whiteTurn == attackerWhite);
+    if (attacking && _movesLeft == 0)
+    {
+        store(_gs, _movesLeft, PROOF_INFINITY, 0, startNodes);
+        return;
+    }
+    // the attacker's last move has to give check, otherwise there's no need to look at the defender's replies
+    if (!attacking && _movesLeft == 0 && !kingAttacked(_gs, _gs->whiteTurn))
+    {
+        store(_gs, _movesLeft, PROOF_INFINITY, 0, startNodes);
+        return;
+    }
+    if (!legalChildren(_gs))
+    {
+        bool mated = !attacking && kingAttacked(_gs, _gs->whiteTurn);
+        store(_gs, _movesLeft, (mated ? 0 : PROOF_INFINITY), (mated ? PROOF_INFINITY : 0), startNodes);
+        return;
+    }
+    
+    int childMoves = (attacking ? _movesLeft-1 : _movesLeft);
+    while (true)
+    {
+        // an attacking node needs one child proven and all of them disproven, a defending node the other way round
+        uint32_t proof = (attacking ? PROOF_INFINITY : 0);
+        uint32_t disproof = (attacking ? 0 : PROOF_INFINITY);
+        uint32_t bestNumber = PROOF_INFINITY;
+        uint32_t secondNumber = PROOF_INFINITY;
+        uint32_t bestProof = 0, bestDisproof = 0;
+        int best = -1;
+        for (int i = 0; i < (int)_gs->nextLevel.size(); i++)
+        {
+            uint32_t childProof, childDisproof;
+            numbers(_gs->nextLevel[i].get(), childMoves, childProof, childDisproof);
+            uint32_t number = (attacking ? childProof : childDisproof);
+            if (attacking)
+            {
+                proof = std::min(proof, childProof);
+                disproof = std::min(disproof + childDisproof, PROOF_INFINITY);
+            }
+            else
+            {
+                proof = std::min(proof + childProof, PROOF_INFINITY);
+                disproof = std::min(disproof, childDisproof);
+            }
+            if (best == -1 || number < bestNumber)
+            {
+                secondNumber = bestNumber;
+                bestNumber = number;
+                bestProof = childProof;
+                bestDisproof = childDisproof;
+                best = i;
+            }
+            else if (number < secondNumber) { secondNumber = number; }
+        }
+        
+        if (proof >= _proofThreshold || disproof >= _disproofThreshold || (maxNodes > 0 && nodes >= maxNodes))
+        {
+            store(_gs, _movesLeft, proof, disproof, startNodes);
+            break;
+        }
+        
+        // the best child may go on until it stops being the best, or until its parent would cross a threshold
+        uint32_t childProofThreshold, childDisproofThreshold;
+        if (attacking)
+        {
+            childProofThreshold = std::min(_proofThreshold, secondNumber + 1);
+            childDisproofThreshold = std::min(_disproofThreshold - disproof + bestDisproof, PROOF_INFINITY);
+        }
+        else
+        {
+            childProofThreshold = std::min(_proofThreshold - proof + bestProof, PROOF_INFINITY);
+            childDisproofThreshold = std::min(_disproofThreshold, secondNumber + 1);
+        }
+        mid(_gs->nextLevel[best].get(), childMoves, childProofThreshold, childDisproofThreshold);
+    }
+    _gs->nextLevel.clear();
+}
+
+bool MateSearch::legalChildren(GameState* _gs)
+{
+    _gs->nextLevel.clear();
+    st.genChildren(_gs);
+    bool white = _gs->whiteTurn;
+    auto illegal = [white](const std::unique_ptr<GameState> &_child) { return kingAttacked(_child.get(), white); };
+    _gs->nextLevel.erase(std::remove_if(_gs->nextLevel.begin(), _gs->nextLevel.end(), illegal), _gs->nextLevel.end());
+    return !_gs->nextLevel.empty();
+}
+
+void MateSearch::numbers(GameState* _gs, int _movesLeft, uint32_t &_proof, uint32_t &_disproof)
+{
+    // a draw (see genChildren()) or an attacker out of moves can't be mate
+    if (_gs->resolved || (_gs->whiteTurn == attackerWhite && _movesLeft == 0))
+    {
+        _proof = PROOF_INFINITY;
+        _disproof = 0;
+        return;
+    }
+    uint32_t work;
+    if (!table.lookup(key(_gs, _movesLeft), _proof, _disproof, work))
+    {
+        _proof = 1;
+        _disproof = 1;
+    }
+}
+
+void MateSearch::store(GameState* _gs, int _movesLeft, uint32_t _proof, uint32_t _disproof, long _startNodes)
+{
+    uint64_t positionKey = key(_gs, _movesLeft);
+    uint32_t proof, disproof, work = 0;
+    table.lookup(positionKey, proof, disproof, work);
+    table.store(positionKey, _proof, _disproof, (uint32_t)std::min((long)work + (nodes - _startNodes), (long)UINT32_MAX));
+}
+
+uint64_t MateSearch::key(const GameState* _gs, int _movesLeft) const
+{
+    return _gs->positionKey ^ (0x9E3779B97F4A7C15ULL * (uint64_t)(_movesLeft + 1));
+}
+
+int MateSearch::shortestMate(GameState* _gs, int _maxMoves)
+{
+    for (int moves = 0; moves <= _maxMoves; moves++)
+    {
+        uint32_t proof, disproof;
+        numbers(_gs, moves, proof, disproof);
+        if (proof != 0 && disproof != 0)
+        {
+            mid(_gs, moves, PROOF_INFINITY, PROOF_INFINITY);
+            numbers(_gs, moves, proof, disproof);
+        }
+        if (proof == 0) { return moves; }
+    }
+    return -1;
+}
+
+void printMateResult(std::ostream &_out, const MateResult &_result, int _maxMoves)
+{
+    if (_result.mateIn > 0) { _out << "mate in " << _result.mateIn << ": " << uciLine(_result.line); }
+    else if (_result.exhausted && _result.ruledOut > 0) { _out << "node limit reached, no mate within " << _result.ruledOut << ", " << _result.ruledOut+1 << " to " << _maxMoves << " undecided"; }
+    else if (_result.exhausted) { _out << "node limit reached, no mate found"; }
+    else { _out << "no mate within " << _maxMoves; }
+    _out << " (" << _result.nodes << " nodes, " << _result.ms << " ms)\n";
+}
+
+int solveMates(const std::string &_inputPath, int _maxMoves, long _maxNodes, long _tableMegabytes)
+{
+    std::ifstream input(_inputPath);
+    if (!input)
+    {
+        std::cerr << "Couldn't open " << _inputPath << '\n';
+        return -1;
+    }
+    
+    StateTree st;
+    MateSearch search(st, _tableMegabytes); // NOTE one table for the whole file, solve() clears it
+    int solved = 0;
+    std::string line;
+    long lineNumber = 0;
+    while (std::getline(input, line))
+    {
+        lineNumber++;
+        if (line.empty() || line[0] == '#' || line.find_first_not_of(" \t\r") == std::string::npos) { continue; }
+        
+        GameState position(nullptr);
+        std::string id;
+        if (!parseEPD(line, &position, id))
+        {
+            std::cerr << "Skipping malformed line " << lineNumber << '\n';
+            continue;
+        }
+        
+        st.loadFEN(toFEN(&position));
+        std::cout << (id.empty() ? "line " + std::to_string(lineNumber) : id) << ": ";
+        printMateResult(std::cout, search.solve(_maxMoves, _maxNodes), _maxMoves);
+        solved++;
+    }
+    return solved;
+}
@@ -0,0 +1,89 @@
+#ifndef MATE_HPP
+#define MATE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include "StateTree.hpp"
+
+/* Mate search, depth-first proof-number search (df-pn)
+ *
+ * The side to move is the attacker. A position is proven when the attacker can force checkmate within the moves it has left and disproven when it can't
+ * (the defender escapes, stalemates or repeats). Each node carries a proof number and a disproof number, the fewest leaves that still have to be shown to
+ * prove or disprove it, and the search always works on the child most likely to settle its parent, going as deep as that takes. Unlike the
+ * alpha-beta search the moves are legal ones, a position where the defender has no legal move is mate if it is in check and stalemate otherwise.
+ *
+ * Proof and disproof numbers are kept in a MateTable, keyed by position and moves left, so a move order that transposes into a known position costs nothing.
+ * Mates are looked for one move longer at a time so the first one proven is the shortest.
+*/
+
+const uint32_t PROOF_INFINITY = 100000000;
+const long MATE_TABLE_DEFAULT_MB = 64;
+
+struct MateEntry
+{
+    uint64_t key; // position key mixed with the moves left
+    uint32_t proof;
+    uint32_t disproof;
+    uint32_t work; // nodes spent on it so far, the cheaper entry of a bucket is the one replaced
+};
+
+class MateTable
+{
+public:
+    MateTable(long _megabytes); // rounded down to a power of two entries, two to a bucket
+    
+    bool lookup(uint64_t _key, uint32_t &_proof, uint32_t &_disproof, uint32_t &_work) const;
+    
+    void store(uint64_t _key, uint32_t _proof, uint32_t _disproof, uint32_t _work); // replaces _key's own entry, else the bucket's cheaper one
+    
+    void clear();
+
+private:
+    std::vector<MateEntry> table;
+};
+
+struct MateResult
+{
+    int mateIn; // moves, 0 if no mate was proven
+    int ruledOut; // moves there is proven to be no mate within, 0 if none
+    bool exhausted; // the node limit stopped the search, a mate may still exist within the moves asked for
+    std::vector<Move> line; // attacker's moves and the defender's longest replies, ending in mate
+    long nodes;
+    double ms;
+};
+
+class MateSearch
+{
+public:
+    MateSearch(StateTree &_st, long _tableMegabytes);
+    
+    MateResult solve(int _maxMoves, long _maxNodes); // looks for a mate by the side to move in _st's current state, _maxNodes 0 means no limit
+
+private:
+    void mid(GameState* _gs, int _movesLeft, uint32_t _proofThreshold, uint32_t _disproofThreshold); // expands _gs until its numbers reach one of the thresholds, then stores them
+    
+    bool legalChildren(GameState* _gs); // generates _gs's children and drops the ones leaving the mover's king attacked, false if none are left
+    
+    void numbers(GameState* _gs, int _movesLeft, uint32_t &_proof, uint32_t &_disproof); // what the table knows about _gs, 1 and 1 if nothing
+    
+    void store(GameState* _gs, int _movesLeft, uint32_t _proof, uint32_t _disproof, long _startNodes); // adds the nodes since _startNodes to _gs's work
+    
+    uint64_t key(const GameState* _gs, int _movesLeft) const;
+    
+    int shortestMate(GameState* _gs, int _maxMoves); // fewest moves (up to _maxMoves) _gs is proven in, -1 if it isn't
+    
+    StateTree &st;
+    MateTable table;
+    bool attackerWhite;
+    long nodes;
+    long maxNodes;
+};
+
+void printMateResult(std::ostream &_out, const MateResult &_result, int _maxMoves); // "mate in 2: d5f6 g7f6 e5f7 (1234 nodes, 5.6 ms)" or why there's none
+
+int solveMates(const std::string &_inputPath, int _maxMoves, long _maxNodes, long _tableMegabytes); // solves every position of an EPD file, returns how many or -1 if it can't be read
+
+#endif
@@ -0,0 +1,60 @@
+#include <string>
+#include <iostream>
+
+#include "StateTree.hpp"
+#include "Mate.hpp"
+
+/*
+ * matetest - checks the df-pn mate search against rook endings whose distance to mate was worked out by retrograde analysis
+ *
+ * Usage: make test
+ *
+ * Prints every position with its result and exits with 1 if any was solved wrong, each one gets MATE_TEST_NODES nodes
+ */
+
+const long MATE_TEST_NODES = 5000000;
+
+struct MateCase
+{
+    const char* fen;
+    int maxMoves;
+    int expected; // mate in, 0 for no mate within maxMoves
+};
+
+const MateCase MATE_CASES[] = {
+    {"4k3/8/2R5/3K4/8/8/8/8 w - - 0 1", 5, 5},
+    {"8/6k1/8/8/4K3/4R3/8/8 w - - 0 1", 6, 6},
+    {"8/8/8/8/2R5/k7/4K3/8 w - - 0 1", 6, 6}, // went round in circles while the mate table had one entry per slot
+    {"8/8/8/7k/8/8/4K3/4R3 w - - 0 1", 7, 7},
+    {"8/5k2/8/8/5K2/8/6R1/8 w - - 0 1", 8, 8},
+    {"8/8/3k4/8/3K4/8/8/7R w - - 0 1", 8, 0}, // mate in 10
+};
+
+int main()
+{
+    int failures = 0;
+    StateTree st;
+    MateSearch search(st, MATE_TABLE_DEFAULT_MB);
+    
+    for (const MateCase &test : MATE_CASES)
+    {
+        if (!st.loadFEN(test.fen))
+        {
+            std::cout << " ##### FAIL can't set up " << test.fen << " ##### \n";
+            failures++;
+            continue;
+        }
+        MateResult result = search.solve(test.maxMoves, MATE_TEST_NODES);
+        std::cout << test.fen << ": ";
+        printMateResult(std::cout, result, test.maxMoves);
+        if (result.exhausted || result.mateIn != test.expected)
+        {
+            std::cout << " ##### FAIL expected " << (test.expected > 0 ? "mate in " + std::to_string(test.expected) : "no mate within " + std::to_string(test.maxMoves)) << " ##### \n";
+            failures++;
+        }
+    }
+    
+    int total = (int)(sizeof(MATE_CASES)/sizeof(MATE_CASES[0]));
+    std::cout << total-failures << "/" << total << " mate checks passed\n";
+    return (failures == 0 ? 0 : 1);
+}
@@ -0,0 +1,303 @@
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+#include "StateTree.hpp"
+#include "Mcts.hpp"
+#include "Notation.hpp"
+#include "See.hpp"
+
+// everything a search thread owns
+struct MctsWorker
+{
+    StateTree gen; // generates and evaluates for the thread, its pastStates hold the playout in progress
+    std::mt19937 rng;
+    std::vector<GameState*> path;
+};
+
+// the search as all of its threads see it
+struct MctsShared
+{
+    GameState* root;
+    long playouts;
+    double seconds;
+    long nodeLimit; // 0 means unlimited
+    bool light;
+    std::chrono::steady_clock::time_point start;
+    std::atomic<long> started;
+    std::atomic<long> finished;
+    std::atomic<long> created; // GameStates added to the tree
+};
+
+// generates _gs's children and drops the ones leaving the mover's king attacked
+static void legalChildren(StateTree &_gen, GameState* _gs)
+{
+    _gen.genChildren(_gs);
+    bool white = _gs->whiteTurn;
+    auto illegal = [white](const std::unique_ptr<GameState> &_child) { return kingAttacked(_child.get(), white); };
+    _gs->nextLevel.erase(std::remove_if(_gs->nextLevel.begin(), _gs->nextLevel.end(), illegal), _gs->nextLevel.end());
+}
+
+// gives _gs its children unless another thread got there first
+static void expand(StateTree &_gen, GameState* _gs, std::atomic<long> &_created)
+{
+    MctsState leaf = MctsState::LEAF;
+    if (!_gs->mcts->state.compare_exchange_strong(leaf, MctsState::EXPANDING)) { return; }
+    
+    _gs->nextLevel.clear(); // NOTE a tree search can have left children without MctsNodes
+    legalChildren(_gen, _gs);
+    for (int i = 0; i < (int)_gs->nextLevel.size(); i++)
+    {
+        GameState* child = _gs->nextLevel[i].get();
+        child->mcts.reset(new MctsNode());
+        if (child->resolved)
+        {
+            child->mcts->terminalScore = 0.5;
+            child->mcts->state.store(MctsState::TERMINAL);
+        }
+    }
+    _created += (long)_gs->nextLevel.size();
+    
+    if (_gs->nextLevel.empty())
+    {
+        _gs->mcts->terminalScore = (kingAttacked(_gs, _gs->whiteTurn) ? 1 : 0.5); // the side that moved here mated or stalemated
+        _gs->mcts->state.store(MctsState::TERMINAL, std::memory_order_release);
+    }
+    else { _gs->mcts->state.store(MctsState::EXPANDED, std::memory_order_release); }
+}
+
+// UCT, with the virtual losses of other threads counted in
+static GameState* selectChild(GameState* _gs)
+{
+    int parentVisits = _gs->mcts->visits.load() + _gs->mcts->virtualLoss.load();
+    float logVisits = std::log((float)std::max(parentVisits, 1));
+    GameState* best = nullptr;
+    float bestValue = -1;
+    for (int i = 0; i < (int)_gs->nextLevel.size(); i++)
+    {
+        GameState* child = _gs->nextLevel[i].get();
+        int visits = child->mcts->visits.load() + child->mcts->virtualLoss.load();
+        if (visits == 0) { return child; } // NOTE unvisited children first, in generation order
+        
+        float value = (float)child->mcts->score.load() / MCTS_SCORE_UNIT / visits + MCTS_EXPLORATION*std::sqrt(logVisits / visits);
+        if (value > bestValue)
+        {
+            bestValue = value;
+            best = child;
+        }
+    }
+    return best;
+}
+
+// white's score for a short game from _from
+static float playout(MctsWorker &_worker, const GameState* _from, bool _light)
+{
+    StateTree &gen = _worker.gen;
+    gen.loadFEN(toFEN(_from)); // NOTE detached from the shared tree, repetitions before _from are forgotten
+    GameState* gs = gen.pastStates.back().get();
+    std::uniform_real_distribution<float> chance(0, 1);
+    
+    for (int ply = 0; ply < MCTS_PLAYOUT_PLIES; ply++)
+    {
+        gen.genChildren(gs);
+        std::vector<std::unique_ptr<GameState>> &children = gs->nextLevel;
+        bool capture = (_light && chance(_worker.rng) < MCTS_CAPTURE_CHANCE);
+        int pick = -1;
+        while (!children.empty())
+        {
+            pick = (int)(_worker.rng() % children.size());
+            if (capture)
+            {
+                for (int i = 0; i < (int)children.size(); i++)
+                {
+                    if (seeValue(children[i]->captured) > seeValue(children[pick]->captured)) { pick = i; }
+                }
+            }
+            if (!kingAttacked(children[pick].get(), gs->whiteTurn)) { break; }
+            children.erase(children.begin() + pick);
+            pick = -1;
+        }
+        
+        if (pick == -1)
+        {
+            if (!kingAttacked(gs, gs->whiteTurn)) { return 0.5; }
+            return (gs->whiteTurn ? 0 : 1);
+        }
+        if (children[pick]->resolved) { return 0.5; }
+        
+        std::unique_ptr<GameState> chosen = std::move(children[pick]);
+        children.clear();
+        children.push_back(std::move(chosen));
+        gs = children.back().get();
+    }
+    
+    gen.cachedEvaluate(gs);
+    return 1 / (1 + std::pow(10.0f, -gs->evaluation / MCTS_EVAL_SCALE));
+}
+
+static bool outOfTime(const MctsShared &_shared)
+{
+    return (_shared.seconds > 0 && std::chrono::duration<double>(std::chrono::steady_clock::now() - _shared.start).count() >= _shared.seconds);
+}
+
+static void searchThread(MctsShared &_shared, MctsWorker &_worker)
+{
+    while (_shared.started++ < _shared.playouts && !outOfTime(_shared))
+    {
+        // selection
+        std::vector<GameState*> &path = _worker.path;
+        path.clear();
+        GameState* gs = _shared.root;
+        gs->mcts->virtualLoss++;
+        path.push_back(gs);
+        while (gs->mcts->state.load(std::memory_order_acquire) == MctsState::EXPANDED)
+        {
+            gs = selectChild(gs);
+            gs->mcts->virtualLoss++;
+            path.push_back(gs);
+        }
+        
+        // expansion, a GameState gets children the second time a playout ends on it
+        bool room = (_shared.nodeLimit == 0 || _shared.created.load() < _shared.nodeLimit);
+        if (gs->mcts->state.load() == MctsState::LEAF && gs->mcts->visits.load() > 0 && room)
+        {
+            expand(_worker.gen, gs, _shared.created);
+            if (gs->mcts->state.load(std::memory_order_acquire) == MctsState::EXPANDED)
+            {
+                gs = selectChild(gs);
+                gs->mcts->virtualLoss++;
+                path.push_back(gs);
+            }
+        }
+        
+        // simulation
+        float white;
+        if (gs->mcts->state.load(std::memory_order_acquire) == MctsState::TERMINAL)
+        {
+            float score = gs->mcts->terminalScore;
+            white = (gs->whiteTurn ? 1-score : score);
+        }
+        else { white = playout(_worker, gs, _shared.light); }
+        
+        // backpropagation
+        for (GameState* node : path)
+        {
+            float score = (node->whiteTurn ? 1-white : white); // NOTE for the side that moved into node
+            node->mcts->score += (int64_t)(score * MCTS_SCORE_UNIT);
+            node->mcts->visits++;
+            node->mcts->virtualLoss--;
+        }
+        _shared.finished++;
+    }
+}
+
+// (recursive) turns GameStates whose children another search has replaced or freed back into leaves, so the tree kept from the last search can be trusted
+static void dropStale(GameState* _gs)
+{
+    if (_gs->mcts->state.load() != MctsState::EXPANDED) { return; }
+    bool stale = _gs->nextLevel.empty();
+    for (int i = 0; i < (int)_gs->nextLevel.size(); i++)
+    {
+        if (_gs->nextLevel[i]->mcts == nullptr) { stale = true; }
+    }
+    if (stale)
+    {
+        _gs->mcts->state.store(MctsState::LEAF);
+        return;
+    }
+    for (int i = 0; i < (int)_gs->nextLevel.size(); i++) { dropStale(_gs->nextLevel[i].get()); }
+}
+
+// most visited child, nullptr if there are none
+static GameState* mostVisited(GameState* _gs)
+{
+    if (_gs->mcts == nullptr || _gs->mcts->state.load() != MctsState::EXPANDED) { return nullptr; }
+    GameState* best = nullptr;
+    for (int i = 0; i < (int)_gs->nextLevel.size(); i++)
+    {
+        GameState* child = _gs->nextLevel[i].get();
+        if (best == nullptr || child->mcts->visits.load() > best->mcts->visits.load()) { best = child; }
+    }
+    return best;
+}
+
+int StateTree::searchMcts(long _playouts, double _seconds)
+{
+    STATS_TIME(stats.minimaxTicks);
+    GameState* root = pastStates.back().get();
+    
+    MctsShared shared;
+    shared.root = root;
+    shared.playouts = (_playouts > 0 ? _playouts : (_seconds > 0 ? std::numeric_limits<long>::max() : 1));
+    shared.seconds = _seconds;
+    shared.nodeLimit = (nodeBudget > 0 ? std::max(nodeBudget - liveNodes, 0L) : 0);
+    shared.light = searchOptions.lightPlayouts;
+    shared.start = std::chrono::steady_clock::now();
+    shared.started = 0;
+    shared.finished = 0;
+    shared.created = 0;
+    
+    int threads = std::max(searchOptions.mctsThreads, 1);
+    std::vector<std::unique_ptr<MctsWorker>> workers;
+    for (int i = 0; i < threads; i++)
+    {
+        workers.push_back(std::unique_ptr<MctsWorker>(new MctsWorker()));
+        MctsWorker &worker = *workers.back();
+        worker.gen.pawnStructure = pawnStructure;
+        worker.gen.nnue = nnue;
+        worker.rng.seed(std::random_device{}() + i);
+    }
+    
+    // the root is expanded before the threads start so they all have somewhere to go
+    if (root->mcts == nullptr) { root->mcts.reset(new MctsNode()); }
+    dropStale(root);
+    if (root->mcts->state.load() != MctsState::EXPANDED)
+    {
+        root->mcts->state.store(MctsState::LEAF);
+        expand(workers[0]->gen, root, shared.created);
+    }
+    if (root->mcts->state.load() != MctsState::EXPANDED) { return -1; }
+    
+    std::vector<std::thread> pool;
+    for (int i = 1; i < threads; i++) { pool.emplace_back(searchThread, std::ref(shared), std::ref(*workers[i])); }
+    searchThread(shared, *workers[0]);
+    for (std::thread &thread : pool) { thread.join(); }
+    
+    mctsPlayouts = shared.finished.load();
+    mctsMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - shared.start).count();
+    liveNodes += shared.created.load();
+    budgetReached = (shared.nodeLimit > 0 && shared.created.load() >= shared.nodeLimit);
+    
+    // white-relative evaluations in pawns, the inverse of the playout scoring, for the callers that print or compare them
+    GameState* best = mostVisited(root);
+    int bestIndex = -1;
+    for (int i = 0; i < (int)root->nextLevel.size(); i++)
+    {
+        GameState* child = root->nextLevel[i].get();
+        const MctsNode &node = *child->mcts;
+        if (node.state.load() == MctsState::TERMINAL && node.terminalScore == 1) { child->evaluation = (root->whiteTurn ? MATE_EVALUATION : -MATE_EVALUATION); }
+        else if (node.visits.load() > 0)
+        {
+            float score = (float)node.score.load() / MCTS_SCORE_UNIT / node.visits.load();
+            float white = std::min(std::max(root->whiteTurn ? score : 1-score, 0.001f), 0.999f);
+            child->evaluation = -MCTS_EVAL_SCALE * std::log10(1/white - 1);
+        }
+        if (child == best) { bestIndex = i; }
+    }
+    root->evaluation = root->nextLevel[bestIndex]->evaluation;
+    
+    principalVariation.clear();
+    for (GameState* gs = root; mostVisited(gs) != nullptr; gs = mostVisited(gs))
+    {
+        GameState* child = mostVisited(gs);
+        principalVariation.push_back(Move{child->fromX, child->fromY, child->toX, child->toY});
+    }
+    return bestIndex;
+}
@@ -0,0 +1,41 @@
+#ifndef MCTS_HPP
+#define MCTS_HPP
+
+#include <atomic>
+#include <cstdint>
+
+/* Monte Carlo tree search, see StateTree::searchMcts()
+ *
+ * Every playout walks down the tree under the current state picking the child with the best UCT value (average score plus an exploration bonus that shrinks
+ * with its visits), expands the GameState it ends on once that has been played out before, plays a short game from there and adds the result to every
+ * GameState on the way back up. Only legal moves go into the tree, so a GameState without children is checkmate or stalemate and scored as such.
+ *
+ * Playouts stop after MCTS_PLAYOUT_PLIES and score the position they reached with the evaluation, squashed to white's chance of winning. Light playouts
+ * capture the most valuable piece they can half the time and play a random move otherwise, uniformly random playouts (search spec "-light") are cheaper
+ * but see far less.
+ *
+ * Threads share the tree. Counts are atomic, a GameState is expanded by whichever thread claims it first (the others play out from it in the meantime) and
+ * each thread adds a virtual loss to the GameStates it is walking through, so the other threads spread out to different lines instead of all following it.
+ * Each thread generates and evaluates with its own StateTree, the shared one is only read until the search is over.
+*/
+
+const float MCTS_EXPLORATION = 1.2; // UCT constant, scores are 0..1
+const int MCTS_PLAYOUT_PLIES = 16;
+const float MCTS_EVAL_SCALE = 4; // in pawns, an evaluation of MCTS_EVAL_SCALE is a 10 to 1 chance of winning
+const float MCTS_CAPTURE_CHANCE = 0.5; // how often a light playout captures when it can
+const int64_t MCTS_SCORE_UNIT = 1 << 16; // scores are summed as fixed point so threads can add to them atomically
+
+enum struct MctsState : int {LEAF, EXPANDING, EXPANDED, TERMINAL};
+
+struct MctsNode
+{
+    std::atomic<int> visits;
+    std::atomic<int> virtualLoss; // threads walking through the GameState right now, counted as lost playouts until they report back
+    std::atomic<int64_t> score; // for the side that moved into the GameState, MCTS_SCORE_UNIT per won playout
+    std::atomic<MctsState> state; // children (EXPANDED) and terminalScore (TERMINAL) are only read once state says they are there
+    float terminalScore; // 1 for checkmate, 0.5 for stalemate and draws, for the same side as score
+    
+    MctsNode() : visits(0), virtualLoss(0), score(0), state(MctsState::LEAF), terminalScore(0) {}
+};
+
+#endif
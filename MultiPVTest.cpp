@@ -0,0 +1,106 @@
+#include <string>
+#include <iostream>
+
+#include "StateTree.hpp"
+#include "Notation.hpp"
+
+/*
+ * multipvtest - checks that the first of several lines is the move and score a single-line search finds at the same depth, for the tree and the
+ * depth-first search, and that the lines come best first
+ *
+ * Usage: make test
+ *
+ * Prints every case that fails and exits with 1 if there were any
+ */
+
+const int MULTIPV_LINES = 3;
+const int MULTIPV_TREE_DEPTH = 3;
+const int MULTIPV_DFS_DEPTH = 4;
+
+const char* MULTIPV_FENS[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 0 1",
+    "r1bqkb1r/pppp1ppp/2n2n2/4p2Q/2B1P3/8/PPPP1PPP/RNB1K1NR w KQkq - 0 1", // mate in one
+    "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1", // back rank mate
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/pPpp1ppp/8/3Pp3/8/8/PPP2PpP/R3K2R b KQkq - 0 1",
+};
+
+struct Best
+{
+    std::string move; // UCI, "none" if there was none
+    float evaluation;
+    std::vector<SearchLine> lines;
+};
+
+static Best search(const char* _fen, bool _depthFirst, int _lines)
+{
+    StateTree st;
+    st.loadFEN(_fen);
+    st.searchOptions.depthFirst = _depthFirst;
+    st.searchOptions.multiPV = _lines;
+    GameState* root = st.pastStates.back().get();
+    
+    Best best{"none", 0, {}};
+    int bestMoveIndex;
+    if (_depthFirst)
+    {
+        bestMoveIndex = st.searchDepthFirst(MULTIPV_DFS_DEPTH);
+        if (bestMoveIndex == -1 || st.iterations.empty()) { return best; }
+        best.move = st.iterations.back().bestMove;
+        best.evaluation = st.iterations.back().evaluation;
+    }
+    else
+    {
+        st.genLevels(MULTIPV_TREE_DEPTH);
+        st.minimaxEval(root);
+        bestMoveIndex = st.bestChildIndex(root);
+        if (bestMoveIndex == -1) { return best; }
+        GameState* child = root->nextLevel[bestMoveIndex].get();
+        best.move = uciMove(child->fromX, child->fromY, child->toX, child->toY);
+        best.evaluation = root->evaluation;
+    }
+    best.lines = st.multiPVLines;
+    return best;
+}
+
+int main()
+{
+    int failures = 0;
+    int total = 0;
+    
+    for (const char* fen : MULTIPV_FENS)
+    {
+        for (bool depthFirst : {false, true})
+        {
+            total++;
+            const char* name = (depthFirst ? "depth-first" : "tree");
+            Best single = search(fen, depthFirst, 1);
+            Best multi = search(fen, depthFirst, MULTIPV_LINES);
+            if (single.move == "none" || (int)multi.lines.size() != MULTIPV_LINES)
+            {
+                std::cout << " ##### FAIL " << name << " search of " << fen << " found " << single.move << " and " << multi.lines.size() << " lines ##### \n";
+                failures++;
+                continue;
+            }
+            
+            const SearchLine &first = multi.lines[0];
+            std::string firstMove = uciMove(first.pv[0].x1, first.pv[0].y1, first.pv[0].x2, first.pv[0].y2);
+            bool white = (fen[std::string(fen).find(' ')+1] == 'w');
+            bool ordered = true;
+            for (int i = 1; i < (int)multi.lines.size(); i++)
+            {
+                if (white ? multi.lines[i].evaluation > multi.lines[i-1].evaluation : multi.lines[i].evaluation < multi.lines[i-1].evaluation) { ordered = false; }
+            }
+            if (firstMove != single.move || first.evaluation != single.evaluation || multi.move != single.move || !ordered)
+            {
+                std::cout << " ##### FAIL " << name << " search of " << fen << ": single line " << single.move << " " << single.evaluation << ", first of " << MULTIPV_LINES << " " << firstMove << " "
+                          << first.evaluation << (ordered ? "" : ", lines out of order") << " ##### \n";
+                failures++;
+            }
+        }
+    }
+    
+    std::cout << total-failures << "/" << total << " multi-PV checks passed\n";
+    return (failures == 0 ? 0 : 1);
+}
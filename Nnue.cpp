@@ -0,0 +1,203 @@
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <fstream>
+#include <vector>
+#include <array>
+#include <iostream>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "Nnue.hpp"
+
+// 0-5 for own pawn, knight, bishop, rook, queen and king, 6-11 for the opponent's, -1 for EMPTY
+static int nnuePieceIndex(PieceType _piece, bool _whitePerspective)
+{
+    int index;
+    switch(_piece)
+    {
+        case (PieceType::W_PAWN): case (PieceType::B_PAWN): index = 0; break;
+        case (PieceType::W_KNIGHT): case (PieceType::B_KNIGHT): index = 1; break;
+        case (PieceType::W_BISHOP): case (PieceType::B_BISHOP): index = 2; break;
+        case (PieceType::W_ROOK): case (PieceType::B_ROOK): index = 3; break;
+        case (PieceType::W_QUEEN): case (PieceType::B_QUEEN): index = 4; break;
+        case (PieceType::W_KING): case (PieceType::B_KING): index = 5; break;
+        default: return -1;
+    }
+    bool white = ((int)_piece < COLOR_THRESHOLD);
+    return (white == _whitePerspective ? index : index+6);
+}
+
+NnueNetwork::NnueNetwork()
+{
+    outputBias = 0;
+    outputScale = 1;
+}
+
+bool NnueNetwork::load(const std::string &_path)
+{
+    std::ifstream file(_path, std::ios::binary);
+    if (!file) { return false; }
+    
+    char magic[4];
+    uint32_t hidden;
+    file.read(magic, 4);
+    file.read((char*)&hidden, sizeof(hidden));
+    if (!file || std::memcmp(magic, "CNUE", 4) != 0 || hidden != NNUE_HIDDEN) { return false; }
+    
+    std::vector<int16_t> biases(NNUE_HIDDEN);
+    std::vector<int16_t> weights((size_t)NNUE_FEATURES*NNUE_HIDDEN);
+    std::vector<int8_t> output(2*NNUE_HIDDEN);
+    int32_t bias, scale;
+    file.read((char*)biases.data(), biases.size()*sizeof(int16_t));
+    file.read((char*)weights.data(), weights.size()*sizeof(int16_t));
+    file.read((char*)output.data(), output.size());
+    file.read((char*)&bias, sizeof(bias));
+    file.read((char*)&scale, sizeof(scale));
+    if (!file || scale <= 0 || file.peek() != EOF) { return false; }
+    
+    featureBiases = std::move(biases);
+    featureWeights = std::move(weights);
+    outputWeights = std::move(output);
+    outputBias = bias;
+    outputScale = scale;
+    return true;
+}
+
+bool NnueNetwork::loaded() const
+{
+    return !featureWeights.empty();
+}
+
+void NnueNetwork::addFeature(PieceType _piece, int _x, int _y, NnueAccumulator &_acc, int _sign) const
+{
+    if (_piece == PieceType::W_KING) { _acc.kings[0] += _sign; }
+    if (_piece == PieceType::B_KING) { _acc.kings[1] += _sign; }
+    for (int perspective = 0; perspective < 2; perspective++)
+    {
+        int piece = nnuePieceIndex(_piece, perspective == 0);
+        if (piece == -1) { return; }
+        int square = 8*(perspective == 0 ? _y : 7-_y) + _x;
+        const int16_t* weights = &featureWeights[(size_t)(64*piece + square)*NNUE_HIDDEN];
+        int16_t* values = _acc.values[perspective].data();
+        // NOTE plain loops, the compiler vectorizes these on its own
+        if (_sign > 0) { for (int i = 0; i < NNUE_HIDDEN; i++) { values[i] += weights[i]; } }
+        else { for (int i = 0; i < NNUE_HIDDEN; i++) { values[i] -= weights[i]; } }
+    }
+}
+
+void NnueNetwork::refresh(const std::array<std::array<PieceType,8>,8> &_board, NnueAccumulator &_acc) const
+{
+    for (int perspective = 0; perspective < 2; perspective++)
+    {
+        std::copy(featureBiases.begin(), featureBiases.end(), _acc.values[perspective].begin());
+        _acc.kings[perspective] = 0;
+    }
+    for (int y = 0; y < 8; y++)
+    {
+        for (int x = 0; x < 8; x++) { addFeature(_board[x][y], x, y, _acc, 1); }
+    }
+}
+
+void NnueNetwork::update(const std::array<std::array<PieceType,8>,8> &_before, const std::array<std::array<PieceType,8>,8> &_after, const NnueAccumulator &_from, NnueAccumulator &_acc) const
+{
+    if (&_acc != &_from) { _acc = _from; }
+    // NOTE comparing boards finds en passant and castling's rook without knowing about them, at most four squares change
+    for (int x = 0; x < 8; x++)
+    {
+        for (int y = 0; y < 8; y++)
+        {
+            if (_before[x][y] == _after[x][y]) { continue; }
+            addFeature(_before[x][y], x, y, _acc, -1);
+            addFeature(_after[x][y], x, y, _acc, 1);
+        }
+    }
+}
+
+float NnueNetwork::evaluate(const NnueAccumulator &_acc, bool _whiteTurn) const
+{
+    const int16_t* us = _acc.values[_whiteTurn ? 0:1].data();
+    const int16_t* them = _acc.values[_whiteTurn ? 1:0].data();
+    const int8_t* weights = outputWeights.data();
+    int32_t sum = outputBias;
+    
+    for (int half = 0; half < 2; half++)
+    {
+        const int16_t* values = (half == 0 ? us : them);
+        const int8_t* w = weights + half*NNUE_HIDDEN;
+#if defined(__AVX2__)
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i ceiling = _mm256_set1_epi16(127);
+        __m256i total = _mm256_setzero_si256();
+        for (int i = 0; i < NNUE_HIDDEN; i += 16)
+        {
+            __m256i clipped = _mm256_min_epi16(_mm256_max_epi16(_mm256_loadu_si256((const __m256i*)(values+i)), zero), ceiling);
+            __m256i widened = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(w+i)));
+            total = _mm256_add_epi32(total, _mm256_madd_epi16(clipped, widened));
+        }
+        __m128i folded = _mm_add_epi32(_mm256_castsi256_si128(total), _mm256_extracti128_si256(total, 1));
+        folded = _mm_add_epi32(folded, _mm_shuffle_epi32(folded, 0x4E));
+        folded = _mm_add_epi32(folded, _mm_shuffle_epi32(folded, 0xB1));
+        sum += _mm_cvtsi128_si32(folded);
+#elif defined(__SSE2__)
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i ceiling = _mm_set1_epi16(127);
+        __m128i total = _mm_setzero_si128();
+        for (int i = 0; i < NNUE_HIDDEN; i += 8)
+        {
+            __m128i clipped = _mm_min_epi16(_mm_max_epi16(_mm_loadu_si128((const __m128i*)(values+i)), zero), ceiling);
+            __m128i bytes = _mm_loadl_epi64((const __m128i*)(w+i));
+            __m128i widened = _mm_srai_epi16(_mm_unpacklo_epi8(bytes, bytes), 8); // sign extends, SSE2 has no cvtepi8
+            total = _mm_add_epi32(total, _mm_madd_epi16(clipped, widened));
+        }
+        total = _mm_add_epi32(total, _mm_shuffle_epi32(total, 0x4E));
+        total = _mm_add_epi32(total, _mm_shuffle_epi32(total, 0xB1));
+        sum += _mm_cvtsi128_si32(total);
+#else
+        for (int i = 0; i < NNUE_HIDDEN; i++)
+        {
+            int32_t clipped = (values[i] < 0 ? 0 : (values[i] > 127 ? 127 : values[i]));
+            sum += clipped * w[i];
+        }
+#endif
+    }
+    
+    float evaluation = (float)sum / outputScale;
+    return (_whiteTurn ? evaluation : -evaluation);
+}
+
+bool writeMaterialNetwork(const std::string &_path)
+{
+    std::ofstream file(_path, std::ios::binary);
+    if (!file) { return false; }
+    
+    // hidden unit j < 5 counts own pieces of type j, 5 + j the opponent's, 8 per piece so the output weights have room for the values
+    const int values[5] = {1, 3, 3, 5, 9};
+    std::vector<int16_t> biases(NNUE_HIDDEN, 0);
+    std::vector<int16_t> weights((size_t)NNUE_FEATURES*NNUE_HIDDEN, 0);
+    std::vector<int8_t> output(2*NNUE_HIDDEN, 0);
+    for (int piece = 0; piece < 5; piece++)
+    {
+        for (int square = 0; square < 64; square++)
+        {
+            weights[(size_t)(64*piece + square)*NNUE_HIDDEN + piece] = 8;
+            weights[(size_t)(64*(piece+6) + square)*NNUE_HIDDEN + 5+piece] = 8;
+        }
+        output[piece] = (int8_t)(8*values[piece]);
+        output[5+piece] = (int8_t)(-8*values[piece]);
+    }
+    int32_t bias = 0;
+    int32_t scale = 64;
+    uint32_t hidden = NNUE_HIDDEN;
+    
+    file.write("CNUE", 4);
+    file.write((const char*)&hidden, sizeof(hidden));
+    file.write((const char*)biases.data(), biases.size()*sizeof(int16_t));
+    file.write((const char*)weights.data(), weights.size()*sizeof(int16_t));
+    file.write((const char*)output.data(), output.size());
+    file.write((const char*)&bias, sizeof(bias));
+    file.write((const char*)&scale, sizeof(scale));
+    return (bool)file;
+}
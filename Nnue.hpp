@@ -0,0 +1,60 @@
+#ifndef NNUE_HPP
+#define NNUE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <array>
+
+#include "StateTree.hpp"
+
+/* Efficiently updatable neural network evaluation, an alternative to StateTree::evaluate()
+ *
+ * Two perspectives of 768 piece-square features each (6 piece types, own or the opponent's, on 64 squares, flipped vertically for black) feed one int16
+ * accumulator per perspective. A child's accumulator is its parent's plus the few features its move changed, so only a new root pays for a full refresh.
+ * The output layer clips both accumulators to 0..127 (side to move first) and takes their dot product with int8 weights, with AVX2 or SSE2 when the
+ * build has them and a scalar loop otherwise.
+ *
+ * Weights file, little-endian:
+ *   "CNUE", uint32 hidden size (must be NNUE_HIDDEN)
+ *   int16 feature biases[NNUE_HIDDEN], int16 feature weights[768][NNUE_HIDDEN]
+ *   int8 output weights[2*NNUE_HIDDEN], int32 output bias, int32 output units per pawn
+*/
+
+const int NNUE_FEATURES = 768;
+const int NNUE_HIDDEN = 128; // per perspective, NOTE a multiple of 16 for the SIMD loops
+
+struct NnueAccumulator
+{
+    std::array<std::array<int16_t, NNUE_HIDDEN>, 2> values; // white's perspective, black's perspective
+    int8_t kings[2]; // white and black kings on the board, the network has no idea what a missing king means
+};
+
+class NnueNetwork
+{
+public:
+    NnueNetwork();
+    
+    bool load(const std::string &_path); // false (keeping the current weights) if the file can't be read or doesn't match the format above
+    
+    bool loaded() const;
+    
+    void refresh(const std::array<std::array<PieceType,8>,8> &_board, NnueAccumulator &_acc) const; // accumulator from scratch
+    
+    void update(const std::array<std::array<PieceType,8>,8> &_before, const std::array<std::array<PieceType,8>,8> &_after, const NnueAccumulator &_from, NnueAccumulator &_acc) const; // _acc is _from (for _before) plus the squares that differ in _after
+    
+    float evaluate(const NnueAccumulator &_acc, bool _whiteTurn) const; // white-relative, in pawns
+
+private:
+    void addFeature(PieceType _piece, int _x, int _y, NnueAccumulator &_acc, int _sign) const;
+    
+    std::vector<int16_t> featureBiases;
+    std::vector<int16_t> featureWeights; // NNUE_HIDDEN per feature
+    std::vector<int8_t> outputWeights;
+    int32_t outputBias;
+    int32_t outputScale;
+};
+
+bool writeMaterialNetwork(const std::string &_path); // writes a network that counts material and nothing else, a starting point and an example of the format
+
+#endif
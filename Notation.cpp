@@ -0,0 +1,435 @@
+#include <string>
+#include <sstream>
+#include <vector>
+#include <cctype>
+#include <cstdlib>
+#include <array>
+
+#include "Notation.hpp"
+
+static bool isPieceChar(char _c)
+{
+    switch(_c)
+    {
+        case 'P': case 'N': case 'B': case 'R': case 'Q': case 'K':
+        case 'p': case 'n': case 'b': case 'r': case 'q': case 'k':
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool parseClock(const std::string &_field, int _minimum, int &_value)
+{
+    if (_field.empty() || _field.size() > 6) { return false; }
+    for (char c : _field) { if (c < '0' || c > '9') { return false; } }
+    _value = std::stoi(_field);
+    return _value >= _minimum;
+}
+
+bool parseFEN(const std::string &_fen, GameState* _gs)
+{
+    std::istringstream in(_fen);
+    std::vector<std::string> fields;
+    std::string field;
+    while (in >> field) { fields.push_back(field); }
+    if (fields.size() < 4 || fields.size() > 6) { return false; }
+    
+    // BOARD - ranks 8 to 1, files a to h NOTE PieceType values are the FEN characters themselves
+    int x = 0;
+    int y = 7;
+    int whiteKings = 0;
+    int blackKings = 0;
+    for (char c : fields[0])
+    {
+        if (c == '/')
+        {
+            if (x != 8 || y == 0) { return false; }
+            x = 0;
+            y--;
+        }
+        else if (c >= '1' && c <= '8')
+        {
+            for (int i = 0; i < c-'0'; i++)
+            {
+                if (x > 7) { return false; }
+                _gs->board[x++][y] = PieceType::EMPTY;
+            }
+        }
+        else if (isPieceChar(c))
+        {
+            if (x > 7) { return false; }
+            if ((c == 'P' || c == 'p') && (y == 0 || y == 7)) { return false; }
+            if (c == 'K') { whiteKings++; }
+            if (c == 'k') { blackKings++; }
+            _gs->board[x++][y] = (PieceType)c;
+        }
+        else { return false; }
+    }
+    if (x != 8 || y != 0 || whiteKings != 1 || blackKings != 1) { return false; }
+    
+    // SIDE TO MOVE
+    if (fields[1] == "w") { _gs->whiteTurn = true; }
+    else if (fields[1] == "b") { _gs->whiteTurn = false; }
+    else { return false; }
+    _gs->evaluation = (_gs->whiteTurn ? -10000 : 10000); // same starting value the GameState constructor gives
+    
+    // CASTLING - a missing right is stored as the rook having moved
+    _gs->kingsideRookMoved_W = true;
+    _gs->queensideRookMoved_W = true;
+    _gs->kingsideRookMoved_B = true;
+    _gs->queensideRookMoved_B = true;
+    _gs->castled_W = false;
+    _gs->castled_B = false;
+    if (fields[2] != "-")
+    {
+        for (char c : fields[2])
+        {
+            if (c == 'K') { _gs->kingsideRookMoved_W = false; }
+            else if (c == 'Q') { _gs->queensideRookMoved_W = false; }
+            else if (c == 'k') { _gs->kingsideRookMoved_B = false; }
+            else if (c == 'q') { _gs->queensideRookMoved_B = false; }
+            else { return false; }
+        }
+    }
+    
+    // EN PASSANT - the target square is behind the pawn that double-moved
+    _gs->doubleMoveFile = -1;
+    if (fields[3] != "-")
+    {
+        if (fields[3].size() != 2 || fields[3][0] < 'a' || fields[3][0] > 'h') { return false; }
+        if (fields[3][1] != (_gs->whiteTurn ? '6':'3')) { return false; }
+        _gs->doubleMoveFile = fields[3][0]-'a';
+    }
+    
+    // CLOCKS
+    _gs->halfmoveClock = 0;
+    _gs->fullmoveNumber = 1;
+    if (fields.size() > 4 && !parseClock(fields[4], 0, _gs->halfmoveClock)) { return false; }
+    if (fields.size() > 5 && !parseClock(fields[5], 1, _gs->fullmoveNumber)) { return false; }
+    
+    _gs->inCheck_W = false;
+    _gs->inCheck_B = false;
+    _gs->resolved = false;
+    return true;
+}
+
+std::string toFEN(const GameState* _gs)
+{
+    std::string fen;
+    for (int y = 7; y >= 0; y--)
+    {
+        int empty = 0;
+        for (int x = 0; x < 8; x++)
+        {
+            if (_gs->board[x][y] == PieceType::EMPTY) { empty++; continue; }
+            if (empty > 0) { fen += (char)('0'+empty); empty = 0; }
+            fen += (char)_gs->board[x][y];
+        }
+        if (empty > 0) { fen += (char)('0'+empty); }
+        if (y > 0) { fen += '/'; }
+    }
+    
+    fen += (_gs->whiteTurn ? " w " : " b ");
+    
+    std::string castling;
+    bool whiteKingHome = (_gs->board[4][0] == PieceType::W_KING && !_gs->castled_W);
+    bool blackKingHome = (_gs->board[4][7] == PieceType::B_KING && !_gs->castled_B);
+    if (whiteKingHome && !_gs->kingsideRookMoved_W && _gs->board[7][0] == PieceType::W_ROOK) { castling += 'K'; }
+    if (whiteKingHome && !_gs->queensideRookMoved_W && _gs->board[0][0] == PieceType::W_ROOK) { castling += 'Q'; }
+    if (blackKingHome && !_gs->kingsideRookMoved_B && _gs->board[7][7] == PieceType::B_ROOK) { castling += 'k'; }
+    if (blackKingHome && !_gs->queensideRookMoved_B && _gs->board[0][7] == PieceType::B_ROOK) { castling += 'q'; }
+    fen += (castling.empty() ? "-" : castling);
+    
+    fen += ' ';
+    fen += (_gs->doubleMoveFile == -1 ? "-" : squareName(_gs->doubleMoveFile, _gs->whiteTurn ? 5:2));
+    
+    fen += ' ' + std::to_string(_gs->halfmoveClock) + ' ' + std::to_string(_gs->fullmoveNumber);
+    return fen;
+}
+
+bool parseEPD(const std::string &_line, GameState* _gs, std::string &_id)
+{
+    std::istringstream in(_line);
+    std::string position;
+    std::string field;
+    for (int i = 0; i < 4; i++)
+    {
+        if (!(in >> field)) { return false; }
+        position += (i == 0 ? "" : " ") + field;
+    }
+    if (!parseFEN(position, _gs)) { return false; }
+    
+    // operations are "opcode operand...;" pairs, only id is used
+    _id.clear();
+    std::string operations;
+    std::getline(in, operations);
+    size_t id = operations.find("id ");
+    if (id != std::string::npos && (id == 0 || operations[id-1] == ' ' || operations[id-1] == ';'))
+    {
+        size_t start = operations.find('"', id);
+        size_t end = (start == std::string::npos ? std::string::npos : operations.find('"', start+1));
+        if (end != std::string::npos) { _id = operations.substr(start+1, end-start-1); }
+    }
+    return true;
+}
+
+std::string squareName(int _x, int _y)
+{
+    std::string name;
+    name += (char)('a'+_x);
+    name += (char)('1'+_y);
+    return name;
+}
+
+std::string uciMove(int _x1, int _y1, int _x2, int _y2)
+{
+    return squareName(_x1, _y1) + squareName(_x2, _y2);
+}
+
+std::string uciLine(const std::vector<Move> &_moves)
+{
+    std::string line;
+    for (const Move &move : _moves) { line += (line.empty() ? "" : " ") + uciMove(move.x1, move.y1, move.x2, move.y2); }
+    return line;
+}
+
+std::string sanMove(StateTree &_st, GameState* _gs, int _childIndex)
+{
+    GameState* child = _gs->nextLevel[_childIndex].get();
+    int x1, y1, x2, y2;
+    if (!_st.childMove(_gs, child, x1, y1, x2, y2)) { return "??"; }
+    
+    PieceType piece = _gs->board[x1][y1];
+    bool isPawn = (piece == PieceType::W_PAWN || piece == PieceType::B_PAWN);
+    bool isKing = (piece == PieceType::W_KING || piece == PieceType::B_KING);
+    bool capture = (_gs->board[x2][y2] != PieceType::EMPTY || (isPawn && x1 != x2)); // NOTE a diagonal pawn move onto an empty square is en passant
+    
+    std::string san;
+    if (isKing && x1 == 4 && x2 == 6) { san = "O-O"; }
+    else if (isKing && x1 == 4 && x2 == 2) { san = "O-O-O"; }
+    else if (isPawn)
+    {
+        if (capture) { san += (char)('a'+x1); san += 'x'; }
+        san += squareName(x2, y2);
+        if (y2 == 0 || y2 == 7) { san += "=Q"; } // NOTE the move generator only promotes to queens
+    }
+    else
+    {
+        san += (char)std::toupper((char)piece);
+        
+        // disambiguate against siblings that move the same kind of piece to the same square
+        bool ambiguous = false;
+        bool sameFile = false;
+        bool sameRank = false;
+        for (int i = 0; i < (int)_gs->nextLevel.size(); i++)
+        {
+            int ox1, oy1, ox2, oy2;
+            if (i == _childIndex || !_st.childMove(_gs, _gs->nextLevel[i].get(), ox1, oy1, ox2, oy2)) { continue; }
+            if (ox2 != x2 || oy2 != y2 || (ox1 == x1 && oy1 == y1) || _gs->board[ox1][oy1] != piece) { continue; }
+            ambiguous = true;
+            if (ox1 == x1) { sameFile = true; }
+            if (oy1 == y1) { sameRank = true; }
+        }
+        if (ambiguous && (!sameFile || sameRank)) { san += (char)('a'+x1); }
+        if (ambiguous && sameFile) { san += (char)('1'+y1); }
+        
+        if (capture) { san += 'x'; }
+        san += squareName(x2, y2);
+    }
+    
+    if (kingAttacked(child, child->whiteTurn)) { san += '+'; }
+    return san;
+}
+
+// true if the squares strictly between the two are empty, they have to share a rank, file or diagonal
+static bool pathClear(const GameState* _gs, int _x1, int _y1, int _x2, int _y2)
+{
+    int dx = (_x2 > _x1) - (_x2 < _x1);
+    int dy = (_y2 > _y1) - (_y2 < _y1);
+    for (int x = _x1+dx, y = _y1+dy; x != _x2 || y != _y2; x += dx, y += dy)
+    {
+        if (_gs->board[x][y] != PieceType::EMPTY) { return false; }
+    }
+    return true;
+}
+
+// the conditions of StateTree::evalCastleAbility() for the king going from the e-file to _kingX, moves the rook on _board
+static bool castleAllowed(const GameState* _gs, int _kingX, std::array<std::array<PieceType,8>,8> &_board)
+{
+    bool white = _gs->whiteTurn;
+    bool kingside = (_kingX == 6);
+    int y = (white ? 0:7);
+    int rookX = (kingside ? 7:0);
+    int passX = (kingside ? 5:3);
+    PieceType rook = (white ? PieceType::W_ROOK : PieceType::B_ROOK);
+    bool rookMoved = (kingside ? (white ? _gs->kingsideRookMoved_W : _gs->kingsideRookMoved_B) : (white ? _gs->queensideRookMoved_W : _gs->queensideRookMoved_B));
+    
+    if (rookMoved || _gs->board[rookX][y] != rook) { return false; }
+    if (_gs->board[passX][y] != PieceType::EMPTY || _gs->board[_kingX][y] != PieceType::EMPTY) { return false; }
+    if (!kingside && _gs->board[1][y] != PieceType::EMPTY) { return false; }
+    if (squareAttacked(_gs, 4, y, !white) || squareAttacked(_gs, passX, y, !white)) { return false; } // NOTE the square the king lands on is checked with every other move
+    
+    _board[passX][y] = rook;
+    _board[rookX][y] = PieceType::EMPTY;
+    return true;
+}
+
+bool legalMove(const GameState* _gs, const Move &_move)
+{
+    int x1 = _move.x1, y1 = _move.y1, x2 = _move.x2, y2 = _move.y2;
+    if (x1 < 0 || x1 > 7 || y1 < 0 || y1 > 7 || x2 < 0 || x2 > 7 || y2 < 0 || y2 > 7 || (x1 == x2 && y1 == y2)) { return false; }
+    
+    bool white = _gs->whiteTurn;
+    PieceType piece = _gs->board[x1][y1];
+    PieceType target = _gs->board[x2][y2];
+    if (piece == PieceType::EMPTY || ((int)piece < COLOR_THRESHOLD) != white) { return false; }
+    if (target != PieceType::EMPTY && ((int)target < COLOR_THRESHOLD) == white) { return false; }
+    
+    // the board after the move, only to see whether it leaves the king attacked NOTE promotions stay pawns, it makes no difference to that
+    std::array<std::array<PieceType,8>,8> board = _gs->board;
+    board[x2][y2] = piece;
+    board[x1][y1] = PieceType::EMPTY;
+    
+    int dx = x2-x1;
+    int dy = y2-y1;
+    int adx = std::abs(dx);
+    int ady = std::abs(dy);
+    switch(std::toupper((char)piece))
+    {
+        case 'P':
+        {
+            int moveDir = (white ? 1:-1);
+            if (dx == 0 && dy == moveDir && target == PieceType::EMPTY) { break; }
+            if (dx == 0 && dy == 2*moveDir && y1 == (white ? 1:6) && target == PieceType::EMPTY && _gs->board[x1][y1+moveDir] == PieceType::EMPTY) { break; }
+            if (adx == 1 && dy == moveDir && target != PieceType::EMPTY) { break; }
+            if (adx == 1 && dy == moveDir && y1 == (white ? 4:3) && _gs->doubleMoveFile == x2 && _gs->board[x2][y1] == (white ? PieceType::B_PAWN : PieceType::W_PAWN))
+            {
+                board[x2][y1] = PieceType::EMPTY; // en passant
+                break;
+            }
+            return false;
+        }
+        case 'N':
+            if (!((adx == 1 && ady == 2) || (adx == 2 && ady == 1))) { return false; }
+            break;
+        case 'B':
+            if (adx != ady || !pathClear(_gs, x1, y1, x2, y2)) { return false; }
+            break;
+        case 'R':
+            if ((dx != 0 && dy != 0) || !pathClear(_gs, x1, y1, x2, y2)) { return false; }
+            break;
+        case 'Q':
+            if ((adx != ady && dx != 0 && dy != 0) || !pathClear(_gs, x1, y1, x2, y2)) { return false; }
+            break;
+        case 'K':
+            if (adx <= 1 && ady <= 1) { break; }
+            if (x1 != 4 || y1 != (white ? 0:7) || dy != 0 || (x2 != 6 && x2 != 2) || !castleAllowed(_gs, x2, board)) { return false; }
+            break;
+        default:
+            return false;
+    }
+    
+    // NOTE like kingAttacked(), a side without a king can't be in check
+    PieceType king = (white ? PieceType::W_KING : PieceType::B_KING);
+    for (int y = 0; y < 8; y++)
+    {
+        for (int x = 0; x < 8; x++)
+        {
+            if (board[x][y] == king) { return !squareAttacked(board, x, y, !white); }
+        }
+    }
+    return true;
+}
+
+bool parseUciMove(const GameState* _gs, const std::string &_text, Move &_move)
+{
+    if (_text.size() != 4 && _text.size() != 5) { return false; }
+    if (_text[0] < 'a' || _text[0] > 'h' || _text[1] < '1' || _text[1] > '8' || _text[2] < 'a' || _text[2] > 'h' || _text[3] < '1' || _text[3] > '8') { return false; }
+    _move = Move{(std::int8_t)(_text[0]-'a'), (std::int8_t)(_text[1]-'1'), (std::int8_t)(_text[2]-'a'), (std::int8_t)(_text[3]-'1')};
+    
+    if (_text.size() == 5)
+    {
+        PieceType piece = _gs->board[_move.x1][_move.y1];
+        bool promotion = ((piece == PieceType::W_PAWN && _move.y2 == 7) || (piece == PieceType::B_PAWN && _move.y2 == 0));
+        if (!promotion || std::tolower(_text[4]) != 'q') { return false; }
+    }
+    return legalMove(_gs, _move);
+}
+
+bool parseSanMove(const GameState* _gs, const std::string &_text, Move &_move)
+{
+    std::string san = _text;
+    while (!san.empty() && std::string("+#!? \t\r").find(san.back()) != std::string::npos) { san.pop_back(); }
+    
+    int homeRank = (_gs->whiteTurn ? 0:7);
+    if (san == "O-O" || san == "0-0" || san == "O-O-O" || san == "0-0-0")
+    {
+        _move = Move{4, (std::int8_t)homeRank, (std::int8_t)(san.size() == 3 ? 6:2), (std::int8_t)homeRank};
+        return legalMove(_gs, _move);
+    }
+    if (san.empty()) { return false; }
+    
+    char pieceChar = 'P';
+    if (std::string("NBRQK").find(san[0]) != std::string::npos)
+    {
+        pieceChar = san[0];
+        san.erase(0, 1);
+    }
+    
+    // promotion, "e8=Q" or "e8Q"
+    if (pieceChar == 'P' && san.size() >= 3 && std::string("NBRQ").find(san.back()) != std::string::npos)
+    {
+        if (san.back() != 'Q') { return false; } // NOTE parsed, but the move generator has no under-promotions
+        san.pop_back();
+        if (san.back() == '=') { san.pop_back(); }
+    }
+    
+    // destination last, then an optional 'x', then the file and/or rank the piece comes from
+    if (san.size() < 2) { return false; }
+    int x2 = san[san.size()-2] - 'a';
+    int y2 = san[san.size()-1] - '1';
+    if (x2 < 0 || x2 > 7 || y2 < 0 || y2 > 7) { return false; }
+    san.erase(san.size()-2);
+    bool capture = (!san.empty() && san.back() == 'x');
+    if (capture) { san.pop_back(); }
+    
+    int fromX = -1;
+    int fromY = -1;
+    for (char c : san)
+    {
+        if (c >= 'a' && c <= 'h' && fromX == -1 && fromY == -1) { fromX = c - 'a'; }
+        else if (c >= '1' && c <= '8' && fromY == -1) { fromY = c - '1'; }
+        else { return false; }
+    }
+    if (pieceChar == 'P')
+    {
+        // a pawn only leaves its file when it captures, and then SAN names the file it came from
+        if (capture != (fromX != -1) || fromX == x2) { return false; }
+        if (!capture) { fromX = x2; }
+    }
+    
+    PieceType piece = (PieceType)(_gs->whiteTurn ? pieceChar : std::tolower(pieceChar));
+    int found = 0;
+    for (int y = 0; y < 8; y++)
+    {
+        for (int x = 0; x < 8; x++)
+        {
+            if (_gs->board[x][y] != piece || (fromX != -1 && x != fromX) || (fromY != -1 && y != fromY)) { continue; }
+            Move move{(std::int8_t)x, (std::int8_t)y, (std::int8_t)x2, (std::int8_t)y2};
+            if (!legalMove(_gs, move)) { continue; }
+            _move = move;
+            found++;
+        }
+    }
+    if (found != 1) { return false; }
+    
+    // NOTE an 'x' has to be a capture, a missing one is forgiven
+    bool captures = (_gs->board[x2][y2] != PieceType::EMPTY || (pieceChar == 'P' && fromX != x2));
+    return (captures || !capture);
+}
+
+bool parseMove(const GameState* _gs, const std::string &_text, Move &_move)
+{
+    return parseUciMove(_gs, _text, _move) || parseSanMove(_gs, _text, _move);
+}
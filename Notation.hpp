@@ -0,0 +1,44 @@
+#ifndef NOTATION_HPP
+#define NOTATION_HPP
+
+#include <string>
+#include <vector>
+
+#include "StateTree.hpp"
+
+// ---------- FEN / EPD ----------
+
+const std::string START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+bool parseFEN(const std::string &_fen, GameState* _gs); // fills in _gs's board, side to move, castling flags, en passant file and clocks, returns false on malformed input (_gs is then left half-written) NOTE the two clock fields are optional
+
+std::string toFEN(const GameState* _gs);
+
+bool parseEPD(const std::string &_line, GameState* _gs, std::string &_id); // the four position fields of an EPD line followed by operations, _id is set from the "id" operation if there is one
+
+// ---------- MOVES ----------
+
+std::string squareName(int _x, int _y); // "e4"
+
+std::string uciMove(int _x1, int _y1, int _x2, int _y2); // "e2e4"
+
+std::string uciLine(const std::vector<Move> &_moves); // "e2e4 e7e5 g1f3", e.g. for StateTree::principalVariation
+
+std::string sanMove(StateTree &_st, GameState* _gs, int _childIndex); // SAN of the move to _gs->nextLevel[_childIndex], disambiguated against its siblings, NOTE only "+" is marked, never "#"
+
+/* Moves from text without the tree
+ *
+ * These work on any GameState, with or without children: the move is checked against the rules of the move generator on the board alone (a copy of it for
+ * the king's safety), so nothing is generated or searched. A Move is the same handle StateTree::findChild() takes, castling is the king's move.
+ * NOTE the move generator only promotes to queens, "e8=N" parses but is never legal
+*/
+
+bool legalMove(const GameState* _gs, const Move &_move); // true if the side to move may play _move
+
+bool parseUciMove(const GameState* _gs, const std::string &_text, Move &_move); // "e2e4", "e7e8q", false unless it's legal in _gs
+
+bool parseSanMove(const GameState* _gs, const std::string &_text, Move &_move); // "Nf3", "O-O", "exd6", "e8=Q", "Nbd7+", false unless it names exactly one legal move in _gs, check marks and "!?" are ignored
+
+bool parseMove(const GameState* _gs, const std::string &_text, Move &_move); // UCI or SAN
+
+#endif
@@ -0,0 +1,132 @@
+#include <string>
+#include <iostream>
+
+#include "StateTree.hpp"
+#include "Notation.hpp"
+
+/*
+ * notationtest - checks the move parsers and legalMove() on the moves the old validator got wrong, and sanMove() against parseSanMove()
+ *
+ * Usage: make test
+ *
+ * Prints every case that fails and exits with 1 if there were any
+ */
+
+struct ParseCase
+{
+    const char* fen;
+    const char* move; // SAN or UCI, parseMove() tells them apart
+    const char* expected; // UCI of the move it should parse to, "-" if it should be rejected
+};
+
+const ParseCase PARSE_CASES[] = {
+    {"5r1k/8/8/8/8/8/8/R3K2R w KQ - 0 1", "O-O", "-"}, // f1 is attacked
+    {"5r1k/8/8/8/8/8/8/R3K2R w KQ - 0 1", "e1g1", "-"},
+    {"5r1k/8/8/8/8/8/8/R3K2R w KQ - 0 1", "O-O-O", "e1c1"},
+    {"3r3k/8/8/8/8/8/8/R3K2R w KQ - 0 1", "O-O-O", "-"}, // d1 is attacked
+    {"1r5k/8/8/8/8/8/8/R3K2R w KQ - 0 1", "O-O-O", "e1c1"}, // only b1 is attacked, the king doesn't cross it
+    {"4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1", "exd6", "e5d6"},
+    {"4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1", "e5d6", "e5d6"},
+    {"4k3/8/8/3pP3/8/8/8/4K3 w - - 0 1", "exd6", "-"}, // the d pawn didn't just double-move
+    {"4k3/8/8/2ppP3/8/8/8/4K3 w - c6 0 1", "exd6", "-"}, // the c pawn did
+    {"k7/4P3/8/8/8/8/8/4K3 w - - 0 1", "e8=N", "-"}, // the move generator only promotes to queens
+    {"k7/4P3/8/8/8/8/8/4K3 w - - 0 1", "e8=Q", "e7e8"},
+    {"k7/4P3/8/8/8/8/8/4K3 w - - 0 1", "e7e8q", "e7e8"},
+    {"k7/4P3/8/8/8/8/8/4K3 w - - 0 1", "e7e8n", "-"},
+    {"7k/8/1N3N2/8/8/8/8/4K3 w - - 0 1", "Nbd7", "b6d7"},
+    {"7k/8/1N3N2/8/8/8/8/4K3 w - - 0 1", "Nfd7", "f6d7"},
+    {"7k/8/1N3N2/8/8/8/8/4K3 w - - 0 1", "Nd7", "-"}, // either knight
+    {"7k/8/1N3N2/8/8/8/8/4K3 w - - 0 1", "N6d7", "-"}, // the rank doesn't tell them apart either
+};
+
+const char* ROUND_TRIP_FENS[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R b KQkq - 0 1",
+    "7k/8/1N3N2/8/8/8/8/4K3 w - - 0 1",
+    "4k3/8/8/2ppP3/8/8/8/4K3 w - d6 0 1",
+    "k7/4P3/8/8/8/8/8/4K3 w - - 0 1",
+    "R6R/8/8/8/8/8/8/R3K1k1 w - - 0 1", // Rad8/Rhd8 by file, R1a4/R8a4 by rank
+};
+
+int main()
+{
+    int failures = 0;
+    int total = 0;
+    
+    for (const ParseCase &test : PARSE_CASES)
+    {
+        total++;
+        GameState gs(nullptr);
+        if (!parseFEN(test.fen, &gs))
+        {
+            std::cout << " ##### FAIL can't set up " << test.fen << " ##### \n";
+            failures++;
+            continue;
+        }
+        Move move;
+        std::string found = (parseMove(&gs, test.move, move) ? uciMove(move.x1, move.y1, move.x2, move.y2) : "-");
+        if (found != test.expected)
+        {
+            std::cout << " ##### FAIL " << test.move << " in " << test.fen << " parsed as " << found << ", expected " << test.expected << " ##### \n";
+            failures++;
+        }
+    }
+    
+    // en passant is decided by doubleMoveFile alone, whatever the FEN said
+    {
+        total++;
+        GameState gs(nullptr);
+        parseFEN("4k3/8/8/2ppP3/8/8/8/4K3 w - - 0 1", &gs);
+        Move capture{4, 4, 3, 5};
+        gs.doubleMoveFile = 2;
+        bool wrongFile = legalMove(&gs, capture);
+        gs.doubleMoveFile = 3;
+        bool rightFile = legalMove(&gs, capture);
+        if (wrongFile || !rightFile)
+        {
+            std::cout << " ##### FAIL exd6 legal with doubleMoveFile 2: " << wrongFile << ", 3: " << rightFile << " ##### \n";
+            failures++;
+        }
+    }
+    
+    // every legal move's SAN has to parse back to the same move
+    for (const char* fen : ROUND_TRIP_FENS)
+    {
+        total++;
+        StateTree st;
+        if (!st.loadFEN(fen))
+        {
+            std::cout << " ##### FAIL can't set up " << fen << " ##### \n";
+            failures++;
+            continue;
+        }
+        GameState* gs = st.pastStates.back().get();
+        st.genChildren(gs);
+        int moves = 0;
+        bool roundTrips = true;
+        for (int i = 0; i < (int)gs->nextLevel.size(); i++)
+        {
+            GameState* child = gs->nextLevel[i].get();
+            Move played{child->fromX, child->fromY, child->toX, child->toY};
+            if (!legalMove(gs, played)) { continue; }
+            moves++;
+            std::string san = sanMove(st, gs, i);
+            Move parsed;
+            if (!parseSanMove(gs, san, parsed) || parsed.x1 != played.x1 || parsed.y1 != played.y1 || parsed.x2 != played.x2 || parsed.y2 != played.y2)
+            {
+                std::cout << " ##### FAIL " << san << " for " << uciMove(played.x1, played.y1, played.x2, played.y2) << " in " << fen << " doesn't parse back ##### \n";
+                roundTrips = false;
+            }
+        }
+        if (moves == 0)
+        {
+            std::cout << " ##### FAIL no legal moves in " << fen << " ##### \n";
+            roundTrips = false;
+        }
+        if (!roundTrips) { failures++; }
+    }
+    
+    std::cout << total-failures << "/" << total << " notation checks passed\n";
+    return (failures == 0 ? 0 : 1);
+}
@@ -0,0 +1,28 @@
+#ifndef PAWNHASH_HPP
+#define PAWNHASH_HPP
+
+#include <cstdint>
+
+#include "DirectMappedCache.hpp"
+
+/* Pawn hash table, a direct-mapped cache of pawn structure evaluations
+ *
+ * Keyed by the Zobrist key of the pawns alone (see StateTree::evaluate()). Pawns move far less often than anything else so most leaves of a search share the
+ * structure of many others and only the first of them pays for the doubled/isolated/passed pawn scan.
+ *
+ * NOTE Not thread safe, every StateTree has its own table.
+*/
+
+const long PAWN_HASH_DEFAULT_KB = 256;
+
+struct PawnEntry // NOTE zeroed it's the right answer for key 0, no pawns at all
+{
+    uint64_t key;
+    float score; // doubled, isolated and passed pawn terms, white-relative
+    uint64_t pawns[2]; // bit 8*y+x set for every pawn, white then black
+    uint64_t passed[2]; // the passed pawns among them
+};
+
+typedef DirectMappedCache<PawnEntry> PawnHashTable;
+
+#endif
@@ -0,0 +1,90 @@
+#include <string>
+#include <vector>
+#include <sstream>
+#include <iostream>
+
+#include "Annotate.hpp"
+
+/*
+ * pgntest - checks that PgnReader::next() keeps only the main line's moves through comments, variations, NAGs and move marks, and splits games
+ * whether or not they end with a termination marker
+ *
+ * Usage: make test
+ *
+ * Prints every case that fails and exits with 1 if there were any
+ */
+
+const char* PGN_FILE =
+    "% an escape line, skipped\n"
+    "[Event \"Comments\"]\n"
+    "[White \"A\"]\n"
+    "\n"
+    "1. e4 {a comment with 2. d4 and ( in it} e5 2. Nf3 ; to the end of the line Nc3\n"
+    "Nc6 {a comment\n"
+    "over two lines} 3. Bb5 $1 a6 4. Ba4!? Nf6?! 5. O-O! Be7?? 1-0\n"
+    "\n"
+    "[Event \"Variations\"]\n"
+    "\n"
+    "1. d4 (1. e4 e5 (1... c5 2. Nf3 (2. c3)) 2. Nf3) 1... d5 2. c4 $14 (2. Nf3 {quiet}) e6 1/2-1/2\n"
+    "\n"
+    "[Event \"No marker\"]\n"
+    "\n"
+    "1. c4 e5 2. Nc3\n"
+    "[Event \"Last\"]\n"
+    "[Result \"*\"]\n"
+    "\n"
+    "1. f4 e5 2. fxe5 d6 3. exd6 Bxd6 4. Nf3 g5\n";
+
+struct GameCase
+{
+    const char* event;
+    const char* moves; // space separated
+    const char* result;
+    long line;
+    int tags;
+};
+
+const GameCase GAME_CASES[] = {
+    {"Comments", "e4 e5 Nf3 Nc6 Bb5 a6 Ba4 Nf6 O-O Be7", "1-0", 2, 2},
+    {"Variations", "d4 d5 c4 e6", "1/2-1/2", 9, 1},
+    {"No marker", "c4 e5 Nc3", "*", 13, 1}, // ends at the next game's tags
+    {"Last", "f4 e5 fxe5 d6 exd6 Bxd6 Nf3 g5", "*", 16, 2}, // keeps the tag line that ended the game before, and ends at the end of the file
+};
+
+int main()
+{
+    int failures = 0;
+    int total = 0;
+    
+    std::istringstream in(PGN_FILE);
+    PgnReader reader(in);
+    PgnGame game;
+    for (const GameCase &test : GAME_CASES)
+    {
+        total++;
+        if (!reader.next(game))
+        {
+            std::cout << " ##### FAIL no game \"" << test.event << "\" ##### \n";
+            failures++;
+            break;
+        }
+        std::string moves;
+        for (const std::string &move : game.moves) { moves += (moves.empty() ? "" : " ") + move; }
+        if (game.tag("Event") != test.event || moves != test.moves || game.result != test.result || game.line != test.line || (int)game.tags.size() != test.tags)
+        {
+            std::cout << " ##### FAIL game \"" << game.tag("Event") << "\" at line " << game.line << " with " << game.tags.size() << " tags read as \"" << moves << "\" " << game.result << ", expected \"" << test.event << "\" at line "
+                      << test.line << " with " << test.tags << " tags \"" << test.moves << "\" " << test.result << " ##### \n";
+            failures++;
+        }
+    }
+    
+    total++;
+    if (reader.next(game))
+    {
+        std::cout << " ##### FAIL a game past the end of the file ##### \n";
+        failures++;
+    }
+    
+    std::cout << total-failures << "/" << total << " PGN checks passed\n";
+    return (failures == 0 ? 0 : 1);
+}
@@ -0,0 +1,718 @@
+#include <string>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+#include "Search.hpp"
+#include "StateTree.hpp"
+#include "TranspositionTable.hpp"
+#include "AnalysisCache.hpp"
+#include "Zobrist.hpp"
+#include "Tablebase.hpp"
+#include "Endgame.hpp"
+#include "Notation.hpp"
+#include "See.hpp"
+
+// captures and promotions are the only moves quiescence searches and the ones the selective techniques never cut
+static bool isQuiet(const GameState* _gs, const GameState* _child)
+{
+    if (_child->captured != PieceType::EMPTY) { return false; }
+    PieceType piece = _gs->board[_child->fromX][_child->fromY];
+    return !((piece == PieceType::W_PAWN && _child->toY == 7) || (piece == PieceType::B_PAWN && _child->toY == 0));
+}
+
+// true if _child is the move the transposition table stored as _move
+static bool isMove(const GameState* _child, uint16_t _move)
+{
+    return ttMove(_child->fromX, _child->fromY, _child->toX, _child->toY) == _move;
+}
+
+enum struct PickStage : int {HASH_MOVE, CAPTURES, KILLERS, QUIETS, LOSING_CAPTURES, DONE}; // see alphaBeta()
+
+// true if _white has anything besides king and pawns, without it passing (null move) could be the best move there is
+static bool hasPieces(const GameState* _gs, bool _white)
+{
+    for (int y = 0; y < 8; y++)
+    {
+        for (int x = 0; x < 8; x++)
+        {
+            PieceType piece = _gs->board[x][y];
+            if (piece == PieceType::EMPTY || ((int)piece < COLOR_THRESHOLD) != _white) { continue; }
+            if (piece != PieceType::W_PAWN && piece != PieceType::B_PAWN && piece != PieceType::W_KING && piece != PieceType::B_KING) { return true; }
+        }
+    }
+    return false;
+}
+
+bool parseSearchSpec(const std::string &_spec, SearchOptions &_options)
+{
+    std::stringstream words(_spec);
+    std::string word;
+    while (std::getline(words, word, ','))
+    {
+        if (word == "tree") { _options.depthFirst = false; _options.mcts = false; continue; }
+        if (word == "dfs") { _options.depthFirst = true; _options.mcts = false; continue; }
+        if (word == "mcts") { _options.depthFirst = false; _options.mcts = true; continue; }
+        if (word.size() < 2 || (word[0] != '-' && word[0] != '+')) { return false; }
+        
+        bool on = (word[0] == '+');
+        std::string name = word.substr(1);
+        if (name == "null") { _options.nullMove = on; }
+        else if (name == "lmr") { _options.lateMoveReductions = on; }
+        else if (name == "futility") { _options.futility = on; }
+        else if (name == "qsearch") { _options.quiescence = on; }
+        else if (name == "pvs") { _options.pvs = on; }
+        else if (name == "aspiration") { _options.aspiration = on; }
+        else if (name == "see") { _options.see = on; }
+        else if (name == "staged") { _options.staged = on; }
+        else if (name == "light") { _options.lightPlayouts = on; }
+        else { return false; }
+    }
+    return true;
+}
+
+std::string describeSearch(const SearchOptions &_options)
+{
+    if (_options.mcts) { return (_options.lightPlayouts ? "mcts" : "mcts,-light"); }
+    if (!_options.depthFirst) { return "tree"; }
+    
+    std::string spec = "dfs";
+    if (!_options.nullMove) { spec += ",-null"; }
+    if (!_options.lateMoveReductions) { spec += ",-lmr"; }
+    if (!_options.futility) { spec += ",-futility"; }
+    if (!_options.quiescence) { spec += ",-qsearch"; }
+    if (!_options.pvs) { spec += ",-pvs"; }
+    if (!_options.aspiration) { spec += ",-aspiration"; }
+    if (!_options.see) { spec += ",-see"; }
+    if (!_options.staged) { spec += ",-staged"; }
+    return spec;
+}
+
+int StateTree::searchDepthFirst(int _depth)
+{
+    if (!startDepthFirst()) { return -1; }
+    while (deepenDepthFirst(_depth)) {}
+    return 0;
+}
+
+bool StateTree::startDepthFirst()
+{
+    depthFirstStart = std::chrono::steady_clock::now();
+    searchNodes = 0;
+    searchAborted = false;
+    sliceExpired = false;
+    ttProbes = 0;
+    ttHits = 0;
+    if (tt != nullptr) { tt->newSearch(ttSession); }
+    for (auto &killer : killers) { killer.fill(Move{-1, -1, -1, -1}); }
+    iterations.clear();
+    principalVariation.clear();
+    multiPVLines.clear();
+    
+    GameState* root = pastStates.back().get();
+    endgamePly = std::max(countPieces(root) - ENDGAME_MAX_PIECES, 0);
+    if (root->nextLevel.empty()) { genChildren(root); }
+    if (root->nextLevel.empty()) { return false; }
+    for (int i = 0; i < (int)root->nextLevel.size(); i++) { root->nextLevel[i]->nextLevel.clear(); } // NOTE a materialized tree under the root is of no use here
+    orderChildren(root);
+    return true;
+}
+
+bool StateTree::deepenDepthFirst(int _depth)
+{
+    STATS_TIME(stats.minimaxTicks);
+    GameState* root = pastStates.back().get();
+    int depth = (int)iterations.size() + 1;
+    if (sliceExpired)
+    {
+        // the same depth again, NOTE whatever it finished last time is in the transposition table
+        searchAborted = false;
+        sliceExpired = false;
+    }
+    if (depth > _depth || searchAborted) { return false; }
+    if (depth == 1 && answerFromCache(_depth)) { return false; }
+    sliceEnd = searchNodes + sliceNodes;
+    
+    std::vector<float> lastEvaluations; // of the last complete depth, put back if this one is abandoned
+    for (int i = 0; i < (int)root->nextLevel.size(); i++) { lastEvaluations.push_back(root->nextLevel[i]->evaluation); }
+    
+    // ASPIRATION - expect about the last depth's score, widen the window on whichever side the score falls out of
+    float delta = ASPIRATION_WINDOW;
+    bool aspirate = (searchOptions.aspiration && searchOptions.multiPV <= 1 && depth >= 3 && std::fabs(root->evaluation) < MATE_EVALUATION/2);
+    float alpha = (aspirate ? root->evaluation - delta : -SEARCH_INFINITY);
+    float beta = (aspirate ? root->evaluation + delta : SEARCH_INFINITY);
+    int researches = 0;
+    while (true)
+    {
+        float score = searchRoot(root, depth, alpha, beta);
+        if (searchAborted) { break; }
+        if (score <= alpha && alpha > -SEARCH_INFINITY)
+        {
+            delta *= 2;
+            alpha = (delta > 16*ASPIRATION_WINDOW ? -SEARCH_INFINITY : root->evaluation - delta);
+        }
+        else if (score >= beta && beta < SEARCH_INFINITY)
+        {
+            delta *= 2;
+            beta = (delta > 16*ASPIRATION_WINDOW ? SEARCH_INFINITY : root->evaluation + delta);
+        }
+        else { break; }
+        researches++;
+    }
+    if (searchAborted)
+    {
+        for (int i = 0; i < (int)root->nextLevel.size(); i++) { root->nextLevel[i]->evaluation = lastEvaluations[i]; }
+        return false;
+    }
+    
+    // best move first for the next depth, NOTE moves that failed low only got a bound no better than the best move's score so the stable sort keeps the best move in front
+    std::stable_sort(root->nextLevel.begin(), root->nextLevel.end(), [root](const std::unique_ptr<GameState> &_a, const std::unique_ptr<GameState> &_b)
+    {
+        return (root->whiteTurn ? _a->evaluation > _b->evaluation : _a->evaluation < _b->evaluation);
+    });
+    GameState* best = root->nextLevel[0].get();
+    root->evaluation = best->evaluation;
+    principalVariation.assign(pvTable[0].begin(), pvTable[0].begin() + pvLength[0]);
+    
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - depthFirstStart).count();
+    iterations.push_back(SearchIteration{depth, root->evaluation, uciMove(best->fromX, best->fromY, best->toX, best->toY), searchNodes, ms, principalVariation, researches});
+    if (analysisCache != nullptr && searchOptions.multiPV <= 1) { analysisCache->store(root->positionKey, AnalysisEntry{depth, root->evaluation, TTBound::EXACT, Move{best->fromX, best->fromY, best->toX, best->toY}}); }
+    
+    if (std::fabs(root->evaluation) > MATE_EVALUATION/2) { return false; } // a forced king capture doesn't get any better deeper
+    if (timeManager != nullptr && !timeManager->nextDepth(iterations.back().bestMove, root->evaluation, root->whiteTurn)) { return false; }
+    return depth < _depth;
+}
+
+bool StateTree::answerFromCache(int _depth)
+{
+    AnalysisEntry entry;
+    GameState* root = pastStates.back().get();
+    if (analysisCache == nullptr || searchOptions.multiPV > 1 || !analysisCache->probe(root->positionKey, entry) || entry.depth < _depth || entry.bound != TTBound::EXACT) { return false; }
+    int index = findChild(root, entry.move.x1, entry.move.y1, entry.move.x2, entry.move.y2);
+    if (index == -1) { return false; } // NOTE a key collision
+    
+    // the cached move first, the others only known to be no better
+    std::rotate(root->nextLevel.begin(), root->nextLevel.begin()+index, root->nextLevel.begin()+index+1);
+    for (int i = 0; i < (int)root->nextLevel.size(); i++) { root->nextLevel[i]->evaluation = entry.score; }
+    root->evaluation = entry.score;
+    principalVariation.assign(1, entry.move);
+    
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - depthFirstStart).count();
+    iterations.push_back(SearchIteration{entry.depth, entry.score, uciMove(entry.move.x1, entry.move.y1, entry.move.x2, entry.move.y2), 0, ms, principalVariation, 0});
+    return true;
+}
+
+float StateTree::searchRoot(GameState* _root, int _depth, float _alpha, float _beta)
+{
+    if (searchOptions.multiPV > 1) { return searchRootMultiPV(_root, _depth); }
+    
+    bool white = _root->whiteTurn;
+    float best = (white ? -SEARCH_INFINITY : SEARCH_INFINITY);
+    pvLength[0] = 0;
+    for (int i = 0; i < (int)_root->nextLevel.size(); i++)
+    {
+        GameState* child = _root->nextLevel[i].get();
+        followPV = (i == 0); // NOTE the root's children are sorted best first so the first one starts the last depth's PV
+        float score = searchChild(_root, child, _depth-1, 0, i > 0 && searchOptions.pvs, _alpha, _beta, 1);
+        followPV = false;
+        if (searchAborted) { break; }
+        child->evaluation = score;
+        
+        if (white ? score > best : score < best) { best = score; }
+        if (white && score > _alpha)
+        {
+            _alpha = score;
+            updatePV(0, child);
+        }
+        else if (!white && score < _beta)
+        {
+            _beta = score;
+            updatePV(0, child);
+        }
+        if (_alpha >= _beta) { break; }
+    }
+    return best;
+}
+
+float StateTree::searchRootMultiPV(GameState* _root, int _depth)
+{
+    bool white = _root->whiteTurn;
+    int lines = std::min(searchOptions.multiPV, (int)_root->nextLevel.size());
+    float best = (white ? -SEARCH_INFINITY : SEARCH_INFINITY);
+    pvLength[0] = 0;
+    std::vector<SearchLine> found; // exact scores so far, best first and at most lines of them
+    for (int i = 0; i < (int)_root->nextLevel.size(); i++)
+    {
+        GameState* child = _root->nextLevel[i].get();
+        bool full = ((int)found.size() == lines);
+        float alpha = (white && full ? found.back().evaluation : -SEARCH_INFINITY);
+        float beta = (!white && full ? found.back().evaluation : SEARCH_INFINITY);
+        
+        // ASPIRATION - per line, the moves that made the best lines last depth (the first ones, they're sorted) expect about the same score
+        float windowAlpha = alpha;
+        float windowBeta = beta;
+        if (searchOptions.aspiration && _depth >= 3 && i < lines && std::fabs(child->evaluation) < MATE_EVALUATION/2)
+        {
+            windowAlpha = std::max(alpha, child->evaluation - ASPIRATION_WINDOW);
+            windowBeta = std::min(beta, child->evaluation + ASPIRATION_WINDOW);
+        }
+        followPV = (i == 0);
+        float score = searchChild(_root, child, _depth-1, 0, full && searchOptions.pvs, windowAlpha, windowBeta, 1);
+        if (!searchAborted && ((score <= windowAlpha && windowAlpha > alpha) || (score >= windowBeta && windowBeta < beta)))
+        {
+            followPV = (i == 0);
+            score = searchChild(_root, child, _depth-1, 0, full && searchOptions.pvs, alpha, beta, 1);
+        }
+        followPV = false;
+        if (searchAborted) { break; }
+        child->evaluation = score;
+        if (white ? score <= alpha : score >= beta) { continue; } // only a bound, no better than the worst line
+        
+        // the child's line is still in row 1 of pvTable
+        SearchLine line{score, {Move{child->fromX, child->fromY, child->toX, child->toY}}};
+        line.pv.insert(line.pv.end(), pvTable[1].begin()+1, pvTable[1].begin() + std::max(pvLength[1], 1));
+        auto after = std::find_if(found.begin(), found.end(), [white, score](const SearchLine &_line) { return (white ? score > _line.evaluation : score < _line.evaluation); });
+        found.insert(after, line);
+        if ((int)found.size() > lines) { found.pop_back(); }
+        
+        if (white ? score > best : score < best)
+        {
+            best = score;
+            updatePV(0, child);
+        }
+    }
+    if (!searchAborted) { multiPVLines = found; }
+    return best;
+}
+
+float StateTree::searchChild(GameState* _gs, GameState* _child, int _depth, int _reduction, bool _scout, float _alpha, float _beta, int _ply)
+{
+    if (!_scout && _reduction == 0) { return alphaBeta(_child, _depth, _alpha, _beta, _ply, true); }
+    
+    // null window on the side _gs is trying to improve, all that's asked is whether _child beats the best move so far
+    bool white = _gs->whiteTurn;
+    float scoutAlpha = (white ? _alpha : _beta-NULL_WINDOW);
+    float scoutBeta = (white ? _alpha+NULL_WINDOW : _beta);
+    float score = alphaBeta(_child, _depth-_reduction, scoutAlpha, scoutBeta, _ply, true);
+    
+    // a reduced move that looks better has to prove it at full depth
+    if (_reduction > 0 && (white ? score > _alpha : score < _beta)) { score = alphaBeta(_child, _depth, scoutAlpha, scoutBeta, _ply, true); }
+    
+    // better but not good enough for a cutoff, now the exact score is needed
+    if (score > _alpha && score < _beta) { score = alphaBeta(_child, _depth, _alpha, _beta, _ply, true); }
+    return score;
+}
+
+void StateTree::updatePV(int _ply, const GameState* _child)
+{
+    pvTable[_ply][_ply] = Move{_child->fromX, _child->fromY, _child->toX, _child->toY};
+    int length = std::max(pvLength[_ply+1], _ply+1);
+    for (int ply = _ply+1; ply < length; ply++) { pvTable[_ply][ply] = pvTable[_ply+1][ply]; }
+    pvLength[_ply] = length;
+}
+
+bool StateTree::pvFirst(GameState* _gs, int _ply)
+{
+    if (_ply >= (int)principalVariation.size()) { return false; }
+    
+    const Move &move = principalVariation[_ply];
+    for (int i = 0; i < (int)_gs->nextLevel.size(); i++)
+    {
+        GameState* child = _gs->nextLevel[i].get();
+        if (child->fromX == move.x1 && child->fromY == move.y1 && child->toX == move.x2 && child->toY == move.y2)
+        {
+            std::rotate(_gs->nextLevel.begin(), _gs->nextLevel.begin()+i, _gs->nextLevel.begin()+i+1);
+            return true;
+        }
+    }
+    return false;
+}
+
+float StateTree::alphaBeta(GameState* _gs, int _depth, float _alpha, float _beta, int _ply, bool _nullAllowed)
+{
+    // out of time, NOTE never during the first depth so there's always a move to play
+    if (searchAborted) { return 0; }
+    if (timeManager != nullptr && (searchNodes & 1023) == 0 && !iterations.empty() && timeManager->hardLimitReached())
+    {
+        searchAborted = true;
+        return 0;
+    }
+    // out of turn, the caller searches this depth again later
+    if (sliceNodes > 0 && searchNodes >= sliceEnd)
+    {
+        searchAborted = true;
+        sliceExpired = true;
+        return 0;
+    }
+    
+    if (_depth <= 0 && searchOptions.quiescence) { return quiescence(_gs, _alpha, _beta, _ply, 0); }
+    
+    searchNodes++;
+    pvLength[_ply] = _ply;
+    
+    // the move here took a king
+    if (_gs->captured == PieceType::W_KING) { return -(MATE_EVALUATION - _ply); }
+    if (_gs->captured == PieceType::B_KING) { return MATE_EVALUATION - _ply; }
+    
+    if (_gs->resolved) { return _gs->evaluation; } // drawn, see genChildren()
+    
+    float tbEvaluation;
+    if (tbLargest() > 0 && countPieces(_gs) <= tbLargest() && tbProbeWDL(_gs, tbEvaluation))
+    {
+        tbHits++;
+        return tbEvaluation;
+    }
+    if (_ply >= endgamePly && countPieces(_gs) <= ENDGAME_MAX_PIECES && endgameProbe(_gs, tbEvaluation))
+    {
+        endgameHits++;
+        return tbEvaluation;
+    }
+    
+    if (_depth <= 0 || _ply >= MAX_SEARCH_PLY-1) { return staticEval(_gs); }
+    
+    // TRANSPOSITION TABLE - a bound from a search at least as deep may settle the node, NOTE never while following the PV so the line stays whole
+    float alphaIn = _alpha;
+    float betaIn = _beta;
+    uint16_t hashMove = 0; // the entry's move, tried before anything is generated
+    if (tt != nullptr && !followPV)
+    {
+        ttProbes++;
+        TTData entry;
+        if (tt->probe(_gs->positionKey, entry))
+        {
+            ttHits++;
+            hashMove = entry.move;
+            float score = (entry.score > MATE_EVALUATION/2 ? entry.score - _ply : (entry.score < -MATE_EVALUATION/2 ? entry.score + _ply : entry.score)); // NOTE stored counted from the node
+            if (entry.depth >= _depth && entry.bound != TTBound::UPPER && score >= _beta) { return score; }
+            if (entry.depth >= _depth && entry.bound != TTBound::LOWER && score <= _alpha) { return score; }
+        }
+    }
+    
+    bool white = _gs->whiteTurn;
+    bool inCheck = kingAttacked(_gs, white);
+    float standing = ((searchOptions.nullMove || searchOptions.futility) && !inCheck ? staticEval(_gs) : 0);
+    
+    // NULL MOVE - pass, if the opponent still can't get below beta (above alpha for black) neither can any real move
+    if (searchOptions.nullMove && _nullAllowed && !followPV && !inCheck && _depth >= 3 && hasPieces(_gs, white) && (white ? standing >= _beta : standing <= _alpha))
+    {
+        GameState nullGS(_gs);
+        nullGS.board = _gs->board;
+        nullGS.positionKey = nullGS.boardKey ^ zobristStateKey(&nullGS);
+        int reduction = NULL_MOVE_REDUCTION + (_depth >= 6 ? 1:0);
+        if (white)
+        {
+            float score = alphaBeta(&nullGS, _depth-1-reduction, _beta-NULL_WINDOW, _beta, _ply+1, false);
+            if (score >= _beta) { return _beta; } // NOTE not score, a mate found after passing isn't proven
+        }
+        else
+        {
+            float score = alphaBeta(&nullGS, _depth-1-reduction, _alpha, _alpha+NULL_WINDOW, _ply+1, false);
+            if (score <= _alpha) { return _alpha; }
+        }
+    }
+    
+    // RAZORING - hopelessly behind close to the horizon, only a capture could still help
+    if (searchOptions.futility && !inCheck && _depth <= 2)
+    {
+        float margin = RAZOR_MARGIN*_depth;
+        if (white && standing + margin <= _alpha)
+        {
+            float score = (searchOptions.quiescence ? quiescence(_gs, _alpha, _beta, _ply, 0) : standing);
+            if (score <= _alpha) { return score; }
+        }
+        else if (!white && standing - margin >= _beta)
+        {
+            float score = (searchOptions.quiescence ? quiescence(_gs, _alpha, _beta, _ply, 0) : standing);
+            if (score >= _beta) { return score; }
+        }
+    }
+    
+    // STAGED GENERATION - the hash move, then captures, then killers, then the rest of the quiet moves, each generated once the last stage has run out
+    // NOTE a node still on the PV generates everything at once so the PV move can go first, it has no hash move since it doesn't probe
+    PickStage stage = PickStage::DONE;
+    std::vector<std::unique_ptr<GameState>> losingCaptures;
+    std::vector<std::unique_ptr<GameState>> laterQuiets;
+    uint64_t generated = 0; // squares whose pieces' quiet moves are already there
+    if (searchOptions.staged && !followPV) { stage = (hashMove != 0 ? PickStage::HASH_MOVE : PickStage::CAPTURES); }
+    else
+    {
+        genChildren(_gs);
+        orderChildren(_gs);
+        if (followPV) { followPV = pvFirst(_gs, _ply); } // the last depth's best line goes first
+        else if (hashMove != 0)
+        {
+            auto found = std::find_if(_gs->nextLevel.begin(), _gs->nextLevel.end(), [hashMove](const std::unique_ptr<GameState> &_child) { return isMove(_child.get(), hashMove); });
+            if (found != _gs->nextLevel.end()) { std::rotate(_gs->nextLevel.begin(), found, found+1); }
+        }
+    }
+    bool hashMoveFirst = false; // then the later stages leave it out
+    auto dropHashMove = [&](std::vector<std::unique_ptr<GameState>> &_children, int _first)
+    {
+        if (!hashMoveFirst) { return; }
+        auto found = std::find_if(_children.begin()+_first, _children.end(), [hashMove](const std::unique_ptr<GameState> &_child) { return isMove(_child.get(), hashMove); });
+        if (found != _children.end()) { _children.erase(found); }
+    };
+    auto nextStage = [&]()
+    {
+        int first = (int)_gs->nextLevel.size();
+        switch(stage)
+        {
+            case (PickStage::HASH_MOVE):
+                hashMoveFirst = genHashMove(_gs, hashMove);
+                stage = PickStage::CAPTURES;
+                break;
+            case (PickStage::CAPTURES):
+            {
+                genChildren(_gs, GenStage::CAPTURES);
+                dropHashMove(_gs->nextLevel, first);
+                int ahead = orderChildren(_gs, first);
+                for (int i = first+ahead; i < (int)_gs->nextLevel.size(); i++) { losingCaptures.push_back(std::move(_gs->nextLevel[i])); }
+                _gs->nextLevel.resize(first+ahead);
+                stage = PickStage::KILLERS;
+                break;
+            }
+            case (PickStage::KILLERS):
+                genKillers(_gs, _ply, generated, laterQuiets);
+                dropHashMove(_gs->nextLevel, first);
+                dropHashMove(laterQuiets, 0);
+                stage = PickStage::QUIETS;
+                break;
+            case (PickStage::QUIETS):
+                genChildren(_gs, GenStage::QUIETS, generated);
+                dropHashMove(_gs->nextLevel, first);
+                for (auto &child : laterQuiets) { _gs->nextLevel.push_back(std::move(child)); }
+                STATS_ADD(stats.quietGenerations, 1);
+                stage = PickStage::LOSING_CAPTURES;
+                break;
+            case (PickStage::LOSING_CAPTURES):
+                for (auto &child : losingCaptures) { _gs->nextLevel.push_back(std::move(child)); }
+                stage = PickStage::DONE;
+                break;
+            default:
+                break;
+        }
+    };
+    
+    // FUTILITY - at the frontier a quiet move can't make up more than the margin
+    bool futile = searchOptions.futility && !inCheck && _depth == 1 && (white ? standing + FUTILITY_MARGIN <= _alpha : standing - FUTILITY_MARGIN >= _beta);
+    
+    float best = (white ? -SEARCH_INFINITY : SEARCH_INFINITY);
+    uint16_t bestMove = 0; // the last move that raised alpha (lowered beta for black), for the transposition table
+    int searched = 0;
+    bool pruned = false; // futility skipped a move, which is only known not to beat alpha (beta for black)
+    for (int i = 0; ; i++)
+    {
+        while (i == (int)_gs->nextLevel.size() && stage != PickStage::DONE) { nextStage(); }
+        if (i == (int)_gs->nextLevel.size()) { break; }
+        
+        GameState* child = _gs->nextLevel[i].get();
+        bool quiet = isQuiet(_gs, child);
+        bool reduce = searchOptions.lateMoveReductions && quiet && !inCheck && _depth >= 3 && i >= LMR_FIRST_MOVE;
+        bool givesCheck = ((futile || reduce) && quiet ? kingAttacked(child, child->whiteTurn) : false);
+        
+        if (futile && quiet && !givesCheck && searched > 0)
+        {
+            pruned = true;
+            continue;
+        }
+        
+        // SEE - close to the horizon a capture that loses material on the spot isn't worth a look
+        if (searchOptions.see && !quiet && !inCheck && _depth <= SEE_PRUNING_DEPTH && searched > 0 && staticExchange(_gs, child) < 0) { continue; }
+        
+        // LATE MOVE REDUCTION - the later the move is ordered the less it is trusted
+        int reduction = (reduce && !givesCheck ? (i >= 3*LMR_FIRST_MOVE ? 2:1) : 0);
+        float score = searchChild(_gs, child, _depth-1, reduction, searched > 0 && searchOptions.pvs, _alpha, _beta, _ply+1);
+        followPV = false; // only the first child can still be on the PV
+        searched++;
+        
+        // Maximize
+        if (white)
+        {
+            if (score > best) { best = score; }
+            if (score > _alpha)
+            {
+                _alpha = score;
+                updatePV(_ply, child);
+                bestMove = ttMove(child->fromX, child->fromY, child->toX, child->toY);
+            }
+        }
+        // Minimize
+        else
+        {
+            if (score < best) { best = score; }
+            if (score < _beta)
+            {
+                _beta = score;
+                updatePV(_ply, child);
+                bestMove = ttMove(child->fromX, child->fromY, child->toX, child->toY);
+            }
+        }
+        if (_alpha >= _beta)
+        {
+            if (quiet) { storeKiller(_ply, child); }
+            break;
+        }
+    }
+    if (searchOptions.staged && (stage == PickStage::CAPTURES || stage == PickStage::KILLERS || stage == PickStage::QUIETS)) { STATS_ADD(stats.quietGenerationsSkipped, 1); }
+    _gs->nextLevel.clear(); // NOTE frees the whole subtree, only the root's children outlive a search
+    
+    if (searched == 0) { return staticEval(_gs); } // nothing to move
+    
+    if (tt != nullptr && !searchAborted)
+    {
+        float stored = best;
+        if (pruned) { stored = (white ? std::max(best, alphaIn) : std::min(best, betaIn)); }
+        TTBound bound = (stored <= alphaIn ? TTBound::UPPER : (stored >= betaIn ? TTBound::LOWER : TTBound::EXACT));
+        if (std::fabs(stored) > MATE_EVALUATION/2) { stored += (stored > 0 ? _ply : -_ply); }
+        tt->store(_gs->positionKey, ttSession, _depth, stored, bound, bestMove);
+    }
+    return best;
+}
+
+float StateTree::quiescence(GameState* _gs, float _alpha, float _beta, int _ply, int _qPly)
+{
+    searchNodes++;
+    pvLength[_ply] = _ply; // NOTE the PV stops at the horizon
+    followPV = false;
+    
+    if (_gs->captured == PieceType::W_KING) { return -(MATE_EVALUATION - _ply); }
+    if (_gs->captured == PieceType::B_KING) { return MATE_EVALUATION - _ply; }
+    if (_gs->resolved) { return _gs->evaluation; }
+    
+    // stand pat, the side to move doesn't have to capture
+    float best = staticEval(_gs);
+    if (_qPly >= MAX_QUIESCENCE_PLY || _ply >= MAX_SEARCH_PLY-1) { return best; }
+    bool white = _gs->whiteTurn;
+    if (white)
+    {
+        if (best >= _beta) { return best; }
+        if (best > _alpha) { _alpha = best; }
+    }
+    else
+    {
+        if (best <= _alpha) { return best; }
+        if (best < _beta) { _beta = best; }
+    }
+    
+    genChildren(_gs, (searchOptions.staged ? GenStage::CAPTURES : GenStage::ALL));
+    int ahead = orderChildren(_gs); // NOTE captures losing material (searchOptions.see) are never tried
+    for (int i = 0; i < ahead; i++)
+    {
+        GameState* child = _gs->nextLevel[i].get();
+        
+        float score = quiescence(child, _alpha, _beta, _ply+1, _qPly+1);
+        if (white)
+        {
+            if (score > best) { best = score; }
+            if (score > _alpha) { _alpha = score; }
+        }
+        else
+        {
+            if (score < best) { best = score; }
+            if (score < _beta) { _beta = score; }
+        }
+        if (_alpha >= _beta) { break; }
+    }
+    _gs->nextLevel.clear();
+    return best;
+}
+
+float StateTree::staticEval(GameState* _gs)
+{
+    STATS_TIME(stats.evalTicks);
+    STATS_ADD(stats.nodesEvaluated, 1);
+    cachedEvaluate(_gs);
+    return _gs->evaluation;
+}
+
+int StateTree::orderChildren(GameState* _gs, int _first)
+{
+    // captures that win material or break even, then quiet moves in generation order, then captures that lose material
+    std::vector<std::pair<int, std::unique_ptr<GameState>>> scored;
+    scored.reserve(_gs->nextLevel.size() - _first);
+    int ahead = 0;
+    for (int i = _first; i < (int)_gs->nextLevel.size(); i++)
+    {
+        GameState* child = _gs->nextLevel[i].get();
+        int score = 0;
+        if (!isQuiet(_gs, child))
+        {
+            PieceType piece = _gs->board[child->fromX][child->fromY];
+            int exchange = (searchOptions.see ? staticExchange(_gs, child) : 0);
+            if (exchange < 0) { score = -1000 + exchange; }
+            else { score = 1000 + 10*seeValue(child->captured) - seeValue(piece) + seeValue(child->board[child->toX][child->toY]) - seeValue(piece); } // most valuable victim, least valuable attacker, promotions count as winning the difference
+        }
+        if (score > 0) { ahead++; }
+        scored.push_back(std::make_pair(score, std::move(_gs->nextLevel[i])));
+    }
+    std::stable_sort(scored.begin(), scored.end(), [](const std::pair<int, std::unique_ptr<GameState>> &_a, const std::pair<int, std::unique_ptr<GameState>> &_b) { return _a.first > _b.first; });
+    for (int i = 0; i < (int)scored.size(); i++) { _gs->nextLevel[_first+i] = std::move(scored[i].second); }
+    return ahead;
+}
+
+bool StateTree::genHashMove(GameState* _gs, uint16_t _move)
+{
+    int first = (int)_gs->nextLevel.size();
+    int x1 = _move & 7;
+    int y1 = (_move >> 3) & 7;
+    int x2 = (_move >> 6) & 7;
+    PieceType piece = _gs->board[x1][y1];
+    genPieceChildren(_gs, x1, y1); // NOTE does nothing if the piece there isn't the side to move's
+    if ((piece == PieceType::W_KING || piece == PieceType::B_KING) && std::abs(x2-x1) == 2) { evalCastleAbility(_gs); }
+    
+    // only the hash move stays, its piece's other moves come with their stages
+    auto found = std::find_if(_gs->nextLevel.begin()+first, _gs->nextLevel.end(), [_move](const std::unique_ptr<GameState> &_child) { return isMove(_child.get(), _move); });
+    bool legal = (found != _gs->nextLevel.end());
+    if (legal) { std::swap(*found, _gs->nextLevel[first]); }
+    _gs->nextLevel.resize(first + (legal ? 1:0));
+    finishChildren(_gs, first);
+    return legal;
+}
+
+void StateTree::genKillers(GameState* _gs, int _ply, uint64_t &_generated, std::vector<std::unique_ptr<GameState>> &_later)
+{
+    int first = (int)_gs->nextLevel.size();
+    genStage = GenStage::QUIETS;
+    for (const Move &killer : killers[_ply])
+    {
+        if (killer.x1 < 0) { continue; }
+        uint64_t square = 1ULL << (8*killer.y1 + killer.x1);
+        if (_generated & square) { continue; }
+        _generated |= square;
+        genPieceChildren(_gs, killer.x1, killer.y1); // NOTE does nothing if the piece there isn't the side to move's
+    }
+    genStage = GenStage::ALL;
+    finishChildren(_gs, first);
+    
+    // the killers first, the rest of their pieces' moves wait for the other quiet moves
+    int front = first;
+    for (const Move &killer : killers[_ply])
+    {
+        for (int i = front; i < (int)_gs->nextLevel.size(); i++)
+        {
+            const GameState* child = _gs->nextLevel[i].get();
+            if (child->fromX == killer.x1 && child->fromY == killer.y1 && child->toX == killer.x2 && child->toY == killer.y2)
+            {
+                std::rotate(_gs->nextLevel.begin()+front, _gs->nextLevel.begin()+i, _gs->nextLevel.begin()+i+1);
+                front++;
+                break;
+            }
+        }
+    }
+    for (int i = front; i < (int)_gs->nextLevel.size(); i++) { _later.push_back(std::move(_gs->nextLevel[i])); }
+    _gs->nextLevel.resize(front);
+}
+
+void StateTree::storeKiller(int _ply, const GameState* _child)
+{
+    Move move = Move{_child->fromX, _child->fromY, _child->toX, _child->toY};
+    std::array<Move,KILLER_MOVES> &slots = killers[_ply];
+    if (slots[0].x1 == move.x1 && slots[0].y1 == move.y1 && slots[0].x2 == move.x2 && slots[0].y2 == move.y2) { return; }
+    for (int i = KILLER_MOVES-1; i > 0; i--) { slots[i] = slots[i-1]; }
+    slots[0] = move;
+}
@@ -0,0 +1,113 @@
+#ifndef SEARCH_HPP
+#define SEARCH_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/* Depth-first search settings, see StateTree::searchDepthFirst()
+ *
+ * Each of the selective techniques can be switched off on its own so its effect on nodes-to-depth and playing strength can be measured against the same baseline:
+ * - null move: let the side to move pass at reduced depth, if that still fails high the real moves will too. Skipped in check, right after another null move
+ *   and when the side to move has nothing but king and pawns (zugzwang)
+ * - late move reductions: quiet moves that come late in the move ordering are searched shallower with a null window and only re-searched at full depth if they beat alpha
+ * - futility: at depth 1 quiet moves are skipped when the static evaluation plus a margin can't reach alpha, at depth 2 and below a position that far behind
+ *   drops straight into quiescence (razoring)
+ * - quiescence: captures and promotions are played out past the horizon instead of evaluating in the middle of an exchange
+ * - static exchange evaluation: captures are ordered by what they win once every recapture on the square is played out (see See.hpp), captures that lose material
+ *   are never tried in quiescence and skipped near the horizon
+ *
+ * and so can the techniques that only save work without changing the result:
+ * - principal variation search: only the first move gets the full window, the rest are scouted with a null window and re-searched if they turn out better
+ * - aspiration windows: each depth starts with a window around the last depth's score and widens it if the score falls outside
+ * - staged move generation: a node makes its captures first and tries them, then the killer moves (quiet moves that cut off at the same ply elsewhere)
+ *   and only then generates the remaining quiet moves, so a node that cuts off early never generates its quiet moves. Quiescence only generates captures
+*/
+
+const float MATE_EVALUATION = 100000; // same as a king in evaluate(), a king captured n plies from the root scores MATE_EVALUATION-n so quicker mates are preferred
+const float SEARCH_INFINITY = 1000000;
+
+const float NULL_WINDOW = 0.01; // evaluations are floats, this is the width of a "zero" window
+const float FUTILITY_MARGIN = 2; // in pawns
+const float RAZOR_MARGIN = 3.5; // in pawns, per ply of remaining depth
+const int NULL_MOVE_REDUCTION = 2; // plies, one more from depth 6
+const int LMR_FIRST_MOVE = 3; // moves ranked below this are never reduced
+const int SEE_PRUNING_DEPTH = 2; // losing captures are skipped from this many plies before the horizon
+const int MAX_QUIESCENCE_PLY = 8; // captures past the horizon before quiescence stands pat regardless
+const float ASPIRATION_WINDOW = 0.5; // in pawns either side of the last depth's score, doubled on every fail
+const int MAX_SEARCH_PLY = 64; // deepest ply the search goes, quiescence included, NOTE sizes the PV table
+const int KILLER_MOVES = 2; // remembered per ply
+
+struct SearchOptions
+{
+    bool depthFirst; // pushComputerState() searches with searchDepthFirst() instead of minimaxEval() on the materialized tree
+    int depth; // plies searched by pushComputerState() when depthFirst is set
+    bool nullMove;
+    bool lateMoveReductions;
+    bool futility; // futility pruning and razoring
+    bool quiescence;
+    bool see; // static exchange evaluation for ordering and pruning captures
+    bool pvs; // principal variation search
+    bool aspiration;
+    bool staged; // staged move generation
+    int multiPV; // root moves searched for an exact score and line, see StateTree::searchRootMultiPV(), NOTE aspiration windows are off when this is above 1
+    int checkpointInterval; // the materialized tree keeps the boards of every checkpointInterval-th ply only and replays the moves from them when it needs another, see StateTree::materialize(), 1 keeps every board
+    
+    bool mcts; // pushComputerState() searches with searchMcts() instead, NOTE depthFirst is false whenever this is set
+    long mctsPlayouts; // per move, see Mcts.hpp
+    int mctsThreads;
+    bool lightPlayouts; // playouts prefer captures, false plays uniformly random moves
+    
+    SearchOptions()
+    {
+        depthFirst = false;
+        depth = 4;
+        nullMove = true;
+        lateMoveReductions = true;
+        futility = true;
+        quiescence = true;
+        see = true;
+        pvs = true;
+        aspiration = true;
+        staged = true;
+        multiPV = 1;
+        checkpointInterval = 4;
+        mcts = false;
+        mctsPlayouts = 20000;
+        mctsThreads = 1;
+        lightPlayouts = true;
+    }
+};
+
+struct Move
+{
+    std::int8_t x1, y1, x2, y2;
+};
+
+struct SearchLine
+{
+    float evaluation; // white-relative, exact
+    std::vector<Move> pv; // starting with the root move
+};
+
+struct SearchIteration
+{
+    int depth;
+    float evaluation; // white-relative
+    std::string bestMove; // UCI
+    long nodes; // total for the search so far
+    double ms; // total for the search so far
+    std::vector<Move> pv; // expected line, starting with the best move
+    int researches; // aspiration windows that had to be widened
+};
+
+/* Reads a comma separated search spec into _options, returns false (leaving _options partly changed) on an unknown word
+ *
+ * "tree", "dfs" or "mcts" picks the search, "-null", "-lmr", "-futility", "-qsearch", "-see", "-pvs", "-aspiration" and "-staged" switch a technique off and "+..." back on, e.g. "dfs,-null,-lmr",
+ * "-light" makes the Monte Carlo playouts uniformly random
+*/
+bool parseSearchSpec(const std::string &_spec, SearchOptions &_options);
+
+std::string describeSearch(const SearchOptions &_options); // inverse of parseSearchSpec(), for logs and PGN headers
+
+#endif
@@ -0,0 +1,81 @@
+#include <cstdint>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+#include "SearchStats.hpp"
+
+void SearchStats::reset()
+{
+    genTicks = 0;
+    evalTicks = 0;
+    minimaxTicks = 0;
+    moveDiffTicks = 0;
+    nodesGenerated = 0;
+    nodesEvaluated = 0;
+    peakTreeSize = 0;
+    quietGenerations = 0;
+    quietGenerationsSkipped = 0;
+    parentsPerPly.clear();
+    childrenPerPly.clear();
+    startTicks = statsClock();
+    startTime = std::chrono::steady_clock::now();
+}
+
+void SearchStats::addExpansion(int _ply, long _children)
+{
+    if ((int)parentsPerPly.size() <= _ply)
+    {
+        parentsPerPly.resize(_ply+1, 0);
+        childrenPerPly.resize(_ply+1, 0);
+    }
+    parentsPerPly[_ply]++;
+    childrenPerPly[_ply] += _children;
+}
+
+double SearchStats::ticksPerNs() const
+{
+    double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+    uint64_t ticks = statsClock() - startTicks;
+    return (ns > 0 && ticks > 0 ? ticks/ns : 1.0);
+}
+
+void SearchStats::print(std::ostream &_out) const
+{
+    if (!SEARCH_STATS_ENABLED)
+    {
+        _out << "Search stats not compiled in, rebuild with make STATS=1\n";
+        return;
+    }
+    
+    double scale = 1.0/ticksPerNs();
+    double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    double genMs = genTicks*scale*1e-6;
+    double evalMs = evalTicks*scale*1e-6;
+    double backupMs = (minimaxTicks >= evalTicks ? minimaxTicks-evalTicks : 0)*scale*1e-6;
+    double diffMs = moveDiffTicks*scale*1e-6;
+    double searchMs = genMs + minimaxTicks*scale*1e-6 + diffMs;
+    
+    _out << std::fixed << std::setprecision(3);
+    _out << "--- search stats (" << wallMs << " ms wall) ---\n";
+    _out << "genLevel    " << genMs << " ms\n";
+    _out << "evaluate    " << evalMs << " ms\n";
+    _out << "minimax     " << backupMs << " ms (backup only)\n";
+    _out << "move diff   " << diffMs << " ms\n";
+    _out << "generated   " << nodesGenerated << " nodes\n";
+    _out << "evaluated   " << nodesEvaluated << " leaves\n";
+    _out << "peak tree   " << peakTreeSize << " nodes\n";
+    if (quietGenerations + quietGenerationsSkipped > 0)
+    {
+        _out << "quiet gen   " << quietGenerations << " nodes, skipped at " << quietGenerationsSkipped << " ("
+             << 100.0*quietGenerationsSkipped/(quietGenerations + quietGenerationsSkipped) << "%)\n";
+    }
+    _out << "NPS         " << (searchMs > 0 ? (long)(nodesGenerated/(searchMs*1e-3)) : 0) << '\n';
+    _out << "branching  ";
+    for (int ply = 0; ply < (int)parentsPerPly.size(); ply++)
+    {
+        _out << ' ' << (parentsPerPly[ply] > 0 ? (double)childrenPerPly[ply]/parentsPerPly[ply] : 0.0);
+    }
+    _out << '\n';
+    _out << std::defaultfloat;
+}
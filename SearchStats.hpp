@@ -0,0 +1,89 @@
+#ifndef SEARCHSTATS_HPP
+#define SEARCHSTATS_HPP
+
+#include <cstdint>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+/* Search instrumentation
+ * 
+ * NOTE Only compiled in with -DSEARCH_STATS ("make STATS=1"). Without it the STATS_* macros expand to nothing, so the search pays nothing and every counter stays 0.
+ * Phase timers count ticks of statsClock() (the TSC on x86, nanoseconds elsewhere) and are converted to nanoseconds against the wall clock when printed.
+*/
+
+#ifdef SEARCH_STATS
+const bool SEARCH_STATS_ENABLED = true;
+#else
+const bool SEARCH_STATS_ENABLED = false;
+#endif
+
+inline uint64_t statsClock()
+{
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    return __rdtsc();
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+struct SearchStats
+{
+    // phase timers, in statsClock() ticks
+    uint64_t genTicks; // genLevel()
+    uint64_t evalTicks; // evaluate() on the leaves
+    uint64_t minimaxTicks; // minimaxEval() including the leaf evaluations above
+    uint64_t moveDiffTicks; // childMove()
+    
+    long nodesGenerated;
+    long nodesEvaluated;
+    long peakTreeSize; // largest liveNodes seen after a genLevel()
+    long quietGenerations; // depth-first nodes that got as far as generating their quiet moves
+    long quietGenerationsSkipped; // and the ones that cut off before, with searchOptions.staged
+    std::vector<long> parentsPerPly; // GameStates expanded at each ply below the current state
+    std::vector<long> childrenPerPly; // children they produced, childrenPerPly[i]/parentsPerPly[i] is the branching factor at ply i
+    
+    uint64_t startTicks;
+    std::chrono::steady_clock::time_point startTime;
+    
+    SearchStats() { reset(); }
+    
+    void reset(); // zeroes everything and restarts the clock used for NPS and tick conversion
+    
+    void addExpansion(int _ply, long _children);
+    
+    double ticksPerNs() const;
+    
+    void print(std::ostream &_out) const; // one block of text covering everything since the last reset()
+};
+
+// adds the ticks spent in the enclosing scope to a counter
+struct StatsScope
+{
+    uint64_t &counter;
+    uint64_t start;
+    StatsScope(uint64_t &_counter) : counter(_counter), start(statsClock()) {}
+    ~StatsScope() { counter += statsClock() - start; }
+};
+
+#ifdef SEARCH_STATS
+#define STATS_CONCAT_(a, b) a##b
+#define STATS_CONCAT(a, b) STATS_CONCAT_(a, b)
+#define STATS_TIME(_counter) StatsScope STATS_CONCAT(statsScope, __LINE__)(_counter)
+#define STATS_ADD(_counter, _amount) ((_counter) += (_amount))
+#define STATS_DO(_statement) _statement
+#else
+#define STATS_TIME(_counter)
+#define STATS_ADD(_counter, _amount) ((void)0)
+#define STATS_DO(_statement)
+#endif
+
+#endif
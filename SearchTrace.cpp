@@ -0,0 +1,78 @@
+#include <string>
+#include <fstream>
+#include <vector>
+#include <chrono>
+
+#include "SearchTrace.hpp"
+
+SearchTrace::SearchTrace()
+{
+    searchId = 0;
+    searchStarted = false;
+}
+
+bool SearchTrace::open(const std::string &_path)
+{
+    out.open(_path, std::ios::trunc);
+    return (bool)out;
+}
+
+bool SearchTrace::isOpen() const
+{
+    return out.is_open();
+}
+
+void SearchTrace::startSearch()
+{
+    if (searchStarted) { return; }
+    searchStarted = true;
+    searchStart = std::chrono::steady_clock::now();
+    parents.clear();
+    children.clear();
+    maxChildren.clear();
+}
+
+void SearchTrace::expansion(int _gamePly, long _children)
+{
+    startSearch();
+    if ((int)parents.size() <= _gamePly)
+    {
+        parents.resize(_gamePly+1, 0);
+        children.resize(_gamePly+1, 0);
+        maxChildren.resize(_gamePly+1, 0);
+    }
+    parents[_gamePly]++;
+    children[_gamePly] += _children;
+    if (_children > maxChildren[_gamePly]) { maxChildren[_gamePly] = _children; }
+}
+
+void SearchTrace::level(double _ms, long _newNodes, long _liveNodes, bool _budgetReached)
+{
+    startSearch();
+    out << "{\"type\":\"level\",\"search\":" << searchId << ",\"ms\":" << _ms << ",\"new_nodes\":" << _newNodes
+        << ",\"live_nodes\":" << _liveNodes << ",\"budget_reached\":" << (_budgetReached ? "true" : "false") << "}\n";
+}
+
+void SearchTrace::rootMove(const std::string &_move, long _nodes, float _evaluation)
+{
+    startSearch();
+    out << "{\"type\":\"root\",\"search\":" << searchId << ",\"move\":\"" << _move << "\",\"nodes\":" << _nodes << ",\"evaluation\":" << _evaluation << "}\n";
+}
+
+void SearchTrace::finishSearch(int _rootGamePly, const std::string &_fen, const std::string &_bestMove, float _evaluation, long _nodes, int _depth)
+{
+    startSearch();
+    // NOTE expansions above the root belong to positions the game has already left
+    for (int gamePly = (_rootGamePly > 0 ? _rootGamePly : 0); gamePly < (int)parents.size(); gamePly++)
+    {
+        out << "{\"type\":\"ply\",\"search\":" << searchId << ",\"ply\":" << gamePly-_rootGamePly << ",\"parents\":" << parents[gamePly]
+            << ",\"children\":" << children[gamePly] << ",\"max_children\":" << maxChildren[gamePly] << "}\n";
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - searchStart).count();
+    out << "{\"type\":\"search\",\"search\":" << searchId << ",\"fen\":\"" << _fen << "\",\"best\":\"" << _bestMove << "\",\"evaluation\":" << _evaluation
+        << ",\"nodes\":" << _nodes << ",\"depth\":" << _depth << ",\"ms\":" << ms << "}\n";
+    out.flush(); // NOTE flushed per search so a killed process still leaves every finished search behind
+    
+    searchId++;
+    searchStarted = false;
+}
@@ -0,0 +1,46 @@
+#ifndef SEARCHTRACE_HPP
+#define SEARCHTRACE_HPP
+
+#include <string>
+#include <fstream>
+#include <vector>
+#include <chrono>
+
+/* Streams the shape of each search to a JSON Lines file, read back by the tracesum tool
+ * 
+ * One "search" covers everything between two finishSearch() calls (usually one computer move). Records, one flat object per line:
+ * {"type":"level","search":S,"ms":T,"new_nodes":N,"live_nodes":L,"budget_reached":B}     after every genLevel()
+ * {"type":"ply","search":S,"ply":P,"parents":N,"children":C,"max_children":M}            per ply, when the search finishes
+ * {"type":"root","search":S,"move":"e2e4","nodes":N,"evaluation":E}                       per root move, when the search finishes
+ * {"type":"search","search":S,"fen":F,"best":"e2e4","evaluation":E,"nodes":N,"depth":D,"ms":T}
+*/
+class SearchTrace
+{
+public:
+    SearchTrace();
+    
+    bool open(const std::string &_path); // truncates _path, returns false if it can't be written
+    
+    bool isOpen() const;
+    
+    void expansion(int _gamePly, long _children); // one GameState _gamePly moves into the game produced _children children, NOTE counted from the start of the game because the root moves on while a search is being built
+    
+    void level(double _ms, long _newNodes, long _liveNodes, bool _budgetReached);
+    
+    void rootMove(const std::string &_move, long _nodes, float _evaluation);
+    
+    void finishSearch(int _rootGamePly, const std::string &_fen, const std::string &_bestMove, float _evaluation, long _nodes, int _depth); // writes the per-ply records relative to the root and the search summary
+    
+private:
+    std::ofstream out;
+    long searchId;
+    bool searchStarted;
+    std::chrono::steady_clock::time_point searchStart;
+    std::vector<long> parents; // indexed by game ply
+    std::vector<long> children;
+    std::vector<long> maxChildren;
+    
+    void startSearch(); // called lazily by the first record of a search
+};
+
+#endif
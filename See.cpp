@@ -0,0 +1,125 @@
+#include <array>
+#include <algorithm>
+
+#include "See.hpp"
+
+int seeValue(PieceType _piece)
+{
+    switch(_piece)
+    {
+        case (PieceType::W_PAWN): case (PieceType::B_PAWN): return 1;
+        case (PieceType::W_KNIGHT): case (PieceType::B_KNIGHT): return 3;
+        case (PieceType::W_BISHOP): case (PieceType::B_BISHOP): return 3;
+        case (PieceType::W_ROOK): case (PieceType::B_ROOK): return 5;
+        case (PieceType::W_QUEEN): case (PieceType::B_QUEEN): return 9;
+        case (PieceType::W_KING): case (PieceType::B_KING): return 100;
+        default: return 0;
+    }
+}
+
+bool leastValuableAttacker(const std::array<std::array<PieceType,8>,8> &_board, int _x, int _y, bool _byWhite, int &_ax, int &_ay)
+{
+    PieceType pawn = (_byWhite ? PieceType::W_PAWN : PieceType::B_PAWN);
+    PieceType knight = (_byWhite ? PieceType::W_KNIGHT : PieceType::B_KNIGHT);
+    PieceType bishop = (_byWhite ? PieceType::W_BISHOP : PieceType::B_BISHOP);
+    PieceType rook = (_byWhite ? PieceType::W_ROOK : PieceType::B_ROOK);
+    PieceType queen = (_byWhite ? PieceType::W_QUEEN : PieceType::B_QUEEN);
+    PieceType king = (_byWhite ? PieceType::W_KING : PieceType::B_KING);
+    
+    // PAWNS
+    int pawnY = _y + (_byWhite ? -1:1);
+    if (pawnY >= 0 && pawnY <= 7)
+    {
+        for (int dx = -1; dx <= 1; dx += 2)
+        {
+            if (_x+dx >= 0 && _x+dx <= 7 && _board[_x+dx][pawnY] == pawn) { _ax = _x+dx; _ay = pawnY; return true; }
+        }
+    }
+    
+    // KNIGHTS
+    const int knightJumps[8][2] = {{1,2},{2,1},{2,-1},{1,-2},{-1,-2},{-2,-1},{-2,1},{-1,2}};
+    for (const auto &jump : knightJumps)
+    {
+        int x = _x+jump[0];
+        int y = _y+jump[1];
+        if (x >= 0 && x <= 7 && y >= 0 && y <= 7 && _board[x][y] == knight) { _ax = x; _ay = y; return true; }
+    }
+    
+    // SLIDERS - the first piece on each ray, cheapest one wins
+    int best = 0;
+    for (int dx = -1; dx <= 1; dx++)
+    {
+        for (int dy = -1; dy <= 1; dy++)
+        {
+            if (dx == 0 && dy == 0) { continue; }
+            bool diagonal = (dx != 0 && dy != 0);
+            int x = _x+dx;
+            int y = _y+dy;
+            while (x >= 0 && x <= 7 && y >= 0 && y <= 7 && _board[x][y] == PieceType::EMPTY) { x += dx; y += dy; }
+            if (x < 0 || x > 7 || y < 0 || y > 7) { continue; }
+            
+            PieceType piece = _board[x][y];
+            if (piece == queen || (diagonal && piece == bishop) || (!diagonal && piece == rook))
+            {
+                if (best == 0 || seeValue(piece) < best)
+                {
+                    best = seeValue(piece);
+                    _ax = x;
+                    _ay = y;
+                }
+            }
+        }
+    }
+    if (best != 0) { return true; }
+    
+    // KING
+    for (int dx = -1; dx <= 1; dx++)
+    {
+        for (int dy = -1; dy <= 1; dy++)
+        {
+            int x = _x+dx;
+            int y = _y+dy;
+            if ((dx != 0 || dy != 0) && x >= 0 && x <= 7 && y >= 0 && y <= 7 && _board[x][y] == king) { _ax = x; _ay = y; return true; }
+        }
+    }
+    return false;
+}
+
+int staticExchange(const GameState* _gs, const GameState* _child)
+{
+    int x = _child->toX;
+    int y = _child->toY;
+    std::array<std::array<PieceType,8>,8> board = _gs->board;
+    
+    // gain[n] is what the side making capture n has won if the exchange stops right after it
+    int gain[32];
+    PieceType promoted = _child->board[x][y]; // NOTE differs from the moving piece after a promotion
+    gain[0] = seeValue(_child->captured) + seeValue(promoted) - seeValue(board[_child->fromX][_child->fromY]);
+    if (board[x][y] == PieceType::EMPTY && _child->captured != PieceType::EMPTY) { board[x][_child->fromY] = PieceType::EMPTY; } // en passant
+    board[_child->fromX][_child->fromY] = PieceType::EMPTY;
+    board[x][y] = promoted;
+    
+    int captures = 0;
+    bool white = !_gs->whiteTurn;
+    int ax, ay;
+    while (captures < 31 && leastValuableAttacker(board, x, y, white, ax, ay))
+    {
+        captures++;
+        PieceType attacker = board[ax][ay];
+        // a pawn recapturing on the last rank comes out as a queen, like addChild() promotes it
+        if (attacker == PieceType::W_PAWN && y == 7) { attacker = PieceType::W_QUEEN; }
+        if (attacker == PieceType::B_PAWN && y == 0) { attacker = PieceType::B_QUEEN; }
+        gain[captures] = seeValue(board[x][y]) + seeValue(attacker) - seeValue(board[ax][ay]) - gain[captures-1];
+        board[x][y] = attacker;
+        board[ax][ay] = PieceType::EMPTY;
+        white = !white;
+    }
+    
+    // each side only makes its capture if it doesn't leave it worse off than stopping
+    while (captures > 0)
+    {
+        gain[captures-1] = -std::max(-gain[captures-1], gain[captures]);
+        captures--;
+    }
+    return gain[0];
+}
@@ -0,0 +1,21 @@
+#ifndef SEE_HPP
+#define SEE_HPP
+
+#include "StateTree.hpp"
+
+/* Static exchange evaluation
+ *
+ * Plays out every capture on the target square, least valuable attacker first for both sides, and lets either side stop as soon as carrying on would lose material.
+ * Attackers are looked up again after each capture so pieces lined up behind one another (x-rays) join in once the piece in front of them has gone.
+ * A pawn that captures onto the last rank, first or as a recapture, counts as the queen it promotes to.
+ *
+ * NOTE Values are whole pawns (pawn 1, knight and bishop 3, rook 5, queen 9, king 100) and pins are ignored, like everywhere else in the engine a king can be captured.
+*/
+
+int seeValue(PieceType _piece); // 0 for EMPTY
+
+bool leastValuableAttacker(const std::array<std::array<PieceType,8>,8> &_board, int _x, int _y, bool _byWhite, int &_ax, int &_ay); // cheapest piece of the given color attacking (_x,_y), false if there is none
+
+int staticExchange(const GameState* _gs, const GameState* _child); // material the side to move in _gs wins (negative if it loses) with the capture leading to _child, counting the exchange that follows on that square
+
+#endif
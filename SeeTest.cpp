@@ -0,0 +1,123 @@
+#include <string>
+#include <iostream>
+
+#include "StateTree.hpp"
+#include "Notation.hpp"
+#include "See.hpp"
+
+/*
+ * seetest - checks staticExchange() and leastValuableAttacker() against exchanges worked out by hand
+ *
+ * Usage: make test
+ *
+ * Prints every case that fails and exits with 1 if there were any, values are whole pawns as in See.hpp
+ */
+
+struct ExchangeCase
+{
+    const char* fen;
+    const char* move; // SAN
+    int expected;
+};
+
+const ExchangeCase EXCHANGE_CASES[] = {
+    {"1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1", "Rxe5", 1}, // free pawn
+    {"1k1r3q/1ppn3p/p4b2/4p3/8/P2N2P1/1PP1R1BP/2K1Q3 w - - 0 1", "Nxe5", -2}, // Nxe5 Nxe5 and white is better off stopping
+    {"4k3/8/8/5p2/6p1/7P/8/4K3 w - - 0 1", "hxg4", 0}, // fxg4
+    {"4k3/1b6/8/8/8/5N2/6P1/4K3 b - - 0 1", "Bxf3", 0}, // gxf3
+    {"4k3/8/2n5/4p3/3P4/5N2/8/4K3 w - - 0 1", "dxe5", 1}, // Nxe5 would lose the knight to Nxe5
+    {"4k3/6p1/8/6Pp/8/8/8/4K3 w - h6 0 1", "gxh6", 0}, // en passant, gxh6
+    {"4r1k1/8/8/4p3/8/8/4R3/4R1K1 w - - 0 1", "Rxe5", 1}, // doubled rooks, Rxe5 Rxe5
+    {"4r1k1/8/8/4p3/8/8/4R3/4Q1K1 w - - 0 1", "Rxe5", 1}, // queen behind the rook, Rxe5 Qxe5
+    {"4r1k1/8/8/4p3/8/8/4Q3/4R1K1 w - - 0 1", "Qxe5", -3}, // rook behind the queen, Rxe5 Rxe5
+    {"4r1k1/4q3/8/4p3/8/8/4R3/4R1K1 w - - 0 1", "Rxe5", 0}, // black's rook behind its queen, Qxe5 Rxe5 Rxe5 evens it out
+    {"3R2k1/2P5/8/8/8/8/7K/3r4 b - - 0 1", "Rxd8", -8}, // cxd8=Q
+    {"3R4/2P1k3/8/8/8/8/7K/3r4 b - - 0 1", "Rxd8", 1}, // cxd8=Q Kxd8
+};
+
+struct AttackerCase
+{
+    const char* fen;
+    const char* target;
+    bool byWhite;
+    const char* removed; // square emptied before looking, "-" for none
+    const char* expected; // "-" if there should be no attacker
+};
+
+const AttackerCase ATTACKER_CASES[] = {
+    {"4r1k1/8/8/4p3/8/8/4R3/4Q1K1 w - - 0 1", "e5", true, "-", "e2"},
+    {"4r1k1/8/8/4p3/8/8/4R3/4Q1K1 w - - 0 1", "e5", true, "e2", "e1"}, // the queen x-rays through the rook
+    {"4r1k1/8/8/4p3/8/8/4Q3/4R1K1 w - - 0 1", "e5", true, "-", "e2"}, // the rook behind can't see past the queen
+    {"4r1k1/4q3/8/4p3/8/8/4R3/4R1K1 w - - 0 1", "e5", false, "e7", "e8"},
+    {"4k3/8/8/4p3/8/2B5/1Q6/4K3 w - - 0 1", "e5", true, "-", "c3"}, // bishop in front of the queen on the diagonal
+    {"4k3/8/8/4p3/8/2B5/1Q6/4K3 w - - 0 1", "e5", true, "c3", "b2"},
+    {"4k3/8/8/4p3/3P4/3N4/8/4K3 w - - 0 1", "e5", true, "-", "d4"}, // pawn before the knight
+    {"4k3/8/8/4p3/8/8/8/4K3 w - - 0 1", "e5", true, "-", "-"},
+};
+
+static bool parseSquare(const std::string &_text, int &_x, int &_y)
+{
+    if (_text.size() != 2 || _text[0] < 'a' || _text[0] > 'h' || _text[1] < '1' || _text[1] > '8') { return false; }
+    _x = _text[0]-'a';
+    _y = _text[1]-'1';
+    return true;
+}
+
+int main()
+{
+    int failures = 0;
+    
+    for (const ExchangeCase &test : EXCHANGE_CASES)
+    {
+        StateTree st;
+        Move move;
+        if (!st.loadFEN(test.fen) || !parseSanMove(st.pastStates.back().get(), test.move, move))
+        {
+            std::cout << " ##### FAIL can't set up " << test.move << " in " << test.fen << " ##### \n";
+            failures++;
+            continue;
+        }
+        GameState* gs = st.pastStates.back().get();
+        st.genChildren(gs);
+        int index = st.findChild(gs, move.x1, move.y1, move.x2, move.y2);
+        if (index == -1)
+        {
+            std::cout << " ##### FAIL " << test.move << " not generated in " << test.fen << " ##### \n";
+            failures++;
+            continue;
+        }
+        int exchange = staticExchange(gs, gs->nextLevel[index].get());
+        if (exchange != test.expected)
+        {
+            std::cout << " ##### FAIL " << test.move << " in " << test.fen << " is " << exchange << ", expected " << test.expected << " ##### \n";
+            failures++;
+        }
+    }
+    
+    for (const AttackerCase &test : ATTACKER_CASES)
+    {
+        GameState gs(nullptr);
+        int x, y;
+        if (!parseFEN(test.fen, &gs) || !parseSquare(test.target, x, y))
+        {
+            std::cout << " ##### FAIL can't set up " << test.target << " in " << test.fen << " ##### \n";
+            failures++;
+            continue;
+        }
+        BoardArray board = gs.board;
+        int rx, ry;
+        if (parseSquare(test.removed, rx, ry)) { board[rx][ry] = PieceType::EMPTY; }
+        
+        int ax, ay;
+        std::string found = (leastValuableAttacker(board, x, y, test.byWhite, ax, ay) ? squareName(ax, ay) : "-");
+        if (found != test.expected)
+        {
+            std::cout << " ##### FAIL attacker of " << test.target << " in " << test.fen << " (without " << test.removed << ") is " << found << ", expected " << test.expected << " ##### \n";
+            failures++;
+        }
+    }
+    
+    int total = (int)(sizeof(EXCHANGE_CASES)/sizeof(EXCHANGE_CASES[0]) + sizeof(ATTACKER_CASES)/sizeof(ATTACKER_CASES[0]));
+    std::cout << total-failures << "/" << total << " SEE checks passed\n";
+    return (failures == 0 ? 0 : 1);
+}
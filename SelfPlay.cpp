@@ -0,0 +1,335 @@
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <iomanip>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include "SelfPlay.hpp"
+#include "StateTree.hpp"
+#include "Notation.hpp"
+
+struct GameRecord
+{
+    std::string startFEN;
+    std::vector<std::string> moves; // SAN
+    std::string result; // "1-0", "0-1" or "1/2-1/2"
+    std::string termination;
+    double cpuSeconds;
+    std::vector<double> moveSeconds; // wall time of each move in moves
+};
+
+// CPU time used by the calling thread
+static double threadCpuSeconds()
+{
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user);
+    auto toSeconds = [](const FILETIME &_t) { return (((unsigned long long)_t.dwHighDateTime << 32) | _t.dwLowDateTime) * 1e-7; };
+    return toSeconds(kernel) + toSeconds(user);
+#else
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+#endif
+}
+
+static bool hasKing(const GameState* _gs, PieceType _king)
+{
+    for (int y = 0; y < 8; y++)
+    {
+        for (int x = 0; x < 8; x++)
+        {
+            if (_gs->board[x][y] == _king) { return true; }
+        }
+    }
+    return false;
+}
+
+// grows the tree under the current state for one move of the given side, _seconds replaces _side.seconds
+static void think(StateTree &_st, const SelfPlaySide &_side, double _seconds)
+{
+    GameState* current = _st.pastStates.back().get();
+    
+    if (_side.search.depthFirst || _side.search.mcts)
+    {
+        _st.genToDepth(1); // NOTE searchDepthFirst() and searchMcts() generate the rest as they go
+        return;
+    }
+    
+    if (_seconds <= 0)
+    {
+        // the tree kept from the opponent's search can be deeper than this side is allowed to look
+        if (_st.subtreeDepth(current) > _side.depth) { current->nextLevel.clear(); }
+        _st.genToDepth(_side.depth);
+        return;
+    }
+    
+    _st.genForSeconds(_seconds);
+}
+
+static void playGame(const std::string &_fen, const SelfPlayOptions &_options, GameRecord &_record)
+{
+    double cpuStart = threadCpuSeconds();
+    
+    StateTree st;
+    st.loadFEN(_fen);
+    st.setNodeBudget(_options.nodeLimit);
+    _record.startFEN = _fen;
+    TimeControl whiteClock = _options.white.clock;
+    TimeControl blackClock = _options.black.clock;
+    
+    while (true)
+    {
+        GameState* current = st.pastStates.back().get();
+        
+        if (!hasKing(current, PieceType::W_KING)) { _record.result = "0-1"; _record.termination = "king captured"; break; }
+        if (!hasKing(current, PieceType::B_KING)) { _record.result = "1-0"; _record.termination = "king captured"; break; }
+        if (current->halfmoveClock >= 100) { _record.result = "1/2-1/2"; _record.termination = "fifty-move rule"; break; }
+        if (repetitions(current) >= 2) { _record.result = "1/2-1/2"; _record.termination = "threefold repetition"; break; }
+        if (insufficientMaterial(current)) { _record.result = "1/2-1/2"; _record.termination = "insufficient material"; break; }
+        if ((int)_record.moves.size() >= _options.maxPlies) { _record.result = "1/2-1/2"; _record.termination = "adjudicated after " + std::to_string(_options.maxPlies) + " plies"; break; }
+        
+        const SelfPlaySide &side = (current->whiteTurn ? _options.white : _options.black);
+        TimeControl &clock = (current->whiteTurn ? whiteClock : blackClock);
+        if (st.nnue != side.nnue)
+        {
+            st.nnue = side.nnue;
+            st.evalCache.clear(); // NOTE holds the other side's evaluations
+        }
+        auto moveStart = std::chrono::steady_clock::now();
+        TimeManager manager;
+        double seconds = side.seconds;
+        if (clock.running())
+        {
+            st.genToDepth(1);
+            manager.start(clock, st.legalMoveCount(current));
+            seconds = std::max(manager.softLimit, 0.001);
+        }
+        think(st, side, seconds);
+        if (current->nextLevel.empty()) { _record.result = "1/2-1/2"; _record.termination = "no moves"; break; }
+        
+        int bestMoveIndex;
+        if (side.search.mcts)
+        {
+            st.searchOptions = side.search;
+            bestMoveIndex = st.searchMcts(side.search.mctsPlayouts, seconds);
+        }
+        else if (side.search.depthFirst)
+        {
+            st.searchOptions = side.search;
+            st.timeManager = (clock.running() ? &manager : nullptr);
+            bestMoveIndex = st.searchDepthFirst(clock.running() ? TIME_MAX_DEPTH : side.depth);
+            st.timeManager = nullptr;
+        }
+        else
+        {
+            st.minimaxEval(current);
+            bestMoveIndex = st.bestChildIndex(current);
+        }
+        int x1, y1, x2, y2;
+        st.childMove(current, current->nextLevel[bestMoveIndex].get(), x1, y1, x2, y2);
+        
+        // NOTE the engine mates by capturing the king, stop before that move so the PGN stays readable by other programs
+        if (current->board[x2][y2] == PieceType::W_KING || current->board[x2][y2] == PieceType::B_KING)
+        {
+            _record.result = (current->whiteTurn ? "1-0" : "0-1");
+            _record.termination = "king can be captured";
+            break;
+        }
+        
+        double moveSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - moveStart).count();
+        if (clock.running())
+        {
+            clock.moveMade(moveSeconds);
+            if (clock.remaining < 0)
+            {
+                _record.result = (current->whiteTurn ? "0-1" : "1-0");
+                _record.termination = "time forfeit";
+                break;
+            }
+        }
+        _record.moveSeconds.push_back(moveSeconds);
+        _record.moves.push_back(sanMove(st, current, bestMoveIndex));
+        st.pushMove(x1, y1, x2, y2);
+        st.pushState(bestMoveIndex);
+    }
+    
+    _record.cpuSeconds = threadCpuSeconds() - cpuStart;
+}
+
+// per side total and longest move time, e.g. "white 12.5 s (0.42 avg, 1.3 max), black ..."
+static std::string timeUsage(const GameRecord &_record)
+{
+    GameState start(nullptr);
+    parseFEN(_record.startFEN, &start);
+    double total[2] = {0, 0};
+    double longest[2] = {0, 0};
+    int moves[2] = {0, 0};
+    for (int i = 0; i < (int)_record.moveSeconds.size(); i++)
+    {
+        int side = ((i % 2 == 0) == start.whiteTurn ? 0 : 1);
+        total[side] += _record.moveSeconds[i];
+        longest[side] = std::max(longest[side], _record.moveSeconds[i]);
+        moves[side]++;
+    }
+    
+    std::ostringstream usage;
+    for (int side = 0; side < 2; side++)
+    {
+        usage << (side == 0 ? "white " : ", black ") << total[side] << " s (" << (moves[side] > 0 ? total[side]/moves[side] : 0) << " avg, " << longest[side] << " max)";
+    }
+    return usage.str();
+}
+
+static std::string toPGN(const GameRecord &_record, int _round, const SelfPlayOptions &_options)
+{
+    auto describe = [](const SelfPlaySide &_side)
+    {
+        std::string evaluator = (_side.nnue != nullptr ? " nnue" : "");
+        if (_side.clock.running())
+        {
+            std::ostringstream clock;
+            clock << "chengine " << _side.clock.base << "+" << _side.clock.increment << "s" << (_side.clock.movesPerPeriod > 0 ? "/" + std::to_string(_side.clock.movesPerPeriod) : "");
+            return clock.str() + " " + describeSearch(_side.search) + evaluator;
+        }
+        if (_side.search.mcts) { return (_side.seconds > 0 ? "chengine " + std::to_string(_side.seconds) + "s" : "chengine " + std::to_string(_side.search.mctsPlayouts) + " playouts") + " " + describeSearch(_side.search) + evaluator; }
+        if (_side.search.depthFirst) { return "chengine depth " + std::to_string(_side.depth) + " " + describeSearch(_side.search) + evaluator; }
+        return (_side.seconds > 0 ? "chengine " + std::to_string(_side.seconds) + "s" : "chengine depth " + std::to_string(_side.depth)) + evaluator;
+    };
+    
+    std::time_t now = std::time(nullptr);
+    char date[16];
+    std::strftime(date, sizeof(date), "%Y.%m.%d", std::localtime(&now));
+    
+    std::ostringstream pgn;
+    pgn << "[Event \"chengine self-play\"]\n";
+    pgn << "[Site \"?\"]\n";
+    pgn << "[Date \"" << date << "\"]\n";
+    pgn << "[Round \"" << _round << "\"]\n";
+    pgn << "[White \"" << describe(_options.white) << "\"]\n";
+    pgn << "[Black \"" << describe(_options.black) << "\"]\n";
+    pgn << "[Result \"" << _record.result << "\"]\n";
+    if (_record.startFEN != START_FEN)
+    {
+        pgn << "[SetUp \"1\"]\n";
+        pgn << "[FEN \"" << _record.startFEN << "\"]\n";
+    }
+    pgn << "[Termination \"" << _record.termination << "\"]\n\n";
+    
+    // movetext, wrapped before 80 columns
+    GameState start(nullptr);
+    parseFEN(_record.startFEN, &start);
+    bool whiteTurn = start.whiteTurn;
+    int moveNumber = start.fullmoveNumber;
+    std::string line;
+    auto append = [&](const std::string &_token)
+    {
+        if (!line.empty() && line.size() + 1 + _token.size() > 79) { pgn << line << '\n'; line.clear(); }
+        line += (line.empty() ? "" : " ") + _token;
+    };
+    for (int i = 0; i < (int)_record.moves.size(); i++)
+    {
+        if (whiteTurn) { append(std::to_string(moveNumber) + "."); }
+        else if (i == 0) { append(std::to_string(moveNumber) + "..."); }
+        append(_record.moves[i]);
+        if (_options.white.clock.running() || _options.black.clock.running())
+        {
+            std::ostringstream emt;
+            emt << "{[%emt " << std::fixed << std::setprecision(2) << _record.moveSeconds[i] << "]}";
+            append(emt.str());
+        }
+        if (!whiteTurn) { moveNumber++; }
+        whiteTurn = !whiteTurn;
+    }
+    append(_record.result);
+    pgn << line << "\n\n";
+    return pgn.str();
+}
+
+long runSelfPlay(const SelfPlayOptions &_options)
+{
+    std::vector<std::string> openings;
+    if (!_options.openingsPath.empty())
+    {
+        std::ifstream input(_options.openingsPath);
+        if (!input)
+        {
+            std::cout << "Couldn't open " << _options.openingsPath << '\n';
+            return -1;
+        }
+        std::string line;
+        while (std::getline(input, line))
+        {
+            if (line.empty() || line[0] == '#') { continue; }
+            GameState position(nullptr);
+            std::string id;
+            if (parseFEN(line, &position) || parseEPD(line, &position, id)) { openings.push_back(toFEN(&position)); }
+        }
+    }
+    if (openings.empty()) { openings.push_back(START_FEN); }
+    
+    std::ofstream pgn;
+    if (!_options.pgnPath.empty())
+    {
+        pgn.open(_options.pgnPath, std::ios::app);
+        if (!pgn)
+        {
+            std::cout << "Couldn't open " << _options.pgnPath << '\n';
+            return -1;
+        }
+    }
+    
+    std::atomic<int> nextGame(0);
+    std::mutex resultsMutex;
+    int whiteWins = 0;
+    int blackWins = 0;
+    int draws = 0;
+    double totalCpu = 0;
+    
+    auto start = std::chrono::steady_clock::now();
+    
+    // each worker keeps taking the next unplayed game until there are none left
+    auto worker = [&]()
+    {
+        int game;
+        while ((game = nextGame++) < _options.games)
+        {
+            GameRecord record;
+            playGame(openings[game % openings.size()], _options, record);
+            
+            std::lock_guard<std::mutex> lock(resultsMutex);
+            if (record.result == "1-0") { whiteWins++; }
+            else if (record.result == "0-1") { blackWins++; }
+            else { draws++; }
+            totalCpu += record.cpuSeconds;
+            if (pgn.is_open()) { pgn << toPGN(record, game+1, _options) << std::flush; }
+            std::cout << "Game " << game+1 << ": " << record.result << " (" << record.termination << ", " << record.moves.size() << " plies, " << record.cpuSeconds << " s CPU)\n";
+            if (_options.white.clock.running() || _options.black.clock.running()) { std::cout << "  " << timeUsage(record) << '\n'; }
+        }
+    };
+    
+    int threads = (_options.threads > 0 ? _options.threads : 1);
+    std::vector<std::thread> pool;
+    for (int i = 0; i < threads; i++) { pool.emplace_back(worker); }
+    for (std::thread &thread : pool) { thread.join(); }
+    
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    int played = whiteWins + blackWins + draws;
+    std::cout << played << " games on " << threads << " threads in " << seconds << " s: +" << whiteWins << " =" << draws << " -" << blackWins << " (white's view)\n";
+    if (played > 0)
+    {
+        std::cout << played*3600.0/seconds << " games/hour, " << totalCpu/played << " s CPU per game, CPU/wall " << totalCpu/seconds << '\n';
+    }
+    return played;
+}
@@ -0,0 +1,38 @@
+#ifndef SELFPLAY_HPP
+#define SELFPLAY_HPP
+
+#include <string>
+
+#include "Search.hpp"
+#include "TimeManager.hpp"
+
+class NnueNetwork;
+
+struct SelfPlaySide
+{
+    int depth; // levels searched per move, used when seconds is 0
+    double seconds; // thinking time per move, levels are added while the next one is expected to fit (tree search) or playouts until it's up (Monte Carlo search, instead of search.mctsPlayouts), NOTE not for the depth-first search
+    SearchOptions search; // search.depth is ignored in favour of depth
+    const NnueNetwork* nnue; // nullptr evaluates with StateTree::evaluate()
+    TimeControl clock; // when running() the side plays on this clock (fresh for each game) instead of depth or seconds, see TimeManager.hpp
+};
+
+struct SelfPlayOptions
+{
+    int games;
+    int threads; // games played at the same time, each with its own StateTree
+    SelfPlaySide white;
+    SelfPlaySide black;
+    long nodeLimit; // node budget per tree, 0 means unlimited
+    int maxPlies; // games still going after this many plies are adjudicated as draws
+    std::string openingsPath; // FEN/EPD file, game i starts from opening i modulo the number of openings, empty means the initial position
+    std::string pgnPath; // games are appended here as they finish, empty means no PGN
+};
+
+/* Plays engine-vs-engine games on a pool of worker threads
+ * 
+ * Prints results and a summary (games per hour, CPU time per game, time used per move by sides on a clock) to std::cout. Returns the number of games played, -1 if a file couldn't be opened
+*/
+long runSelfPlay(const SelfPlayOptions &_options);
+
+#endif
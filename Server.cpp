@@ -0,0 +1,344 @@
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+
+#include "Server.hpp"
+#include "StateTree.hpp"
+#include "Notation.hpp"
+#include "TranspositionTable.hpp"
+
+struct ServerSession
+{
+    int id; // also its tag in the transposition table
+    StateTree st;
+    
+    // the search in progress
+    bool searching;
+    bool started; // startDepthFirst() has run
+    bool closing; // close came in while searching
+    int depth;
+    long slice; // nodes of its next turn
+    std::chrono::steady_clock::time_point requested; // when go came in
+    double workedMs; // time workers spent on it
+    
+    // metrics over every finished search
+    std::vector<double> latencies; // ms from go to bestmove
+    double waitedMs; // total of latency not spent searching
+    long nodes;
+    double searchedMs;
+    long ttProbes;
+    long ttHits;
+};
+
+struct Server
+{
+    std::ostream &out;
+    TranspositionTable tt;
+    std::map<int, std::unique_ptr<ServerSession>> sessions;
+    std::deque<ServerSession*> queue; // searches with depths left, taken from the front
+    bool stopping;
+    long sliceNodes; // ServerOptions::sliceNodes
+    
+    std::mutex mutex; // everything above and out
+    std::condition_variable ready; // the queue has something or stopping is set
+    std::condition_variable idle; // a search finished
+    
+    Server(const ServerOptions &_options, std::ostream &_out) : out(_out), tt(_options.ttMegabytes), stopping(false), sliceNodes(std::max(_options.sliceNodes, 1L)) {}
+};
+
+static void reply(Server &_server, const std::string &_line)
+{
+    _server.out << _line << std::endl;
+}
+
+// percentile of sorted values, nearest rank
+static double percentile(const std::vector<double> &_sorted, double _share)
+{
+    if (_sorted.empty()) { return 0; }
+    int rank = (int)(_share*_sorted.size() + 0.5);
+    return _sorted[std::min(std::max(rank-1, 0), (int)_sorted.size()-1)];
+}
+
+static std::string sessionStats(const ServerSession &_session)
+{
+    std::vector<double> sorted = _session.latencies;
+    std::sort(sorted.begin(), sorted.end());
+    double total = 0;
+    for (double ms : sorted) { total += ms; }
+    int searches = (int)sorted.size();
+    
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(1);
+    line << "stats " << _session.id << " searches " << searches;
+    line << " latency avg " << (searches > 0 ? total/searches : 0) << " p50 " << percentile(sorted, 0.5) << " p95 " << percentile(sorted, 0.95)
+         << " max " << (searches > 0 ? sorted.back() : 0) << " ms";
+    line << " wait avg " << (searches > 0 ? _session.waitedMs/searches : 0) << " ms";
+    line << " nodes/s " << (long)(_session.searchedMs > 0 ? _session.nodes*1000.0/_session.searchedMs : 0);
+    line << " tt hits " << (_session.ttProbes > 0 ? 100.0*_session.ttHits/_session.ttProbes : 0) << "%";
+    line << (_session.searching ? " searching" : "");
+    return line.str();
+}
+
+// called with the mutex held once the session's search has no depths left
+static void finishSearch(Server &_server, ServerSession &_session)
+{
+    StateTree &st = _session.st;
+    double latency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _session.requested).count();
+    _session.latencies.push_back(latency);
+    _session.waitedMs += std::max(latency - _session.workedMs, 0.0);
+    _session.nodes += st.searchNodes;
+    _session.searchedMs += _session.workedMs;
+    _session.ttProbes += st.ttProbes;
+    _session.ttHits += st.ttHits;
+    
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(2);
+    GameState* root = st.pastStates.back().get();
+    if (st.iterations.empty()) { line << "bestmove " << _session.id << " none"; }
+    else
+    {
+        const SearchIteration &last = st.iterations.back();
+        line << "bestmove " << _session.id << ' ' << last.bestMove << " eval " << root->evaluation << " depth " << last.depth << " nodes " << st.searchNodes;
+    }
+    line << " ms " << latency << " wait " << std::max(latency - _session.workedMs, 0.0);
+    reply(_server, line.str());
+    
+    _session.searching = false;
+    if (_session.closing)
+    {
+        _server.tt.closeSession(_session.id);
+        _server.sessions.erase(_session.id);
+    }
+    _server.idle.notify_all();
+}
+
+static void worker(Server &_server)
+{
+    while (true)
+    {
+        ServerSession* session;
+        {
+            std::unique_lock<std::mutex> lock(_server.mutex);
+            _server.ready.wait(lock, [&]() { return _server.stopping || !_server.queue.empty(); });
+            if (_server.queue.empty()) { return; }
+            session = _server.queue.front();
+            _server.queue.pop_front();
+        }
+        
+        // one slice, as many depths as fit in it, NOTE nothing else touches a session's StateTree while it's searching
+        StateTree &st = session->st;
+        auto start = std::chrono::steady_clock::now();
+        bool more = false;
+        if (!session->started)
+        {
+            session->started = true;
+            more = st.startDepthFirst();
+        }
+        else { more = true; }
+        long end = st.searchNodes + session->slice;
+        while (more && st.searchNodes < end)
+        {
+            st.sliceNodes = end - st.searchNodes;
+            more = st.deepenDepthFirst(session->depth);
+            if (st.sliceExpired)
+            {
+                more = true;
+                break;
+            }
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        
+        std::lock_guard<std::mutex> lock(_server.mutex);
+        session->workedMs += ms;
+        session->slice = (st.sliceExpired ? 2*session->slice : _server.sliceNodes); // NOTE the abandoned depth starts over, give it the time to get further
+        if (more) { _server.queue.push_back(session); } // NOTE behind everything that queued up in the meantime
+        else { finishSearch(_server, *session); }
+    }
+}
+
+// the session named by the next word of _in, replies and returns nullptr if there is none or it's busy
+static ServerSession* findSession(Server &_server, std::istringstream &_in, bool _idleOnly)
+{
+    int id = 0;
+    if (!(_in >> id))
+    {
+        reply(_server, "error missing session");
+        return nullptr;
+    }
+    auto found = _server.sessions.find(id);
+    if (found == _server.sessions.end() || found->second->closing)
+    {
+        reply(_server, "error " + std::to_string(id) + " no such session");
+        return nullptr;
+    }
+    if (_idleOnly && found->second->searching)
+    {
+        reply(_server, "error " + std::to_string(id) + " searching");
+        return nullptr;
+    }
+    return found->second.get();
+}
+
+static std::string restOf(std::istringstream &_in)
+{
+    std::string rest;
+    std::getline(_in, rest);
+    size_t first = rest.find_first_not_of(" \t");
+    return (first == std::string::npos ? "" : rest.substr(first));
+}
+
+// plays _text in _st, the way pushPlayerState() does without its messages
+static bool playMove(StateTree &_st, const std::string &_text)
+{
+    GameState* current = _st.pastStates.back().get();
+    Move move;
+    if (!parseMove(current, _text, move)) { return false; }
+    if (current->nextLevel.empty()) { _st.genToDepth(1); }
+    int index = _st.findChild(current, move.x1, move.y1, move.x2, move.y2);
+    if (index == -1) { return false; }
+    _st.pushState(index);
+    return true;
+}
+
+int runServer(const ServerOptions &_options, std::istream &_in, std::ostream &_out)
+{
+    Server server(_options, _out);
+    int threads = std::max(_options.threads, 1);
+    std::vector<std::thread> pool;
+    for (int i = 0; i < threads; i++) { pool.emplace_back(worker, std::ref(server)); }
+    
+    std::string line;
+    while (std::getline(_in, line))
+    {
+        std::istringstream in(line);
+        std::string command;
+        if (!(in >> command)) { continue; }
+        if (command == "quit") { break; }
+        
+        std::lock_guard<std::mutex> lock(server.mutex);
+        if (command == "new")
+        {
+            std::string fen = restOf(in);
+            int id = server.tt.openSession();
+            if (id == -1)
+            {
+                reply(server, "error too many sessions");
+                continue;
+            }
+            std::unique_ptr<ServerSession> session(new ServerSession());
+            if (!fen.empty() && !session->st.loadFEN(fen))
+            {
+                server.tt.closeSession(id);
+                reply(server, "error bad FEN");
+                continue;
+            }
+            session->id = id;
+            session->st.searchOptions = _options.search;
+            session->st.searchOptions.depthFirst = true;
+            session->st.searchOptions.mcts = false;
+            session->st.nnue = _options.nnue;
+            session->st.analysisCache = _options.analysisCache;
+            session->st.setNodeBudget(_options.nodeLimit);
+            session->st.tt = &server.tt;
+            session->st.ttSession = id;
+            session->searching = false;
+            session->started = false;
+            session->closing = false;
+            session->depth = 0;
+            session->slice = server.sliceNodes;
+            session->workedMs = 0;
+            session->waitedMs = 0;
+            session->nodes = 0;
+            session->searchedMs = 0;
+            session->ttProbes = 0;
+            session->ttHits = 0;
+            server.sessions[id] = std::move(session);
+            reply(server, "ok " + std::to_string(id));
+        }
+        else if (command == "position")
+        {
+            ServerSession* session = findSession(server, in, true);
+            if (session == nullptr) { continue; }
+            std::string fen = restOf(in);
+            if (fen == "startpos") { fen = START_FEN; }
+            if (!session->st.loadFEN(fen)) { reply(server, "error " + std::to_string(session->id) + " bad FEN"); }
+            else { reply(server, "ok " + std::to_string(session->id)); }
+        }
+        else if (command == "move")
+        {
+            ServerSession* session = findSession(server, in, true);
+            if (session == nullptr) { continue; }
+            std::string text;
+            bool played = true;
+            while (played && in >> text) { played = playMove(session->st, text); }
+            if (!played) { reply(server, "error " + std::to_string(session->id) + " illegal move " + text); }
+            else { reply(server, "ok " + std::to_string(session->id)); }
+        }
+        else if (command == "go")
+        {
+            ServerSession* session = findSession(server, in, true);
+            if (session == nullptr) { continue; }
+            int depth = SERVER_DEFAULT_DEPTH;
+            if (in >> depth && depth < 1) { depth = 1; }
+            session->searching = true;
+            session->started = false;
+            session->depth = std::min(depth, MAX_SEARCH_PLY-1);
+            session->slice = server.sliceNodes;
+            session->requested = std::chrono::steady_clock::now();
+            session->workedMs = 0;
+            server.queue.push_back(session);
+            server.ready.notify_one();
+        }
+        else if (command == "stats")
+        {
+            int id;
+            if (in >> id)
+            {
+                auto found = server.sessions.find(id);
+                if (found == server.sessions.end()) { reply(server, "error " + std::to_string(id) + " no such session"); }
+                else { reply(server, sessionStats(*found->second)); }
+                continue;
+            }
+            for (const auto &session : server.sessions) { reply(server, sessionStats(*session.second)); }
+            reply(server, "stats end " + std::to_string(server.sessions.size()) + " sessions, " + std::to_string(server.queue.size()) + " queued, " + std::to_string(threads) + " threads");
+        }
+        else if (command == "close")
+        {
+            ServerSession* session = findSession(server, in, false);
+            if (session == nullptr) { continue; }
+            int id = session->id;
+            if (session->searching) { session->closing = true; } // NOTE finishSearch() closes it
+            else
+            {
+                server.tt.closeSession(id);
+                server.sessions.erase(id);
+            }
+            reply(server, "ok " + std::to_string(id));
+        }
+        else { reply(server, "error unknown command " + command); }
+    }
+    
+    // the searches already asked for still get their answers
+    {
+        std::unique_lock<std::mutex> lock(server.mutex);
+        server.idle.wait(lock, [&]()
+        {
+            for (const auto &session : server.sessions) { if (session.second->searching) { return false; } }
+            return true;
+        });
+        server.stopping = true;
+    }
+    server.ready.notify_all();
+    for (std::thread &thread : pool) { thread.join(); }
+    return 0;
+}
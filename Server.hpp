@@ -0,0 +1,50 @@
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+#include <iostream>
+
+#include "Search.hpp"
+
+class NnueNetwork;
+class AnalysisCache;
+
+/* Game server, any number of games (sessions) hosted by one process, driven by a line protocol
+ *
+ * Commands, one per line, replies are one line each and name the session:
+ *   new [FEN]                opens a session on FEN (default the initial position), "ok N"
+ *   position N FEN|startpos  sets session N up again, "ok N"
+ *   move N MOVE...           plays moves (SAN or UCI) in session N, "ok N"
+ *   go N [DEPTH]             queues a search of session N's current position, answered once it's done by
+ *                            "bestmove N MOVE eval E depth D nodes X ms T wait W" (MOVE "none" without legal moves, W the part of T spent queued)
+ *   stats [N]                latency metrics of session N or of every session, then "stats end"
+ *   close N                  ends session N once its search (if any) is done, "ok N"
+ *   quit                     (or the end of the input) waits for the searches in progress and exits
+ * Anything that can't be done is answered with "error [N] reason". A session that is searching only takes stats and close.
+ *
+ * Every search is the depth-first one. A fixed pool of worker threads takes searches from one queue a slice of nodes at a time (StateTree::sliceNodes)
+ * and puts them back at the end while they have depths left, so a deep search never holds a worker for more than one slice and a new request only waits
+ * behind one slice of each search ahead of it. A slice that runs out in the middle of a depth abandons it and the search's next turn starts that depth
+ * over, with most of what it already searched in the transposition table and a slice twice as long each time so even a depth bigger than the slice ends.
+ * The sessions share one TranspositionTable, each under its own session tag so a session's entries from its earlier searches and from closed sessions
+ * are the first to be replaced.
+ *
+ * NOTE each session has its own StateTree, evaluation cache and pawn hash included (about 1.3 MB once it has searched)
+*/
+
+const int SERVER_DEFAULT_DEPTH = 6;
+const long SERVER_DEFAULT_SLICE = 20000; // nodes, a few tens of milliseconds
+
+struct ServerOptions
+{
+    int threads; // workers shared by every session
+    long ttMegabytes; // the shared transposition table
+    SearchOptions search; // NOTE depthFirst is turned on, mcts off
+    const NnueNetwork* nnue; // nullptr evaluates with StateTree::evaluate()
+    AnalysisCache* analysisCache; // nullptr searches every position, see StateTree::analysisCache
+    long nodeLimit; // node budget per session, 0 means unlimited
+    long sliceNodes; // nodes a search runs for before it goes back in the queue
+};
+
+int runServer(const ServerOptions &_options, std::istream &_in, std::ostream &_out); // returns 0 once quit is read and the searches are done
+
+#endif
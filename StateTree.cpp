@@ -3,13 +3,49 @@
 #include <array>
 #include <vector>
 #include <memory>
+#include <new>
+#include <chrono>
+#include <algorithm>
 
 #include "StateTree.hpp"
+#include "Zobrist.hpp"
+#include "Tablebase.hpp"
+#include "Endgame.hpp"
+#include "Notation.hpp"
+#include "Nnue.hpp"
+#include "Mcts.hpp"
 
 // NOTE helper functions at bottom
 
-StateTree::StateTree()
+StateTree::StateTree() : evalCache(EVAL_CACHE_DEFAULT_KB), pawnHash(PAWN_HASH_DEFAULT_KB)
 {
+    liveNodes = 1;
+    nodeBudget = 0;
+    budgetReached = false;
+    tbHits = 0;
+    endgameHits = 0;
+    endgamePly = 0;
+    trace = nullptr;
+    searchNodes = 0;
+    mctsPlayouts = 0;
+    timeManager = nullptr;
+    searchAborted = false;
+    sliceNodes = 0;
+    sliceExpired = false;
+    sliceEnd = 0;
+    tt = nullptr;
+    analysisCache = nullptr;
+    ttSession = 0;
+    ttProbes = 0;
+    ttHits = 0;
+    mctsMs = 0;
+    pawnStructure = true;
+    nnue = nullptr;
+    genStage = GenStage::ALL;
+    followPV = false;
+    pvLength.fill(0);
+    for (auto &killer : killers) { killer.fill(Move{-1, -1, -1, -1}); }
+    
     std::unique_ptr<GameState> initial = std::make_unique<GameState>(nullptr);
     deepestLevel.push_back(initial.get()); // NOTE This comes first since after std::move(p), p in this scope is empty!
     pastStates.push_back(std::move(initial)); // Create starting board
@@ -51,6 +87,164 @@ StateTree::StateTree()
     pastStates[0]->board[5][7] = PieceType::B_BISHOP;
     pastStates[0]->board[6][7] = PieceType::B_KNIGHT;
     pastStates[0]->board[7][7] = PieceType::B_ROOK;
+    pastStates[0]->boardKey = zobristBoardKey(pastStates[0].get());
+    pastStates[0]->positionKey = zobristKey(pastStates[0].get());
+}
+
+void NnueAccumulatorDeleter::operator()(NnueAccumulator* _acc) const
+{
+    delete _acc;
+}
+
+void MctsNodeDeleter::operator()(MctsNode* _node) const
+{
+    delete _node;
+}
+
+bool squareAttacked(const std::array<std::array<PieceType,8>,8> &_board, int _x, int _y, bool _byWhite)
+{
+    PieceType pawn = (_byWhite ? PieceType::W_PAWN : PieceType::B_PAWN);
+    PieceType knight = (_byWhite ? PieceType::W_KNIGHT : PieceType::B_KNIGHT);
+    PieceType bishop = (_byWhite ? PieceType::W_BISHOP : PieceType::B_BISHOP);
+    PieceType rook = (_byWhite ? PieceType::W_ROOK : PieceType::B_ROOK);
+    PieceType queen = (_byWhite ? PieceType::W_QUEEN : PieceType::B_QUEEN);
+    PieceType king = (_byWhite ? PieceType::W_KING : PieceType::B_KING);
+    
+    // pawns attack diagonally forward, so look one rank behind the square from the attacker's point of view
+    int pawnY = _y + (_byWhite ? -1:1);
+    if (pawnY >= 0 && pawnY <= 7)
+    {
+        if (_x > 0 && _board[_x-1][pawnY] == pawn) { return true; }
+        if (_x < 7 && _board[_x+1][pawnY] == pawn) { return true; }
+    }
+    
+    const int knightJumps[8][2] = {{1,2},{2,1},{2,-1},{1,-2},{-1,-2},{-2,-1},{-2,1},{-1,2}};
+    for (const auto &jump : knightJumps)
+    {
+        int x = _x+jump[0];
+        int y = _y+jump[1];
+        if (x >= 0 && x <= 7 && y >= 0 && y <= 7 && _board[x][y] == knight) { return true; }
+    }
+    
+    for (int dx = -1; dx <= 1; dx++)
+    {
+        for (int dy = -1; dy <= 1; dy++)
+        {
+            if (dx == 0 && dy == 0) { continue; }
+            
+            // king next to the square
+            int x = _x+dx;
+            int y = _y+dy;
+            if (x >= 0 && x <= 7 && y >= 0 && y <= 7 && _board[x][y] == king) { return true; }
+            
+            // slide until the first piece
+            bool diagonal = (dx != 0 && dy != 0);
+            while (x >= 0 && x <= 7 && y >= 0 && y <= 7)
+            {
+                PieceType piece = _board[x][y];
+                if (piece != PieceType::EMPTY)
+                {
+                    if (piece == queen || (diagonal && piece == bishop) || (!diagonal && piece == rook)) { return true; }
+                    break;
+                }
+                x += dx;
+                y += dy;
+            }
+        }
+    }
+    return false;
+}
+
+bool squareAttacked(const GameState* _gs, int _x, int _y, bool _byWhite)
+{
+    return squareAttacked(_gs->board, _x, _y, _byWhite);
+}
+
+bool kingAttacked(const GameState* _gs, bool _white)
+{
+    PieceType king = (_white ? PieceType::W_KING : PieceType::B_KING);
+    for (int y = 0; y < 8; y++)
+    {
+        for (int x = 0; x < 8; x++)
+        {
+            if (_gs->board[x][y] == king) { return squareAttacked(_gs, x, y, !_white); }
+        }
+    }
+    return false;
+}
+
+int enPassantFile(const GameState* _gs)
+{
+    if (_gs->doubleMoveFile == -1) { return -1; }
+    
+    int x = _gs->doubleMoveFile;
+    int rank = (_gs->whiteTurn ? 4:3); // rank the enemy pawn lands on after a double move
+    PieceType ownPawn = (_gs->whiteTurn ? PieceType::W_PAWN : PieceType::B_PAWN);
+    if ((x > 0 && _gs->board[x-1][rank] == ownPawn) || (x < 7 && _gs->board[x+1][rank] == ownPawn)) { return x; }
+    return -1;
+}
+
+bool insufficientMaterial(const GameState* _gs)
+{
+    int minors = 0;
+    int bishopColors[2] = {0, 0}; // bishops of either side on dark and light squares
+    for (int y = 0; y < 8; y++)
+    {
+        for (int x = 0; x < 8; x++)
+        {
+            switch(_gs->board[x][y])
+            {
+                case (PieceType::EMPTY): case (PieceType::W_KING): case (PieceType::B_KING):
+                    break;
+                case (PieceType::W_KNIGHT): case (PieceType::B_KNIGHT):
+                    minors++;
+                    break;
+                case (PieceType::W_BISHOP): case (PieceType::B_BISHOP):
+                    minors++;
+                    bishopColors[(x+y) % 2]++;
+                    break;
+                default:
+                    return false; // pawns, rooks and queens can always mate
+            }
+        }
+    }
+    return (minors <= 1 || bishopColors[0] == minors || bishopColors[1] == minors);
+}
+
+int repetitions(const GameState* _gs)
+{
+    int count = 0;
+    int plies = 1;
+    for (const GameState* gs = _gs->parent; gs != nullptr && plies <= _gs->halfmoveClock; gs = gs->parent, plies++)
+    {
+        if (plies % 2 == 0 && gs->positionKey == _gs->positionKey) { count++; }
+        if (gs->fromX == -1) { break; } // a null move, or where the game was set up
+    }
+    return count;
+}
+
+bool drawn(const GameState* _gs, bool _parentInsufficient)
+{
+    if (_gs->halfmoveClock >= 100) { return true; }
+    if (_gs->halfmoveClock >= 4 && repetitions(_gs) > 0) { return true; }
+    return (_gs->captured != PieceType::EMPTY ? insufficientMaterial(_gs) : _parentInsufficient);
+}
+
+bool StateTree::loadFEN(const std::string &_fen)
+{
+    std::unique_ptr<GameState> initial = std::make_unique<GameState>(nullptr);
+    if (!parseFEN(_fen, initial.get())) { return false; }
+    initial->boardKey = zobristBoardKey(initial.get());
+    initial->positionKey = zobristKey(initial.get());
+    
+    pastStates.clear();
+    deepestLevel.clear();
+    moveList.clear();
+    deepestLevel.push_back(initial.get());
+    pastStates.push_back(std::move(initial));
+    liveNodes = 1;
+    budgetReached = false;
+    return true;
 }
 
 void StateTree::printCurrent()
@@ -81,8 +275,30 @@ void StateTree::printBoard(GameState* _gs)
     }
 }
 
+void StateTree::setNodeBudget(long _nodes)
+{
+    nodeBudget = (_nodes > 0 ? _nodes : 0);
+}
+
+void StateTree::setMemoryBudgetMB(long _megabytes)
+{
+    setNodeBudget(_megabytes * 1024 * 1024 / bytesPerNode());
+}
+
+long StateTree::bytesPerNode()
+{
+    // the node itself, the unique_ptr in its parent's nextLevel, its slot in deepestLevel and roughly two words of malloc bookkeeping
+    long node = (long)(sizeof(GameState) + sizeof(std::unique_ptr<GameState>) + sizeof(GameState*) + 2*sizeof(void*));
+    
+    // and the board with its own bookkeeping, which only the checkpoints keep in the materialized tree, NOTE an overestimate since those never are leaves
+    long board = (long)(sizeof(BoardArray) + 2*sizeof(void*));
+    int interval = (searchOptions.depthFirst || searchOptions.mcts ? 1 : std::max(searchOptions.checkpointInterval, 1));
+    return node + board/interval;
+}
+
 void StateTree::regenDeepestLevel(GameState* _gs)
 {
+    liveNodes++;
     if ((int)_gs->nextLevel.size() != 0)
     {
         for (int i = 0; i < (int)_gs->nextLevel.size(); i++)
@@ -97,85 +313,127 @@ void StateTree::regenDeepestLevel(GameState* _gs)
     }
 }
 
+bool StateTree::checkpoint(const GameState* _gs)
+{
+    int gamePly = 2*(_gs->fullmoveNumber-1) + (_gs->whiteTurn ? 0:1); // NOTE counted from the game's start so a GameState stays a checkpoint when the current state moves on
+    return gamePly % std::max(searchOptions.checkpointInterval, 1) == 0;
+}
+
+// plays the moves from _from (exclusive) down to _gs (inclusive) on _board, the way addChild(), pawnMove() and evalCastleAbility() made them
+static void replayMoves(const GameState* _from, const GameState* _gs, BoardArray &_board)
+{
+    if (_gs == _from) { return; }
+    replayMoves(_from, _gs->parent, _board);
+    if (_gs->fromX == -1) { return; } // null move
+    
+    PieceType piece = _board[_gs->fromX][_gs->fromY];
+    bool pawn = (piece == PieceType::W_PAWN || piece == PieceType::B_PAWN);
+    bool king = (piece == PieceType::W_KING || piece == PieceType::B_KING);
+    
+    // en passant is the only diagonal pawn move onto an empty square, the pawn it takes is beside the one moving
+    if (pawn && _gs->fromX != _gs->toX && _board[_gs->toX][_gs->toY] == PieceType::EMPTY) { _board[_gs->toX][_gs->fromY] = PieceType::EMPTY; }
+    
+    // castling is the king's move, the rook lands on the square the king passes
+    if (king && (_gs->toX - _gs->fromX == 2 || _gs->fromX - _gs->toX == 2))
+    {
+        int rookX = (_gs->toX == 6 ? 7:0);
+        int passX = (_gs->toX == 6 ? 5:3);
+        _board[passX][_gs->fromY] = _board[rookX][_gs->fromY];
+        _board[rookX][_gs->fromY] = PieceType::EMPTY;
+    }
+    
+    _board[_gs->toX][_gs->toY] = piece;
+    _board[_gs->fromX][_gs->fromY] = PieceType::EMPTY;
+    // WARNING ONLY QUEEN PROMOTION RIGHT NOW
+    if (piece == PieceType::W_PAWN && _gs->toY == 7) { _board[_gs->toX][_gs->toY] = PieceType::W_QUEEN; }
+    if (piece == PieceType::B_PAWN && _gs->toY == 0) { _board[_gs->toX][_gs->toY] = PieceType::B_QUEEN; }
+}
+
+bool StateTree::materialize(GameState* _gs)
+{
+    if (_gs->board.present()) { return false; }
+    
+    // NOTE pastStates never drop their boards so there always is one above
+    const GameState* from = _gs->parent;
+    while (!from->board.present()) { from = from->parent; }
+    _gs->board = from->board;
+    replayMoves(from, _gs, _gs->board);
+    return true;
+}
+
 void StateTree::genLevel()
 {
+    STATS_TIME(stats.genTicks);
+    std::chrono::steady_clock::time_point traceStart;
+    long traceNewNodes = 0;
+    if (trace != nullptr) { traceStart = std::chrono::steady_clock::now(); }
+    
     deepestLevel.clear();
+    liveNodes = (long)pastStates.size()-1; // NOTE regenDeepestLevel() counts pastStates.back() and everything under it
+    budgetReached = false;
     regenDeepestLevel(pastStates.back().get());
     // iterate through each boardsquare and generate potential next GameStates
     std::vector<GameState*> deepestLevelTemp = deepestLevel; // ATTENTION Make sure that this is copying over and not just pointing to the same object
     deepestLevel.clear(); // the so that deepestLevel can be populated by deeper GameStates
     
+    int tbPieces = tbLargest();
+    int rootPieces = countPieces(pastStates.back().get()); // NOTE every ply takes at most one piece, so a GameState can't be a registered ending before rootPieces-ENDGAME_MAX_PIECES plies
+    
     // generate potential next GameStates that branch off of each state in deepestLevel
     for (GameState* parentState : deepestLevelTemp)
     {
-        for (int y = 0; y < 8; y++)
+        if (parentState->resolved && parentState != pastStates.back().get()) { continue; } // NOTE the current state may be a draw by repetition that the game carries on from
+        
+        // a GameState that only kept its move needs its board back while it's probed and expanded
+        bool replayed = materialize(parentState);
+        
+        // a tablebase hit replaces the whole subtree under this GameState, NOTE the current state is left to pushComputerState()'s root probe
+        if (tbPieces > 0 && parentState != pastStates.back().get() && countPieces(parentState) <= tbPieces && tbProbeWDL(parentState, parentState->evaluation))
         {
-            for (int x = 0; x < 8; x++)
-            {
-                // generate child GameStates
-                PieceType piece = parentState->board[x][y];
-                if (piece == PieceType::EMPTY) { /*Do nothing, empty square*/ } // move to next square when current is empty
-                else if (parentState->whiteTurn && (int)piece < COLOR_THRESHOLD) // NOTE white PieceTypes have values less than 90, black's are greater
-                {
-                    switch(piece)
-                    {
-                        case (PieceType::W_PAWN):
-                            pawnMove(parentState,x,y);
-                            break;
-                        case (PieceType::W_KNIGHT):
-                            knightMove(parentState,x,y);
-                            break;
-                        case (PieceType::W_BISHOP):
-                            bishopMove(parentState,x,y);
-                            break;
-                        case (PieceType::W_ROOK):
-                            rookMove(parentState,x,y);
-                            break;
-                        case (PieceType::W_QUEEN):
-                            queenMove(parentState,x,y);
-                            break;
-                        case (PieceType::W_KING):
-                            kingMove(parentState,x,y);
-                            break;
-                        default:
-                            std::cout << " ##### Error (1) in genLevel() ##### \n";
-                            break;
-                    }
-                }
-                else if (!parentState->whiteTurn && (int)piece > COLOR_THRESHOLD) // black moves
-                {
-                    switch(piece)
-                    {
-                        case (PieceType::B_PAWN):
-                            pawnMove(parentState,x,y);
-                            break;
-                        case (PieceType::B_KNIGHT):
-                            knightMove(parentState,x,y);
-                            break;
-                        case (PieceType::B_BISHOP):
-                            bishopMove(parentState,x,y);
-                            break;
-                        case (PieceType::B_ROOK):
-                            rookMove(parentState,x,y);
-                            break;
-                        case (PieceType::B_QUEEN):
-                            queenMove(parentState,x,y);
-                            break;
-                        case (PieceType::B_KING):
-                            kingMove(parentState,x,y);
-                            break;
-                        default:
-                            std::cout << " ##### Error (2) in genLevel() ##### \n";
-                            break;
-                    }
-                }
-                else { /*Do nothing, enemy piece is on the square*/ }
-            }
+            parentState->resolved = true;
+            tbHits++;
+            if (replayed) { parentState->board.drop(); }
+            continue;
+        }
+        
+        // so does an ending with a known result
+        if (parentState != pastStates.back().get() && rootPieces - plyOf(parentState) <= ENDGAME_MAX_PIECES && countPieces(parentState) <= ENDGAME_MAX_PIECES && endgameProbe(parentState, parentState->evaluation))
+        {
+            parentState->resolved = true;
+            endgameHits++;
+            if (replayed) { parentState->board.drop(); }
+            continue;
+        }
+        
+        // never refuse to expand the current state, otherwise there would be no move to make
+        if (nodeBudget > 0 && liveNodes + MAX_BRANCHING > nodeBudget && parentState != pastStates.back().get())
+        {
+            budgetReached = true;
+            if (replayed) { parentState->board.drop(); }
+            break;
+        }
+        
+        try
+        {
+            genChildren(parentState);
+        }
+        catch (const std::bad_alloc&)
+        {
+            // out of memory before the budget kicked in, drop this parent's partial children and search what is already there
+            parentState->nextLevel.clear();
+            parentState->nextLevel.shrink_to_fit();
+            budgetReached = true;
+            if (replayed) { parentState->board.drop(); }
+            break;
+        }
+        liveNodes += (long)parentState->nextLevel.size();
+        STATS_DO(stats.addExpansion(plyOf(parentState), (long)parentState->nextLevel.size()));
+        if (trace != nullptr)
+        {
+            trace->expansion((int)pastStates.size()-1 + plyOf(parentState), (long)parentState->nextLevel.size());
+            traceNewNodes += (long)parentState->nextLevel.size();
         }
         
-        // now that all possibilities are generated convert pawns
-        evalPawnPromotions(parentState);
-        evalCastleAbility(parentState);
         // WARNING ASSUMING THIS CONDITIONAL CHECKS IN-CHECK
         // make sure not first move
         if (parentState->parent != nullptr)
@@ -191,7 +449,18 @@ void StateTree::genLevel()
                 parentState->parent->inCheck_W = true;
             }
         }
+        
+        // below the current state's children a leaf only needs its board to be evaluated and a GameState with children only keeps it as a checkpoint,
+        // NOTE the current state's children keep theirs for legality and notation
+        if (searchOptions.checkpointInterval > 1 && parentState != pastStates.back().get())
+        {
+            for (auto &child : parentState->nextLevel) { child->board.drop(); }
+        }
+        if (replayed && !checkpoint(parentState)) { parentState->board.drop(); }
     }
+    
+    STATS_DO(if (liveNodes > stats.peakTreeSize) { stats.peakTreeSize = liveNodes; });
+    if (trace != nullptr) { trace->level(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - traceStart).count(), traceNewNodes, liveNodes, budgetReached); }
 }
 
 void StateTree::genLevels(int _levels)
@@ -199,7 +468,202 @@ void StateTree::genLevels(int _levels)
     for (int i = 0; i < _levels; i++) { genLevel(); }
 }
 
+void StateTree::genToDepth(int _levels)
+{
+    genLevels(_levels - subtreeDepth(pastStates.back().get()));
+}
+
+void StateTree::genForSeconds(double _seconds)
+{
+    auto start = std::chrono::steady_clock::now();
+    genToDepth(1);
+    double lastLevel = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double growth = 30; // typical branching factor until two levels have been timed
+    while (!budgetReached)
+    {
+        // stop if the next level isn't expected to finish in time
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (elapsed + lastLevel*growth > _seconds) { break; }
+        
+        auto levelStart = std::chrono::steady_clock::now();
+        genLevel();
+        double levelTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - levelStart).count();
+        if (lastLevel > 1e-4) { growth = levelTime / lastLevel; }
+        lastLevel = levelTime;
+    }
+}
+
+void StateTree::genChildren(GameState* _gs, GenStage _stage, uint64_t _skipSquares)
+{
+    int first = (int)_gs->nextLevel.size();
+    genStage = _stage;
+    for (int y = 0; y < 8; y++)
+    {
+        for (int x = 0; x < 8; x++)
+        {
+            if (!((_skipSquares >> (8*y + x)) & 1)) { genPieceChildren(_gs, x, y); }
+        }
+    }
+    if (_stage != GenStage::CAPTURES) { evalCastleAbility(_gs); }
+    genStage = GenStage::ALL;
+    finishChildren(_gs, first);
+}
+
+void StateTree::genPieceChildren(GameState* _gs, int _x, int _y)
+{
+    PieceType piece = _gs->board[_x][_y];
+    if (piece == PieceType::EMPTY) { /*Do nothing, empty square*/ } // move to next square when current is empty
+    else if (_gs->whiteTurn && (int)piece < COLOR_THRESHOLD) // NOTE white PieceTypes have values less than 90, black's are greater
+    {
+        switch(piece)
+        {
+            case (PieceType::W_PAWN):
+                pawnMove(_gs,_x,_y);
+                break;
+            case (PieceType::W_KNIGHT):
+                knightMove(_gs,_x,_y);
+                break;
+            case (PieceType::W_BISHOP):
+                bishopMove(_gs,_x,_y);
+                break;
+            case (PieceType::W_ROOK):
+                rookMove(_gs,_x,_y);
+                break;
+            case (PieceType::W_QUEEN):
+                queenMove(_gs,_x,_y);
+                break;
+            case (PieceType::W_KING):
+                kingMove(_gs,_x,_y);
+                break;
+            default:
+                std::cout << " ##### Error (1) in genPieceChildren() ##### \n";
+                break;
+        }
+    }
+    else if (!_gs->whiteTurn && (int)piece > COLOR_THRESHOLD) // black moves
+    {
+        switch(piece)
+        {
+            case (PieceType::B_PAWN):
+                pawnMove(_gs,_x,_y);
+                break;
+            case (PieceType::B_KNIGHT):
+                knightMove(_gs,_x,_y);
+                break;
+            case (PieceType::B_BISHOP):
+                bishopMove(_gs,_x,_y);
+                break;
+            case (PieceType::B_ROOK):
+                rookMove(_gs,_x,_y);
+                break;
+            case (PieceType::B_QUEEN):
+                queenMove(_gs,_x,_y);
+                break;
+            case (PieceType::B_KING):
+                kingMove(_gs,_x,_y);
+                break;
+            default:
+                std::cout << " ##### Error (2) in genPieceChildren() ##### \n";
+                break;
+        }
+    }
+    else { /*Do nothing, enemy piece is on the square*/ }
+}
+
+void StateTree::finishChildren(GameState* _gs, int _first)
+{
+    STATS_ADD(stats.nodesGenerated, (long)_gs->nextLevel.size() - _first);
+    
+    // the children are complete now, key them and score the drawn ones
+    bool insufficient = insufficientMaterial(_gs);
+    for (int i = _first; i < (int)_gs->nextLevel.size(); i++)
+    {
+        GameState* child = _gs->nextLevel[i].get();
+        child->positionKey = child->boardKey ^ zobristStateKey(child);
+        if (drawn(child, insufficient))
+        {
+            child->evaluation = 0;
+            child->resolved = true;
+        }
+    }
+}
+
+int StateTree::plyOf(GameState* _gs)
+{
+    int ply = 0;
+    for (GameState* gs = _gs; gs != pastStates.back().get() && gs->parent != nullptr; gs = gs->parent) { ply++; }
+    return ply;
+}
+
+long StateTree::subtreeSize(GameState* _gs)
+{
+    long size = 1;
+    for (int i = 0; i < (int)_gs->nextLevel.size(); i++) { size += subtreeSize(_gs->nextLevel[i].get()); }
+    return size;
+}
+
+void StateTree::traceSearch(GameState* _root, int _bestIndex)
+{
+    if (trace == nullptr) { return; }
+    
+    int x1, y1, x2, y2;
+    std::string bestMove = "none";
+    for (int i = 0; i < (int)_root->nextLevel.size(); i++)
+    {
+        GameState* child = _root->nextLevel[i].get();
+        std::string move = (childMove(_root, child, x1, y1, x2, y2) ? uciMove(x1, y1, x2, y2) : "none");
+        if (i == _bestIndex) { bestMove = move; }
+        trace->rootMove(move, subtreeSize(child), child->evaluation);
+    }
+    trace->finishSearch((int)pastStates.size()-1, toFEN(_root), bestMove, _root->evaluation, subtreeSize(_root), subtreeDepth(_root));
+}
+
+int StateTree::subtreeDepth(GameState* _gs)
+{
+    int depth = 0;
+    for (int i = 0; i < (int)_gs->nextLevel.size(); i++)
+    {
+        int childDepth = 1 + subtreeDepth(_gs->nextLevel[i].get());
+        if (childDepth > depth) { depth = childDepth; }
+    }
+    return depth;
+}
+
 void StateTree::minimaxEval(GameState* _gs)
+{
+    STATS_TIME(stats.minimaxTicks);
+    minimaxBackup(_gs);
+    
+    // the PV is just the best children all the way down
+    principalVariation.clear();
+    GameState* gs = _gs;
+    for (int index = bestChildIndex(gs); index != -1; index = bestChildIndex(gs))
+    {
+        gs = gs->nextLevel[index].get();
+        principalVariation.push_back(Move{gs->fromX, gs->fromY, gs->toX, gs->toY});
+    }
+    
+    // every child's evaluation is exact, the best lines are the best children followed down the same way
+    multiPVLines.clear();
+    if (searchOptions.multiPV <= 1) { return; }
+    std::vector<GameState*> children;
+    for (int i = 0; i < (int)_gs->nextLevel.size(); i++) { children.push_back(_gs->nextLevel[i].get()); }
+    bool white = _gs->whiteTurn;
+    std::stable_sort(children.begin(), children.end(), [white](const GameState* _a, const GameState* _b) { return (white ? _a->evaluation > _b->evaluation : _a->evaluation < _b->evaluation); });
+    for (int i = 0; i < (int)children.size() && i < searchOptions.multiPV; i++)
+    {
+        SearchLine line{children[i]->evaluation, {}};
+        for (GameState* child = children[i]; child != nullptr; )
+        {
+            line.pv.push_back(Move{child->fromX, child->fromY, child->toX, child->toY});
+            int index = bestChildIndex(child);
+            child = (index == -1 ? nullptr : child->nextLevel[index].get());
+        }
+        multiPVLines.push_back(line);
+    }
+}
+
+void StateTree::minimaxBackup(GameState* _gs)
 {
     if ((int)_gs->nextLevel.size() != 0)
     {
@@ -207,7 +671,7 @@ void StateTree::minimaxEval(GameState* _gs)
         for (int i = 0; i < (int)_gs->nextLevel.size(); i++)
         {
             GameState* _childState = _gs->nextLevel[i].get();
-            minimaxEval(_childState);
+            minimaxBackup(_childState);
         }
         
         // Assign _gs a value based on it's children
@@ -231,7 +695,12 @@ void StateTree::minimaxEval(GameState* _gs)
     }
     else if ((int)_gs->nextLevel.size() == 0)
     {
-        evaluate(_gs);
+        if (!_gs->resolved)
+        {
+            STATS_TIME(stats.evalTicks);
+            STATS_ADD(stats.nodesEvaluated, 1);
+            cachedEvaluate(_gs);
+        }
     }
     else { std::cout << " ##### PHAT ERROR IN MINIMAX ##### \n"; }
 }
@@ -245,80 +714,131 @@ void StateTree::pushComputerState()
         return;
     }
     
-    minimaxEval(pastStates.back().get()); // pass current GameState
+    // the time spent on the move, book and tablebase moves included, goes on the clock
+    auto start = std::chrono::steady_clock::now();
+    auto chargeClock = [this, start]()
+    {
+        if (!clock.running()) { return; }
+        clock.moveMade(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        std::cout << "clock " << clock.remaining << " s" << (clock.remaining < 0 ? ", out of time!" : "") << '\n';
+    };
     
-    int bestMoveIndex = 0;
-    for (int i = 0; i < (int)pastStates.back()->nextLevel.size(); i++)
+    // answer from the opening book without searching, NOTE a book move that the move generator doesn't produce falls through to the search
+    BookMove bookMove;
+    if (probeBook(bookMove))
     {
-        GameState* _childState = pastStates.back()->nextLevel[i].get(); // now we have a pointer "_childState" to the GameState
-        
-        if (pastStates.back().get()->whiteTurn) // white's move
+        int bookIndex = findChild(pastStates.back().get(), bookMove.x1, bookMove.y1, bookMove.x2, bookMove.y2);
+        if (bookIndex != -1)
         {
-            if (_childState->evaluation > pastStates.back()->nextLevel[bestMoveIndex]->evaluation) // maximize
-            {
-                bestMoveIndex = i;
-            }
+            pushMove(bookMove.x1, bookMove.y1, bookMove.x2, bookMove.y2);
+            std::cout << "(book) " << moveList.back();
+            pushState(bookIndex);
+            chargeClock();
+            return;
         }
-        else if (!pastStates.back().get()->whiteTurn) // black's move
+    }
+    
+    // few enough pieces left to play straight from the tablebases
+    int tbX1, tbY1, tbX2, tbY2;
+    float tbEvaluation;
+    if (tbLargest() > 0 && tbProbeRoot(pastStates.back().get(), tbX1, tbY1, tbX2, tbY2, tbEvaluation))
+    {
+        int tbIndex = findChild(pastStates.back().get(), tbX1, tbY1, tbX2, tbY2);
+        if (tbIndex != -1)
         {
-            if (_childState->evaluation < pastStates.back()->nextLevel[bestMoveIndex]->evaluation) // minimize
-            {
-                bestMoveIndex = i;
-            }
+            pushMove(tbX1, tbY1, tbX2, tbY2);
+            std::cout << "(tablebase) " << moveList.back();
+            pushState(tbIndex);
+            pastStates.back()->evaluation = tbEvaluation;
+            chargeClock();
+            return;
         }
-        else { std::cout << "##### ERROR in pushComputerState() ##### \n"; }
     }
     
+    // on a clock the depth-first search deepens for as long as the time manager allows, the Monte Carlo search plays out for its soft limit and the tree search
+    // grows its tree for it, NOTE without a clock the tree search has already grown its tree
+    TimeManager manager;
+    if (clock.running()) { manager.start(clock, legalMoveCount(pastStates.back().get())); }
     
-    // PRINT MOVE BEGIN
-    GameState* nextState = pastStates.back()->nextLevel[bestMoveIndex].get();
-    GameState* currentState = pastStates.back().get();
-    int x1 = -1;
-    int y1 = -1;
-    int x2 = -1;
-    int y2 = -1;
-    for (int y = 0; y < 8; y++)
+    int bestMoveIndex;
+    if (searchOptions.mcts)
+    {
+        bestMoveIndex = (clock.running() ? searchMcts(0, std::max(manager.softLimit, 0.001)) : searchMcts(searchOptions.mctsPlayouts, 0));
+        std::cout << "mcts " << mctsPlayouts << " playouts (" << mctsMs << " ms, " << (long)(mctsPlayouts / std::max(mctsMs/1000, 1e-3)) << " per second) eval " << pastStates.back()->evaluation << " pv " << uciLine(principalVariation) << '\n';
+    }
+    else if (searchOptions.depthFirst)
     {
-        for (int x = 7; x >= 0; x--) // run right left so that castle's will be a king move
+        timeManager = (clock.running() ? &manager : nullptr);
+        bestMoveIndex = searchDepthFirst(clock.running() ? TIME_MAX_DEPTH : searchOptions.depth);
+        timeManager = nullptr;
+        if (bestMoveIndex != -1 && !iterations.empty())
         {
-            // if square is empty but wasn't AND (was white's turn and white was at the square OR was blacks turn and black was at the square)
-            if (nextState->board[x][y] == PieceType::EMPTY && currentState->board[x][y] != PieceType::EMPTY
-                && ( (currentState->whiteTurn && (int)currentState->board[x][y] < COLOR_THRESHOLD/*emptyness check in previous conditions*/) || (!currentState->whiteTurn && (int)currentState->board[x][y] > COLOR_THRESHOLD) ) // for en passant
-            )
-            {
-                x1 = x;
-                y1 = y;
-            }
-            // if isn't empty and wasn't empty and it's different OR if isn't empty but it was
-            else if ((nextState->board[x][y] != PieceType::EMPTY && currentState->board[x][y] != nextState->board[x][y]) || (nextState->board[x][y] != currentState->board[x][y] && currentState->board[x][y] == PieceType::EMPTY))
-            {
-                x2 = x;
-                y2 = y;
-            }
+            const SearchIteration &last = iterations.back();
+            std::cout << "depth " << last.depth << " eval " << last.evaluation << " nodes " << last.nodes << " (" << last.ms << " ms) pv " << uciLine(last.pv) << '\n';
         }
     }
-    // kingside white
-    if (currentState->board[4][0] == PieceType::W_KING && nextState->board[6][0] == PieceType::W_KING)
-    { x1=4; y1=0; x2=6; y2=0; }
-    // queenside white
-    else if (currentState->board[4][0] == PieceType::W_KING && nextState->board[2][0] == PieceType::W_KING)
-    { x1=4; y1=0; x2=2; y2=0; }
-    else if (currentState->board[4][7] == PieceType::W_KING && nextState->board[6][7] == PieceType::W_KING)
-    { x1=4; y1=7; x2=6; y2=7; }
-    // queenside white
-    else if (currentState->board[4][7] == PieceType::W_KING && nextState->board[2][7] == PieceType::W_KING)
-    { x1=4; y1=7; x2=2; y2=7; }
-    if (x1==-1 || y1==-1 || x2==-1 || y2==-1) { std::cout << " ##### ERROR IN PRINTMOVE SECTION OF pushComputerState() ##### \n"; }
+    else
+    {
+        if (clock.running()) { genForSeconds(std::max(manager.softLimit, 0.001)); }
+        minimaxEval(pastStates.back().get()); // pass current GameState
+        bestMoveIndex = bestChildIndex(pastStates.back().get());
+    }
+    if (bestMoveIndex == -1)
+    {
+        std::cout << " ##### ERROR No move found @ pushComputerState() ##### \n";
+        return;
+    }
+    for (int i = 0; i < (int)multiPVLines.size(); i++) { std::cout << "  " << i+1 << ". eval " << multiPVLines[i].evaluation << " pv " << uciLine(multiPVLines[i].pv) << '\n'; }
+    traceSearch(pastStates.back().get(), bestMoveIndex);
+    
+    // PRINT MOVE BEGIN
+    int x1, y1, x2, y2;
+    if (!childMove(pastStates.back().get(), pastStates.back()->nextLevel[bestMoveIndex].get(), x1, y1, x2, y2)) { std::cout << " ##### ERROR IN PRINTMOVE SECTION OF pushComputerState() ##### \n"; }
     pushMove(x1,y1,x2,y2);
     
     std::cout << moveList.back() << '\n';
     // PRINT MOVE END
     
+    pushState(bestMoveIndex);
+    chargeClock();
+}
+
+int StateTree::bestChildIndex(GameState* _gs)
+{
+    if ((int)_gs->nextLevel.size() == 0) { return -1; }
+    
+    int bestMoveIndex = 0;
+    for (int i = 0; i < (int)_gs->nextLevel.size(); i++)
+    {
+        GameState* _childState = _gs->nextLevel[i].get();
+        
+        if (_gs->whiteTurn && _childState->evaluation > _gs->nextLevel[bestMoveIndex]->evaluation) { bestMoveIndex = i; } // maximize
+        else if (!_gs->whiteTurn && _childState->evaluation < _gs->nextLevel[bestMoveIndex]->evaluation) { bestMoveIndex = i; } // minimize
+    }
+    return bestMoveIndex;
+}
+
+bool StateTree::childMove(GameState* _gs, GameState* _child, int &_x1, int &_y1, int &_x2, int &_y2)
+{
+    STATS_TIME(stats.moveDiffTicks);
+    
+    _x1 = _child->fromX;
+    _y1 = _child->fromY;
+    _x2 = _child->toX;
+    _y2 = _child->toY;
+    return _x1 != -1;
+}
+
+void StateTree::pushState(int _index)
+{
     // now push the move onto pastStates, NOTE this should preserve the tree
-    pastStates.push_back(std::move(pastStates.back()->nextLevel[bestMoveIndex]));
+    pastStates.push_back(std::move(pastStates.back()->nextLevel[_index]));
     
     // clear the other moves, NOTE this should preserve the tree under the pointer
     pastStates[(int)pastStates.size()-2]->nextLevel.clear();
+    
+    // the new current state's children are read like the old one's were, give them back the boards genLevel() dropped
+    for (auto &child : pastStates.back()->nextLevel) { materialize(child.get()); }
 }
 
 bool StateTree::pushPlayerState(int _x1, int _y1, int _x2, int _y2)
@@ -342,42 +862,23 @@ bool StateTree::pushPlayerState(int _x1, int _y1, int _x2, int _y2)
         return false;
     }
     
-    std::array<std::array<PieceType,8>,8> playerBoard = pastStates.back()->board;
-    
-    playerBoard[_x2][_y2] = playerBoard[_x1][_y1]; // NOTE all that matters is where they move a piece to --- ATTENTION WRONG!!!!! added stuff below
-    playerBoard[_x1][_y1] = PieceType::EMPTY;
-    
-    // Make sure a move can be made
-    if ((int)pastStates.back()->nextLevel.size() == 0)
+    // NOTE checked on the board, the children may not have been generated yet and the pseudo-legal ones include moves into check
+    if (!legalMove(currentState, Move{(std::int8_t)_x1, (std::int8_t)_y1, (std::int8_t)_x2, (std::int8_t)_y2}))
     {
-        std::cout << " ##### ERROR No moves to make!!! @ pushComputerState() ##### \n";
+        std::cout << "Invalid Move. Try again\n";
         return false;
     }
+    std::cout << "Move Verified\n";
     
-    int playerMoveIndex = -1;
-    
-    for (int i = 0; i < (int)pastStates.back()->nextLevel.size(); i++)
-    {
-        GameState* _childState = pastStates.back()->nextLevel[i].get(); // now we have a pointer "_childState" to the GameState
-        if (_childState->board[_x2][_y2] == playerBoard[_x2][_y2] && _childState->board[_x1][_y1] == playerBoard[_x1][_y1]) // white's move
-        {
-            std::cout << "Move Verified\n";
-            playerMoveIndex = i;
-            break;
-        }
-    }
-    
+    if (currentState->nextLevel.empty()) { genToDepth(1); }
+    int playerMoveIndex = findChild(currentState, _x1, _y1, _x2, _y2);
     if (playerMoveIndex == -1)
     {
-        std::cout << "Invalid Move. Try again\n";
+        std::cout << " ##### ERROR legal move not generated @ pushPlayerState() ##### \n";
         return false;
     }
     
-    // now push the move onto pastStates, NOTE this should preserve the tree
-    pastStates.push_back(std::move(pastStates.back()->nextLevel[playerMoveIndex]));
-    
-    // clear the other moves, NOTE this should preserve the tree under the pointer
-    pastStates[(int)pastStates.size()-2]->nextLevel.clear();
+    pushState(playerMoveIndex);
     
     pushMove(_x1,_y1,_x2,_y2);
     
@@ -396,230 +897,88 @@ void StateTree::pushMove(int _x1,int _y1,int _x2,int _y2)
     moveList.push_back(out);
 }
 
+int StateTree::legalMoveCount(GameState* _gs)
+{
+    int count = 0;
+    for (int i = 0; i < (int)_gs->nextLevel.size(); i++)
+    {
+        if (!kingAttacked(_gs->nextLevel[i].get(), _gs->whiteTurn)) { count++; }
+    }
+    return count;
+}
+
+int StateTree::findChild(GameState* _gs, int _x1, int _y1, int _x2, int _y2)
+{
+    PieceType piece = _gs->board[_x1][_y1];
+    if (piece == PieceType::EMPTY) { return -1; }
+    
+    for (int i = 0; i < (int)_gs->nextLevel.size(); i++)
+    {
+        GameState* _childState = _gs->nextLevel[i].get();
+        if (_childState->fromX == _x1 && _childState->fromY == _y1 && _childState->toX == _x2 && _childState->toY == _y2) { return i; }
+    }
+    return -1;
+}
+
+bool StateTree::inBook()
+{
+    return book.isOpen() && book.contains(zobristKey(pastStates.back().get())); // NOTE not probeBook(), a weighted or uniform pick would use up a random draw that pushComputerState() never sees
+}
+
+bool StateTree::probeBook(BookMove &_move)
+{
+    if (!book.isOpen()) { return false; }
+    
+    GameState* currentState = pastStates.back().get();
+    if (!book.probe(zobristKey(currentState), _move)) { return false; }
+    
+    // Polyglot castles as king-takes-rook (e1h1, e1a1, e8h8, e8a8)
+    PieceType piece = currentState->board[_move.x1][_move.y1];
+    if ((piece == PieceType::W_KING || piece == PieceType::B_KING) && _move.x1 == 4 && _move.y1 == _move.y2)
+    {
+        if (_move.x2 == 7) { _move.x2 = 6; }
+        else if (_move.x2 == 0) { _move.x2 = 2; }
+    }
+    return true;
+}
+
 // ---------- MOVEMENT ----------
 
 void StateTree::pawnMove(GameState* _parentGS, int _x, int _y)
 {
-    if (_y == 0 || _y == 7) { return; } // fix this ATTENTION
+    if (_y == 0 || _y == 7) { return; } // NOTE can only happen on a hand-made board, addChild() promotes pawns reaching the last rank
     
     int moveDir = (_parentGS->whiteTurn ? 1:-1); // since white moves up board and black moves down board
+    bool promotion = (_y+moveDir == 0 || _y+moveDir == 7);
+    bool pushes = (genStage == GenStage::ALL || (genStage == GenStage::CAPTURES) == promotion); // NOTE a promotion counts as a capture
     
     // FORWARD ONE
-    if (_parentGS->board[_x][_y+moveDir] == PieceType::EMPTY)
-    {
-        std::unique_ptr<GameState> childGS (new GameState(_parentGS));
-        childGS->board = _parentGS->board;
-        // perform move
-        childGS->board[_x][_y+moveDir] = childGS->board[_x][_y];
-        childGS->board[_x][_y] = PieceType::EMPTY;
-        // push as child to parent
-        deepestLevel.push_back(childGS.get());
-        _parentGS->nextLevel.push_back(std::move(childGS));
+    if (pushes && _parentGS->board[_x][_y+moveDir] == PieceType::EMPTY)
+    {
+        addChild(_parentGS,_x,_y,_x,_y+moveDir);
         
         // FORWARD TWO - done here bacause will only happen when Forward One can also happen
-        if (_parentGS->board[_x][_y+2*moveDir] == PieceType::EMPTY && ((_y == 6 && moveDir == -1) || (_y == 1 && moveDir == 1)))
-        {
-            std::unique_ptr<GameState> childGS2 (new GameState(_parentGS));
-            childGS2->board = _parentGS->board;
-            // perform move
-            childGS2->board[_x][_y+2*moveDir] = childGS2->board[_x][_y];
-            childGS2->board[_x][_y] = PieceType::EMPTY;
-            // push as child to parent
-            deepestLevel.push_back(childGS2.get());
-            _parentGS->nextLevel.push_back(std::move(childGS2));
-        }
-    }
-
-    // ATTACK - not edges
-    if (_x>0 && _x<7)
-    {
-        // WHITE
-        //left
-        if (moveDir == 1 && (int)_parentGS->board[_x-1][_y+1] > COLOR_THRESHOLD)
-        {
-            // create new GameState and copy old one
-            std::unique_ptr<GameState> childGS (new GameState(_parentGS));
-            childGS->board = _parentGS->board;
-            // perform move
-            childGS->board[_x-1][_y+1] = PieceType::W_PAWN;
-            childGS->board[_x][_y] = PieceType::EMPTY;
-            // push as child to parent
-            deepestLevel.push_back(childGS.get());
-            _parentGS->nextLevel.push_back(std::move(childGS));
-        }
-        //right
-        if (moveDir == 1 && (int)_parentGS->board[_x+1][_y+1] > COLOR_THRESHOLD)
-        {
-            // create new GameState and copy old one
-            std::unique_ptr<GameState> childGS (new GameState(_parentGS));
-            childGS->board = _parentGS->board;
-            // perform move
-            childGS->board[_x+1][_y+1] = PieceType::W_PAWN;
-            childGS->board[_x][_y] = PieceType::EMPTY;
-            // push as child to parent
-            deepestLevel.push_back(childGS.get());
-            _parentGS->nextLevel.push_back(std::move(childGS));
-        }
-        // BLACK
-        //left
-        if (moveDir == -1 && (int)_parentGS->board[_x-1][_y-1] < COLOR_THRESHOLD && _parentGS->board[_x-1][_y-1] != PieceType::EMPTY)
-        {
-            // create new GameState and copy old one
-            std::unique_ptr<GameState> childGS (new GameState(_parentGS));
-            childGS->board = _parentGS->board;
-            // perform move
-            childGS->board[_x-1][_y-1] = PieceType::B_PAWN;
-            childGS->board[_x][_y] = PieceType::EMPTY;
-            // push as child to parent
-            deepestLevel.push_back(childGS.get());
-            _parentGS->nextLevel.push_back(std::move(childGS));
-        }
-        //right
-        if (moveDir == -1 && (int)_parentGS->board[_x+1][_y-1] < COLOR_THRESHOLD && _parentGS->board[_x+1][_y-1] != PieceType::EMPTY)
-        {
-            // create new GameState and copy old one
-            std::unique_ptr<GameState> childGS (new GameState(_parentGS));
-            childGS->board = _parentGS->board;
-            // perform move
-            childGS->board[_x+1][_y-1] = PieceType::B_PAWN;
-            childGS->board[_x][_y] = PieceType::EMPTY;
-            // push as child to parent
-            deepestLevel.push_back(childGS.get());
-            _parentGS->nextLevel.push_back(std::move(childGS));
-        }
-    }
-    // ATTACK - edges
-    else if (_x==0 || _x==7)
-    {
-        int attackDir = (_x==0 ? 1:-1); // NOTE if x!=0 then x==7
-        // WHITE
-        if (moveDir == 1 && (int)_parentGS->board[_x+attackDir][_y+moveDir] > COLOR_THRESHOLD)
-        {
-            // create new GameState and copy old one
-            std::unique_ptr<GameState> childGS (new GameState(_parentGS));
-            childGS->board = _parentGS->board;
-            // perform move
-            childGS->board[_x+attackDir][_y+moveDir] = PieceType::W_PAWN;
-            childGS->board[_x][_y] = PieceType::EMPTY;
-            // push as child to parent
-            deepestLevel.push_back(childGS.get());
-            _parentGS->nextLevel.push_back(std::move(childGS));
-        }
-        // BLACK
-        else if (moveDir == -1 && (int)_parentGS->board[_x+attackDir][_y+moveDir] < COLOR_THRESHOLD && _parentGS->board[_x+attackDir][_y+moveDir] != PieceType::EMPTY)
+        if (((_y == 6 && moveDir == -1) || (_y == 1 && moveDir == 1)) && _parentGS->board[_x][_y+2*moveDir] == PieceType::EMPTY)
         {
-            // create new GameState and copy old one
-            std::unique_ptr<GameState> childGS (new GameState(_parentGS));
-            childGS->board = _parentGS->board;
-            // perform move
-            childGS->board[_x+attackDir][_y+moveDir] = PieceType::B_PAWN;
-            childGS->board[_x][_y] = PieceType::EMPTY;
-            // push as child to parent
-            deepestLevel.push_back(childGS.get());
-            _parentGS->nextLevel.push_back(std::move(childGS));
+            addChild(_parentGS,_x,_y,_x,_y+2*moveDir)->doubleMoveFile = _x;
         }
     }
-    else
-    { std::cout << "Something broke in pawnMove()::attack\n"; }
-
-    // EN PASSANT
-    if (_x>0 && _x<7)
-    {
-        // WHITE
-        //left
-        if (moveDir == 1 && _parentGS->board[_x-1][_y] == PieceType::B_PAWN && madeDoubleMove(_parentGS,_x-1,_y))
-        {
-            // create new GameState and copy old one
-            std::unique_ptr<GameState> childGS (new GameState(_parentGS));
-            childGS->board = _parentGS->board;
-            // perform move
-            childGS->board[_x-1][_y+1] = PieceType::W_PAWN;
-            childGS->board[_x-1][_y] = PieceType::EMPTY;
-            childGS->board[_x][_y] = PieceType::EMPTY;
-            // push as child to parent
-            deepestLevel.push_back(childGS.get());
-            _parentGS->nextLevel.push_back(std::move(childGS));
-        }
-        //right
-        if (moveDir == 1 && _parentGS->board[_x+1][_y] > PieceType::B_PAWN && madeDoubleMove(_parentGS,_x+1,_y))
-        {
-            // create new GameState and copy old one
-            std::unique_ptr<GameState> childGS (new GameState(_parentGS));
-            childGS->board = _parentGS->board;
-            // perform move
-            childGS->board[_x+1][_y+1] = PieceType::W_PAWN;
-            childGS->board[_x+1][_y] = PieceType::EMPTY;
-            childGS->board[_x][_y] = PieceType::EMPTY;
-            // push as child to parent
-            deepestLevel.push_back(childGS.get());
-            _parentGS->nextLevel.push_back(std::move(childGS));
-        }
-        // BLACK
-        //left
-        if (moveDir == -1 && _parentGS->board[_x-1][_y] == PieceType::W_PAWN && madeDoubleMove(_parentGS,_x-1,_y))
-        {
-            // create new GameState and copy old one
-            std::unique_ptr<GameState> childGS (new GameState(_parentGS));
-            childGS->board = _parentGS->board;
-            // perform move
-            childGS->board[_x-1][_y-1] = PieceType::B_PAWN;
-            childGS->board[_x-1][_y] = PieceType::EMPTY;
-            childGS->board[_x][_y] = PieceType::EMPTY;
-            // push as child to parent
-            deepestLevel.push_back(childGS.get());
-            _parentGS->nextLevel.push_back(std::move(childGS));
-        }
-        //right
-        if (moveDir == -1 && _parentGS->board[_x+1][_y] == PieceType::W_PAWN && madeDoubleMove(_parentGS,_x+1,_y))
-        {
-            // create new GameState and copy old one
-            std::unique_ptr<GameState> childGS (new GameState(_parentGS));
-            childGS->board = _parentGS->board;
-            // perform move
-            childGS->board[_x+1][_y-1] = PieceType::B_PAWN;
-            childGS->board[_x+1][_y] = PieceType::EMPTY;
-            childGS->board[_x][_y] = PieceType::EMPTY;
-            // push as child to parent
-            deepestLevel.push_back(childGS.get());
-            _parentGS->nextLevel.push_back(std::move(childGS));
-        }
-    }
-    // ATTACK - edges
-    else if (_x==0 || _x==7)
+    
+    if (genStage == GenStage::QUIETS) { return; }
+    for (int attackDir = -1; attackDir <= 1; attackDir += 2)
     {
-        int attackDir = (_x==0 ? 1:-1); // NOTE if x!=0 then x==7
-        // WHITE
-        if (moveDir == 1 && _parentGS->board[_x+attackDir][_y] == PieceType::B_PAWN && madeDoubleMove(_parentGS,_x+attackDir,_y))
-        {
-            // create new GameState and copy old one
-            std::unique_ptr<GameState> childGS (new GameState(_parentGS));
-            childGS->board = _parentGS->board;
-            // perform move
-            childGS->board[_x+attackDir][_y+1] = PieceType::W_PAWN;
-            childGS->board[_x+attackDir][_y] = PieceType::EMPTY;
-            childGS->board[_x][_y] = PieceType::EMPTY;
-            // push as child to parent
-            deepestLevel.push_back(childGS.get());
-            _parentGS->nextLevel.push_back(std::move(childGS));
-        }
-        // BLACK
-        else if (moveDir == -1 && _parentGS->board[_x+attackDir][_y] == PieceType::W_PAWN && madeDoubleMove(_parentGS,_x+attackDir,_y))
+        // ATTACK
+        if (validMove(_parentGS,_x+attackDir,_y+moveDir) == 2) { addChild(_parentGS,_x,_y,_x+attackDir,_y+moveDir); }
+        
+        // EN PASSANT
+        if (_x+attackDir >= 0 && _x+attackDir <= 7 && madeDoubleMove(_parentGS,_x+attackDir,_y))
         {
-            // create new GameState and copy old one
-            std::unique_ptr<GameState> childGS (new GameState(_parentGS));
-            childGS->board = _parentGS->board;
-            // perform move
-            childGS->board[_x+attackDir][_y-1] = PieceType::B_PAWN;
+            GameState* childGS = addChild(_parentGS,_x,_y,_x+attackDir,_y+moveDir);
+            childGS->captured = childGS->board[_x+attackDir][_y];
             childGS->board[_x+attackDir][_y] = PieceType::EMPTY;
-            childGS->board[_x][_y] = PieceType::EMPTY;
-            // push as child to parent
-            deepestLevel.push_back(childGS.get());
-            _parentGS->nextLevel.push_back(std::move(childGS));
+            childGS->boardKey ^= zobristSquareKey(childGS->captured, _x+attackDir, _y);
         }
     }
-    else
-    { std::cout << "Something broke in pawnMove()::enPassant\n"; }
-    
 }
 
 void StateTree::knightMove(GameState* _parentGS, int _x, int _y)
@@ -765,76 +1124,73 @@ void StateTree::kingMove(GameState* _parentGS, int _x, int _y)
 
 // ---------- HELPERS -----------
 
+GameState* StateTree::addChild(GameState* _parentGS, int _x1, int _y1, int _x2, int _y2)
+{
+    std::unique_ptr<GameState> childGS (new GameState(_parentGS));
+    childGS->board = _parentGS->board;
+    
+    PieceType piece = _parentGS->board[_x1][_y1];
+    childGS->captured = _parentGS->board[_x2][_y2];
+    childGS->fromX = _x1;
+    childGS->fromY = _y1;
+    childGS->toX = _x2;
+    childGS->toY = _y2;
+    
+    // make move
+    childGS->board[_x2][_y2] = piece;
+    childGS->board[_x1][_y1] = PieceType::EMPTY;
+    
+    bool pawn = (piece == PieceType::W_PAWN || piece == PieceType::B_PAWN);
+    if (pawn || childGS->captured != PieceType::EMPTY) { childGS->halfmoveClock = 0; }
+    // WARNING ONLY QUEEN PROMOTION RIGHT NOW
+    if (piece == PieceType::W_PAWN && _y2 == 7) { childGS->board[_x2][_y2] = PieceType::W_QUEEN; }
+    if (piece == PieceType::B_PAWN && _y2 == 0) { childGS->board[_x2][_y2] = PieceType::B_QUEEN; }
+    childGS->boardKey ^= zobristSquareKey(piece, _x1, _y1) ^ zobristSquareKey(childGS->captured, _x2, _y2) ^ zobristSquareKey(childGS->board[_x2][_y2], _x2, _y2);
+    
+    GameState* child = childGS.get();
+    _parentGS->nextLevel.push_back(std::move(childGS));
+    return child;
+}
+
 void StateTree::evalCastleAbility(GameState* _parentGS)
 {
-    if (_parentGS->whiteTurn && _parentGS->inCheck_W) { return; }
-    if (!_parentGS->whiteTurn && _parentGS->inCheck_B) { return; }
+    // NOTE the king may not castle out of, through or into check
+    int y = (_parentGS->whiteTurn ? 0:7);
+    PieceType king = (_parentGS->whiteTurn ? PieceType::W_KING : PieceType::B_KING);
+    PieceType rook = (_parentGS->whiteTurn ? PieceType::W_ROOK : PieceType::B_ROOK);
+    bool kingsideRookMoved = (_parentGS->whiteTurn ? _parentGS->kingsideRookMoved_W : _parentGS->kingsideRookMoved_B);
+    bool queensideRookMoved = (_parentGS->whiteTurn ? _parentGS->queensideRookMoved_W : _parentGS->queensideRookMoved_B);
     
-    // WHITE
-    if (!_parentGS->kingsideRookMoved_W && !_parentGS->queensideRookMoved_W)
-    {
-        // queenside
-        if (_parentGS->board[1][0] == PieceType::EMPTY && _parentGS->board[2][0] == PieceType::EMPTY && _parentGS->board[3][0] == PieceType::EMPTY)
-        {
-            // NOTE Queenside castle
-            std::unique_ptr<GameState> childGS (new GameState(_parentGS));
-            childGS->board = _parentGS->board;
-            // make move
-            childGS->board[2][0] = childGS->board[4][0]; // swap king
-            childGS->board[4][0] = PieceType::EMPTY; // delete old king
-            childGS->board[3][0] = childGS->board[0][0]; // swap rook
-            childGS->board[0][0] = PieceType::EMPTY; // delete old rook
-            childGS->castled_W = true;
-            _parentGS->nextLevel.push_back(std::move(childGS));
-        }
-            
-        // kingside
-        if (_parentGS->board[5][0] == PieceType::EMPTY && _parentGS->board[6][0] == PieceType::EMPTY)
-        {
-            // NOTE Kingside castle
-            std::unique_ptr<GameState> childGS (new GameState(_parentGS));
-            childGS->board = _parentGS->board;
-            // make move
-            childGS->board[6][0] = childGS->board[4][0]; // swap king
-            childGS->board[4][0] = PieceType::EMPTY; // delete old king
-            childGS->board[5][0] = childGS->board[7][0]; // swap rook
-            childGS->board[7][0] = PieceType::EMPTY; // delete old rook
-            childGS->castled_W = true;
-            _parentGS->nextLevel.push_back(std::move(childGS));
-        }
-    }
+    if (_parentGS->board[4][y] != king || (kingsideRookMoved && queensideRookMoved)) { return; }
+    if (squareAttacked(_parentGS, 4, y, !_parentGS->whiteTurn)) { return; }
     
-    // BLACK
-    if (!_parentGS->kingsideRookMoved_B && !_parentGS->queensideRookMoved_B)
+    for (int side = 0; side < 2; side++)
     {
-        // queenside
-        if (_parentGS->board[1][7] == PieceType::EMPTY && _parentGS->board[2][7] == PieceType::EMPTY && _parentGS->board[3][7] == PieceType::EMPTY)
+        bool kingside = (side == 1);
+        int rookX = (kingside ? 7:0);
+        int kingX = (kingside ? 6:2);
+        int passX = (kingside ? 5:3); // the square the king passes and the rook lands on
+        
+        if ((kingside ? kingsideRookMoved : queensideRookMoved) || _parentGS->board[rookX][y] != rook) { continue; }
+        if (_parentGS->board[passX][y] != PieceType::EMPTY || _parentGS->board[kingX][y] != PieceType::EMPTY) { continue; }
+        if (!kingside && _parentGS->board[1][y] != PieceType::EMPTY) { continue; }
+        if (squareAttacked(_parentGS, passX, y, !_parentGS->whiteTurn) || squareAttacked(_parentGS, kingX, y, !_parentGS->whiteTurn)) { continue; }
+        
+        GameState* childGS = addChild(_parentGS,4,y,kingX,y); // swap king
+        childGS->board[passX][y] = rook; // swap rook
+        childGS->board[rookX][y] = PieceType::EMPTY; // delete old rook
+        childGS->boardKey ^= zobristSquareKey(rook, rookX, y) ^ zobristSquareKey(rook, passX, y);
+        if (_parentGS->whiteTurn)
         {
-            // NOTE Queenside castle
-            std::unique_ptr<GameState> childGS (new GameState(_parentGS));
-            childGS->board = _parentGS->board;
-            // make move
-            childGS->board[2][7] = childGS->board[4][7]; // swap king
-            childGS->board[4][7] = PieceType::EMPTY; // delete old king
-            childGS->board[3][7] = childGS->board[0][7]; // swap rook
-            childGS->board[0][7] = PieceType::EMPTY; // delete old rook
-            childGS->castled_B = true;
-            _parentGS->nextLevel.push_back(std::move(childGS));
+            childGS->castled_W = true;
+            childGS->kingsideRookMoved_W = true;
+            childGS->queensideRookMoved_W = true;
         }
-            
-        // kingside
-        if (_parentGS->board[5][7] == PieceType::EMPTY && _parentGS->board[6][7] == PieceType::EMPTY)
+        else
         {
-            // NOTE Kingside castle
-            std::unique_ptr<GameState> childGS (new GameState(_parentGS));
-            childGS->board = _parentGS->board;
-            // make move
-            childGS->board[6][7] = childGS->board[4][7]; // swap king
-            childGS->board[4][7] = PieceType::EMPTY; // delete old king
-            childGS->board[5][7] = childGS->board[7][7]; // swap rook
-            childGS->board[7][7] = PieceType::EMPTY; // delete old rook
             childGS->castled_B = true;
-            _parentGS->nextLevel.push_back(std::move(childGS));
+            childGS->kingsideRookMoved_B = true;
+            childGS->queensideRookMoved_B = true;
         }
     }
 }
@@ -859,28 +1215,26 @@ void StateTree::evalPawnPromotions(GameState* _gs) // WARNING ONLY QUEEN PROMOTI
 
 void StateTree::processStateGen(GameState* _parentGS, int _x1, int _y1, int _x2, int _y2)
 {
-    if (!validMove(_parentGS,_x2,_y2)) { return; } // don't do anything if requested move is invalid
+    int collision = validMove(_parentGS,_x2,_y2);
+    if (!collision) { return; } // don't do anything if requested move is invalid
+    if ((genStage == GenStage::CAPTURES && collision != 2) || (genStage == GenStage::QUIETS && collision == 2)) { return; }
     
-    std::unique_ptr<GameState> childGS (new GameState(_parentGS));
-    childGS->board = _parentGS->board;
-    // make move
-    childGS->board[_x2][_y2] = childGS->board[_x1][_y1];
-    childGS->board[_x1][_y1] = PieceType::EMPTY;
+    GameState* childGS = addChild(_parentGS,_x1,_y1,_x2,_y2);
     
     // check if rook move or kingmove
     // if the piece being moved is white or black rook, then check which side it's on (queenside or kingside)
     if ((_parentGS->board[_x1][_y1] == PieceType::W_ROOK || _parentGS->board[_x1][_y1] == PieceType::B_ROOK))
     {
-        // the childState has a moved rook if execution reaches here
-        if (childGS->whiteTurn)
+        // the childState has a moved rook if execution reaches here, NOTE it's the parent's side that moved and only a rook leaving its home rank's corner counts
+        if (_parentGS->whiteTurn)
         {
-            if (_x1 == 0) { childGS->queensideRookMoved_W = true; }
-            if (_x1 == 7) { childGS->kingsideRookMoved_W = true; }
+            if (_x1 == 0 && _y1 == 0) { childGS->queensideRookMoved_W = true; }
+            if (_x1 == 7 && _y1 == 0) { childGS->kingsideRookMoved_W = true; }
         }
-        else if (!childGS->whiteTurn)
+        else if (!_parentGS->whiteTurn)
         {
-            if (_x1 == 0) { childGS->queensideRookMoved_B = true; }
-            if (_x1 == 7) { childGS->kingsideRookMoved_B = true; }
+            if (_x1 == 0 && _y1 == 7) { childGS->queensideRookMoved_B = true; }
+            if (_x1 == 7 && _y1 == 7) { childGS->kingsideRookMoved_B = true; }
         }
         else { std::cout << " ##### ERROR (1) in evalCastleAbility() ##### \n"; }
     }
@@ -888,12 +1242,12 @@ void StateTree::processStateGen(GameState* _parentGS, int _x1, int _y1, int _x2,
     if ((_parentGS->board[_x1][_y1] == PieceType::W_KING || _parentGS->board[_x1][_y1] == PieceType::B_KING))
     {
         // the childState has a moved king if execution reaches here
-        if (_x1==4 && childGS->whiteTurn)
+        if (_x1==4 && _parentGS->whiteTurn)
         {
             childGS->queensideRookMoved_W = true;
             childGS->kingsideRookMoved_W = true;
         }
-        else if (_x1==4 && !childGS->whiteTurn)
+        else if (_x1==4 && !_parentGS->whiteTurn)
         {
             childGS->queensideRookMoved_B = true;
             childGS->kingsideRookMoved_B = true;
@@ -901,8 +1255,6 @@ void StateTree::processStateGen(GameState* _parentGS, int _x1, int _y1, int _x2,
         //else { std::cout << " ##### ERROR (2) in evalCastleAbility() ##### \n"; }
         // ATTENTION HERE ATTENTION HERE UNSUPRESS THIS ERROR AND FIND OUT WHAT'S UP... ONLY SHOULD HAPPEN WHEN KING MOVES BUT NOT OFF HIS ORIGINAL SQUARE... WHY IS THE ENGINE SPITTING OUT THIS ERROR SO EARLY? ERROR HAPPENS AFTER BLACK PLAYER'S FIRST MOVE WHICH DEPTH OF 4... I GUESS THAT COULD HAPPEN MAYBE
     }
-    
-    _parentGS->nextLevel.push_back(std::move(childGS));
 }
 
 int StateTree::validMove(GameState* _parentGS, int _x2, int _y2)
@@ -917,45 +1269,88 @@ int StateTree::validMove(GameState* _parentGS, int _x2, int _y2)
 
 bool StateTree::madeDoubleMove(GameState* _gs, int _x, int _y)
 {
-    if (_y != 3 && _y != 4) // make sure the correct pieces are being tested
+    // the enemy pawn has to be on the square it lands on after a double move, on the file that double-moved last turn
+    if (_gs->whiteTurn) { return _y == 4 && _gs->board[_x][_y] == PieceType::B_PAWN && _gs->doubleMoveFile == _x; }
+    else { return _y == 3 && _gs->board[_x][_y] == PieceType::W_PAWN && _gs->doubleMoveFile == _x; }
+}
+
+void StateTree::cachedEvaluate(GameState* _gs)
+{
+    bool hit;
+    uint64_t key = _gs->boardKey ^ (_gs->whiteTurn ? zobristKeys[ZOBRIST_TURN] : 0); // NOTE the NNUE and the endgame evaluators depend on the side to move
+    EvalEntry &entry = evalCache.probe(key, hit);
+    if (hit)
     {
-        return false;
+        _gs->evaluation = entry.evaluation;
+        return;
+    }
+    bool replayed = materialize(_gs); // NOTE after the probe, a hit doesn't need the board
+    if (nnue != nullptr) { evaluateNnue(_gs); }
+    else { evaluate(_gs); }
+    if (replayed) { _gs->board.drop(); }
+    entry.key = key;
+    entry.evaluation = _gs->evaluation;
+}
+
+void StateTree::evaluateNnue(GameState* _gs)
+{
+    NnueAccumulator scratch;
+    const NnueAccumulator &acc = nnueAccumulator(_gs, scratch);
+    if (acc.kings[0] == 0 || acc.kings[1] == 0)
+    {
+        evaluate(_gs); // knows how to score a missing king
+        return;
     }
+    bool exact;
+    if (countPieces(_gs) <= ENDGAME_MAX_PIECES && endgameEvaluate(_gs, _gs->evaluation, exact)) { return; }
+    _gs->evaluation = nnue->evaluate(acc, _gs->whiteTurn);
+}
+
+const NnueAccumulator& StateTree::nnueAccumulator(GameState* _gs, NnueAccumulator &_scratch)
+{
+    if (_gs->accumulator) { return *_gs->accumulator; }
     
-    if (_gs->whiteTurn)
+    // NOTE leaves far outnumber the rest, keeping an accumulator for each of them would cost more memory than the tree itself
+    if (!_gs->nextLevel.empty()) { _gs->accumulator.reset(new NnueAccumulator); }
+    NnueAccumulator &acc = (_gs->accumulator ? *_gs->accumulator : _scratch);
+    if (_gs->parent == nullptr) { nnue->refresh(_gs->board, acc); }
+    else
     {
-        // make sure piece at current location is black
-        if (_gs->board[_x][_y] != PieceType::B_PAWN) { return false; }
-        // make sure piece at initial pawn spot is empty this turn
-        if (_gs->board[_x][_y+2] != PieceType::EMPTY) { return false; }
-        // make sure piece at current location was empty last turn
-        if (_gs->parent->board[_x][_y] != PieceType::EMPTY) { return false; }
-        // make sure piece at initial pawn spot was black pawn last turn
-        if (_gs->parent->board[_x][_y+2] != PieceType::B_PAWN) { return false; }
-        
-        // if all conditions pass return true
-        return true;
+        NnueAccumulator parentScratch;
+        const NnueAccumulator &from = nnueAccumulator(_gs->parent, parentScratch);
+        bool replayedParent = materialize(_gs->parent);
+        bool replayed = materialize(_gs);
+        nnue->update(_gs->parent->board, _gs->board, from, acc);
+        if (replayedParent) { _gs->parent->board.drop(); }
+        if (replayed) { _gs->board.drop(); }
     }
-    else if (!_gs->whiteTurn)
-    {
-        // make sure piece at current location is black
-        if (_gs->board[_x][_y] != PieceType::W_PAWN) { return false; }
-        // make sure piece at initial pawn spot is empty this turn
-        if (_gs->board[_x][_y-2] != PieceType::EMPTY) { return false; }
-        // make sure piece at current location was empty last turn
-        if (_gs->parent->board[_x][_y] != PieceType::EMPTY) { return false; }
-        // make sure piece at initial pawn spot was black pawn last turn
-        if (_gs->parent->board[_x][_y-2] != PieceType::W_PAWN) { return false; }
-        
-        // if all conditions pass return true
-        return true;
+    return acc;
+}
+
+static const float PASSED_PAWN_BONUS[8] = {0, 0.1, 0.15, 0.25, 0.4, 0.6, 0.9, 0}; // by rank from the pawn's own side
+
+// pawns in front of a king that is still on its first two ranks, NOTE _kx is -1 if there is no king
+static float kingShield(uint64_t _pawns, int _kx, int _ky, bool _white)
+{
+    if (_kx < 0 || (_white ? _ky > 1 : _ky < 6)) { return 0; }
+    
+    int dir = (_white ? 1:-1);
+    float shield = 0;
+    for (int x = std::max(_kx-1, 0); x <= std::min(_kx+1, 7); x++)
+    {
+        if ((_pawns >> (8*(_ky+dir) + x)) & 1) { shield += 0.15; }
+        else if ((_pawns >> (8*(_ky+2*dir) + x)) & 1) { shield += 0.08; }
     }
-    else { std::cout << " ##### Error @ madeDoubleMove() #####\n"; return false; }
+    return shield;
 }
 
 void StateTree::evaluate(GameState* _gs)
 {
     float evaluation = 0;
+    uint64_t pawnKey = 0; // Zobrist key of the pawns alone, for pawnHash
+    int kingX[2] = {-1, -1};
+    int kingY[2] = {-1, -1};
+    int pieces = 0; // kings included, like countPieces()
     
     if (_gs->board[6][0] == PieceType::W_KING) { evaluation += 1.3; }
     if (_gs->board[6][7] == PieceType::W_KING) { evaluation -= 1.3; }
@@ -965,11 +1360,13 @@ void StateTree::evaluate(GameState* _gs)
         for (int x = 0; x < 8; x++)
         {
             PieceType piece = _gs->board[x][y];
+            if (piece != PieceType::EMPTY) { pieces++; }
             switch(piece)
             {
                 case (PieceType::W_PAWN):
                     evaluation += 1;
                     evaluation += 0.1*(y-1);
+                    pawnKey ^= zobristKeys[64*1 + 8*y + x];
                     
                     if ((x==3 || x==4) && y==1) { evaluation -= 0.2; }
                     break;
@@ -992,10 +1389,13 @@ void StateTree::evaluate(GameState* _gs)
                     break;
                 case (PieceType::W_KING):
                     evaluation += 100000;
+                    kingX[0] = x;
+                    kingY[0] = y;
                     break;
                 case (PieceType::B_PAWN):
                     evaluation -= 1;
                     evaluation += 0.1*(6-y);
+                    pawnKey ^= zobristKeys[64*0 + 8*y + x];
                     
                     if ((x==3 || x==4) && y==6) { evaluation += 0.2; }
                     break;
@@ -1018,6 +1418,8 @@ void StateTree::evaluate(GameState* _gs)
                     break;
                 case (PieceType::B_KING):
                     evaluation -= 100000;
+                    kingX[1] = x;
+                    kingY[1] = y;
                     break;
                 case (PieceType::EMPTY):
                     break;
@@ -1028,5 +1430,90 @@ void StateTree::evaluate(GameState* _gs)
         }
     }
     
+    // endings that material doesn't score, see Endgame.hpp
+    bool exact;
+    if (pieces <= ENDGAME_MAX_PIECES && kingX[0] != -1 && kingX[1] != -1 && endgameEvaluate(_gs, _gs->evaluation, exact)) { return; }
+    
+    if (pawnStructure)
+    {
+        bool hit;
+        PawnEntry &entry = pawnHash.probe(pawnKey, hit);
+        if (!hit)
+        {
+            evalPawnStructure(_gs, entry);
+            entry.key = pawnKey;
+        }
+        evaluation += entry.score;
+        evaluation += kingShield(entry.pawns[0], kingX[0], kingY[0], true) - kingShield(entry.pawns[1], kingX[1], kingY[1], false);
+        
+        // a blockaded passed pawn is only worth half, NOTE this depends on the pieces so it can't be cached
+        for (int color = 0; color < 2; color++)
+        {
+            int dir = (color == 0 ? 1:-1);
+            for (uint64_t passed = entry.passed[color]; passed != 0; passed &= passed-1)
+            {
+                int square = __builtin_ctzll(passed);
+                int x = square % 8;
+                int y = square / 8;
+                if (_gs->board[x][y+dir] != PieceType::EMPTY) { evaluation -= dir*0.5*PASSED_PAWN_BONUS[color == 0 ? y : 7-y]; }
+            }
+        }
+    }
+    
     _gs->evaluation = evaluation;
 }
+
+void StateTree::evalPawnStructure(const GameState* _gs, PawnEntry &_entry)
+{
+    _entry.pawns[0] = _entry.pawns[1] = 0;
+    _entry.passed[0] = _entry.passed[1] = 0;
+    int pawnsOnFile[2][8] = {};
+    for (int y = 1; y < 7; y++)
+    {
+        for (int x = 0; x < 8; x++)
+        {
+            int color = (_gs->board[x][y] == PieceType::W_PAWN ? 0 : (_gs->board[x][y] == PieceType::B_PAWN ? 1 : -1));
+            if (color == -1) { continue; }
+            _entry.pawns[color] |= 1ULL << (8*y + x);
+            pawnsOnFile[color][x]++;
+        }
+    }
+    
+    float score = 0;
+    for (int color = 0; color < 2; color++)
+    {
+        float sign = (color == 0 ? 1:-1);
+        int dir = (color == 0 ? 1:-1);
+        for (int x = 0; x < 8; x++)
+        {
+            // DOUBLED
+            if (pawnsOnFile[color][x] > 1) { score -= sign*0.2*(pawnsOnFile[color][x]-1); }
+        }
+        for (int y = 1; y < 7; y++)
+        {
+            for (int x = 0; x < 8; x++)
+            {
+                if (!((_entry.pawns[color] >> (8*y + x)) & 1)) { continue; }
+                
+                // ISOLATED - no friendly pawn on either neighbouring file
+                if ((x == 0 || pawnsOnFile[color][x-1] == 0) && (x == 7 || pawnsOnFile[color][x+1] == 0)) { score -= sign*0.15; }
+                
+                // PASSED - no enemy pawn in front of it on its own or a neighbouring file
+                bool passed = true;
+                for (int ahead = y+dir; passed && ahead >= 1 && ahead <= 6; ahead += dir)
+                {
+                    for (int file = std::max(x-1, 0); file <= std::min(x+1, 7); file++)
+                    {
+                        if ((_entry.pawns[1-color] >> (8*ahead + file)) & 1) { passed = false; }
+                    }
+                }
+                if (passed)
+                {
+                    _entry.passed[color] |= 1ULL << (8*y + x);
+                    score += sign*PASSED_PAWN_BONUS[color == 0 ? y : 7-y];
+                }
+            }
+        }
+    }
+    _entry.score = score;
+}
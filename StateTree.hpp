@@ -6,12 +6,71 @@
 #include <array>
 #include <vector>
 #include <memory>
+#include <cstdint>
+#include <chrono>
+
+#include "Book.hpp"
+#include "SearchStats.hpp"
+#include "SearchTrace.hpp"
+#include "Search.hpp"
+#include "PawnHash.hpp"
+#include "EvalCache.hpp"
+#include "TimeManager.hpp"
 
 const int COLOR_THRESHOLD = 90; // because all white PieceTypes are < 90 and black are > 90
 
+const int MAX_BRANCHING = 256; // upper bound on the children genLevel() can create for one GameState, used to keep the node budget a hard cap
+
 enum struct PieceType : int {EMPTY=45,W_PAWN=80,W_KNIGHT=78,W_BISHOP=66,W_ROOK=82,W_QUEEN=81,W_KING=75,B_PAWN=112,B_KNIGHT=110,B_BISHOP=98,B_ROOK=114,B_QUEEN=113,B_KING=107}; // NOTE values assigned as such so that they can be translated into corresponding chars to be printed // TODO Can int be made into byte for better performace?
 
+typedef std::array<std::array<PieceType,8>,8> BoardArray; // x by y
+
+/* A GameState's board, kept on the heap so that a GameState of the materialized tree can give it up and keep only the move that led to it
+ * (see StateTree::materialize()). Indexes, converts and copies like the BoardArray it holds so code that reads boards doesn't need to know.
+ *
+ * NOTE a new one always has its squares, only drop() (or copying a dropped one) takes them away
+*/
+class BoardHandle
+{
+public:
+    BoardHandle() : squares(new BoardArray) {}
+    
+    BoardHandle(const BoardHandle &_other) : squares(_other.squares ? new BoardArray(*_other.squares) : nullptr) {} // NOTE a copy of a dropped board is dropped too
+    
+    BoardHandle& operator=(const BoardHandle &_other)
+    {
+        if (!_other.squares) { squares.reset(); }
+        else if (!squares) { squares.reset(new BoardArray(*_other.squares)); }
+        else { *squares = *_other.squares; }
+        return *this;
+    }
+    
+    std::array<PieceType,8>& operator[](size_t _x) { return (*squares)[_x]; }
+    
+    const std::array<PieceType,8>& operator[](size_t _x) const { return (*squares)[_x]; }
+    
+    operator BoardArray&() { return *squares; }
+    
+    operator const BoardArray&() const { return *squares; }
+    
+    bool present() const { return squares != nullptr; } // false after drop() until a board is assigned again
+    
+    void drop() { squares.reset(); }
+
+private:
+    std::unique_ptr<BoardArray> squares;
+};
+
 struct GameState; // forward declaration so that the GameState struct can be referenced by GameState's definition
+enum struct GenStage : int {ALL, CAPTURES, QUIETS}; // what the move functions generate, captures include en passant and promotions, quiets include castling
+
+struct NnueAccumulator; // Nnue.hpp
+class NnueNetwork;
+struct NnueAccumulatorDeleter { void operator()(NnueAccumulator* _acc) const; }; // NOTE lets GameState hold one without the full definition
+struct MctsNode; // Mcts.hpp
+struct MctsNodeDeleter { void operator()(MctsNode* _node) const; };
+class TranspositionTable; // TranspositionTable.hpp
+class AnalysisCache; // AnalysisCache.hpp
 struct GameState // TODO Can this be made a private member of StateTree?
 {
     // tree properties
@@ -20,6 +79,7 @@ struct GameState // TODO Can this be made a private member of StateTree?
     
     // gamestate properties
     float evaluation;
+    bool resolved; // evaluation is exact (tablebase hit or draw), the GameState is never expanded or re-evaluated
     bool whiteTurn; // true if white's turn, false when black's turn
 //     bool inCheck; // if the capture of the king is in any of the next gamestates then this is true
     bool inCheck_W;
@@ -30,11 +90,25 @@ struct GameState // TODO Can this be made a private member of StateTree?
     bool queensideRookMoved_B; // black
     bool castled_W;
     bool castled_B;
-    std::array<std::array<PieceType,8>,8> board; // x by y ATTENTION - Iterate through y first when iterating through matrix
+    int doubleMoveFile; // file of the pawn that double-moved to reach this GameState, -1 otherwise (en passant)
+    int halfmoveClock; // plies since the last capture or pawn move
+    int fullmoveNumber; // starts at 1 and goes up after each of black's moves
+    std::int8_t fromX, fromY, toX, toY; // the move from parent that led here (castling is the king's move), -1 for the initial GameState and null moves
+    PieceType captured; // piece taken by that move (the pawn for en passant), EMPTY otherwise
+    BoardHandle board; // x by y ATTENTION - Iterate through y first when iterating through matrix, NOTE may be dropped in the materialized tree, see StateTree::materialize()
+    uint64_t positionKey; // zobristKey(), set by genChildren() once the GameState is complete, compared to find repetitions
+    uint64_t boardKey; // zobristBoardKey() of board, addChild() updates it from the parent's so anything that changes board afterwards has to update it too
+    std::unique_ptr<NnueAccumulator, NnueAccumulatorDeleter> accumulator; // only kept by GameStates with children while the NNUE evaluates, see StateTree::nnueAccumulator()
+    std::unique_ptr<MctsNode, MctsNodeDeleter> mcts; // visits and score while searchMcts() has the GameState in its tree, nullptr otherwise
     
     GameState(GameState* _parent)
     {
         parent = _parent;
+        resolved = false;
+        fromX = fromY = toX = toY = -1; // NOTE addChild() fills these in
+        captured = PieceType::EMPTY;
+        boardKey = (_parent != nullptr ? _parent->boardKey : 0); // NOTE a GameState without a parent gets its keys once its board is set up
+        positionKey = 0;
         // castling assumed not possible, evaluateCastleAbility() will change this if necessary
         if (_parent != nullptr) {
             whiteTurn = !_parent->whiteTurn;
@@ -46,6 +120,9 @@ struct GameState // TODO Can this be made a private member of StateTree?
             queensideRookMoved_B = _parent->queensideRookMoved_B;
             inCheck_W = false; // NOTE this is later changed by children
             inCheck_B = false;
+            doubleMoveFile = -1; // NOTE pawnMove() sets this, addChild() resets halfmoveClock
+            halfmoveClock = _parent->halfmoveClock + 1;
+            fullmoveNumber = _parent->fullmoveNumber + (whiteTurn ? 1:0);
             if (whiteTurn) { evaluation = -10000; }
             else if (!whiteTurn) { evaluation = 10000; }
             else { std::cout << " ##### ERROR in GameState() constructor ##### \n"; }
@@ -61,10 +138,32 @@ struct GameState // TODO Can this be made a private member of StateTree?
             castled_B = false;
             inCheck_W = false;
             inCheck_B = false;
+            doubleMoveFile = -1;
+            halfmoveClock = 0;
+            fullmoveNumber = 1;
         } // if parent is null then the GameState is the initial GameState
     }
 };
 
+bool squareAttacked(const GameState* _gs, int _x, int _y, bool _byWhite); // true if a piece of the given color attacks (_x,_y)
+
+bool squareAttacked(const std::array<std::array<PieceType,8>,8> &_board, int _x, int _y, bool _byWhite); // the same on a bare board, e.g. one a move was tried out on
+
+bool kingAttacked(const GameState* _gs, bool _white); // true if the king of the given color is attacked, false if it has no king
+
+int enPassantFile(const GameState* _gs); // doubleMoveFile if a pawn of the side to move stands next to that pawn, -1 otherwise
+
+bool insufficientMaterial(const GameState* _gs); // neither side can mate: kings alone, a single minor piece or bishops all on squares of one color
+
+int repetitions(const GameState* _gs); // earlier GameStates along parent with the same positionKey, since the last capture or pawn move and never past a null move
+
+/* Draw detection, a drawn GameState is scored 0 and never expanded
+ *
+ * The parents of a GameState are the game so far (pastStates) followed by the path the search took, so walking them back is the position history.
+ * In a search a single repetition is already a draw, whoever could avoid it would have done so the first time round.
+*/
+bool drawn(const GameState* _gs, bool _parentInsufficient); // fifty-move rule, repetition or insufficient material, _parentInsufficient saves the material scan after a quiet move
+
 /* ATTENTION - Methods of StateTree must be called in the correct order
  * 
  * NOTE For Computer Moves:
@@ -82,10 +181,25 @@ class StateTree
 public:
     StateTree();
     
+    bool loadFEN(const std::string &_fen); // discards the game so far and starts over from _fen, returns false (and changes nothing) if _fen can't be parsed
+    
     void printCurrent(); // prints the board and info of the current state
     
     void printBoard(GameState* _gs); // prints the board and info of the current state
     
+    // ---------- MEMORY BUDGET ----------
+    // genLevel() stops expanding once the tree would grow past the budget, the partially expanded tree is still searched as normal
+    
+    void setNodeBudget(long _nodes); // caps the number of live GameStates, 0 means unlimited
+    
+    void setMemoryBudgetMB(long _megabytes); // same as setNodeBudget() but in megabytes, converted with bytesPerNode()
+    
+    long bytesPerNode(); // approximate heap cost of one GameState in the tree (the node, its owning pointer, allocator overhead and its share of the boards), NOTE depends on searchOptions
+    
+    long liveNodes; // GameStates currently held by the tree, recounted at the start of every genLevel()
+    long nodeBudget; // 0 means unlimited
+    bool budgetReached; // true if the last genLevel() had to stop expanding because of the budget or a failed allocation
+    
 // private:
     std::vector<std::unique_ptr<GameState>> pastStates; // NOTE pastStates.back() will be the most current state which a tree will get branched off of
     std::vector<GameState*> deepestLevel; // points to the GameStates in the deepest level
@@ -93,11 +207,35 @@ public:
     
     void regenDeepestLevel(GameState* _gs);
     
+    // ---------- CHECKPOINTS ----------
+    // with searchOptions.checkpointInterval above 1 genLevel() drops the boards of the GameStates two or more plies below the current state, leaves and
+    // all, and only the checkpoints get theirs back for good once they have children. The rest only keep the move from their parent (and what it captured)
+    // and get their board back by replaying at most checkpointInterval moves from the nearest GameState that still has one, so the materialized tree
+    // needs a fraction of the memory per GameState
+    
+    bool checkpoint(const GameState* _gs); // _gs keeps its board while it has children, every checkpointInterval-th ply counted from the start of the game
+    
+    bool materialize(GameState* _gs); // gives _gs its board back if it was dropped, returns true if it did so the caller can drop it again once it's done with it
+    
     void genLevel(); // generates possible GameStates off of the current and then, if called again, generates possible GameStates off of the lowest level's GameStates, creating a tree
     
     void genLevels(int _levels); // calls genLevel() "_levels" times
     
-    void minimaxEval(GameState* _gs); // (recursive) performs a minimax evaluation on the tree which will be used to select the next move, each GameState that isn't the lowest level gets a relative evaluation passed to it as deemed by the minimax algorithm
+    void genToDepth(int _levels); // calls genLevel() until the tree under the current state is "_levels" deep
+    
+    void genForSeconds(double _seconds); // calls genLevel() while the next level is expected to finish within _seconds of the call (at least one level, none past the budget), NOTE each level is taken to grow by as much as the last one did
+    
+    int subtreeDepth(GameState* _gs); // (recursive) number of levels below _gs
+    
+    void minimaxEval(GameState* _gs); // performs a minimax evaluation on the tree which will be used to select the next move, each GameState that isn't the lowest level gets a relative evaluation passed to it as deemed by the minimax algorithm, NOTE also fills in principalVariation
+    
+    void minimaxBackup(GameState* _gs); // (recursive) the minimax pass itself, minimaxEval() wraps it so it can be timed as one phase
+    
+    int bestChildIndex(GameState* _gs); // index of _gs's best child after minimaxEval(), -1 if _gs has no children
+    
+    bool childMove(GameState* _gs, GameState* _child, int &_x1, int &_y1, int &_x2, int &_y2); // the move from _gs to its child _child, castling comes out as the king's move, false for a null move
+    
+    void pushState(int _index); // makes the current state's child at _index the new current state, keeping its subtree and dropping its siblings
     
     void pushComputerState(); // push the next state onto pastStates as deemed by the minimax algorithm, NOTE This should also delete all of the other GameStates that are no longer relevent AKA the other GameStates in the level of the state that is getting pushed. // ATTENTION Can I push a GameState onto pastStates efficiently? A GameState will typically have a tree under it, will all of that memory be inefficiently reallocated?
     
@@ -105,6 +243,120 @@ public:
     
     void pushMove(int _x1, int _y1, int _x2, int _y2);
     
+    int findChild(GameState* _gs, int _x1, int _y1, int _x2, int _y2); // index in _gs->nextLevel of the child where the piece on (_x1,_y1) went to (_x2,_y2), -1 if there is none
+    
+    // ---------- OPENING BOOK ----------
+    OpeningBook book; // consulted by pushComputerState() before any search, closed by default
+    
+    bool inBook(); // true if the book has a move for the current state, in which case only one level needs generating before pushComputerState()
+    
+    bool probeBook(BookMove &_move); // looks the current state up in the book and translates Polyglot's castling encoding to the king's destination
+    
+    // ---------- TABLEBASES ----------
+    // once tbInit() has loaded tables, genLevel() resolves small enough GameStates with a WDL probe instead of expanding them and pushComputerState() plays the root move straight from the tables
+    
+    long tbHits; // GameStates resolved by a tablebase probe instead of a subtree
+    
+    // ---------- ENDGAMES ----------
+    // evaluate() scores the endings of Endgame.hpp's registry with their own evaluators, and the searches resolve the ones with a known result (KPK, bare kings) the way they do a tablebase hit
+    
+    long endgameHits; // GameStates resolved by a known endgame result instead of a subtree
+    int endgamePly; // plies below the current state before the depth-first search can meet a registered ending, set by startDepthFirst()
+    
+    // ---------- STATS ----------
+    SearchStats stats; // only filled in when built with SEARCH_STATS, see SearchStats.hpp
+    
+    int plyOf(GameState* _gs); // how many moves _gs is below the current state
+    
+    SearchTrace* trace; // nullptr unless tracing, NOTE not owned so one trace file can follow many trees one after another
+    
+    void traceSearch(GameState* _root, int _bestIndex); // writes the root move and search records for a finished minimaxEval() of _root
+    
+    long subtreeSize(GameState* _gs); // (recursive) _gs and every GameState below it
+    
+    // ---------- DEPTH-FIRST SEARCH ----------
+    // instead of materializing whole levels, searchDepthFirst() generates the children of one GameState at a time and frees them again once they are searched, so memory grows with depth and not with the size of the tree
+    
+    SearchOptions searchOptions; // pushComputerState() uses searchDepthFirst() when searchOptions.depthFirst is set
+    
+    long searchNodes; // GameStates visited by the last searchDepthFirst(), quiescence included
+    std::vector<SearchIteration> iterations; // one per depth completed by the last searchDepthFirst()
+    
+    std::vector<Move> principalVariation; // expected line from the current state found by the last search, tree or depth-first
+    
+    std::vector<SearchLine> multiPVLines; // the best searchOptions.multiPV moves of the last tree or depth-first search and their lines, best first, NOTE only filled in when multiPV is above 1
+    
+    std::array<std::array<Move,MAX_SEARCH_PLY>,MAX_SEARCH_PLY> pvTable; // triangular, row n holds the best line from ply n of the node being searched there
+    std::array<int,MAX_SEARCH_PLY> pvLength; // row n of pvTable ends before this index
+    bool followPV; // true while the search is still walking the last depth's PV, whose moves are then tried first
+    std::array<std::array<Move,KILLER_MOVES>,MAX_SEARCH_PLY> killers; // latest quiet moves that cut off at each ply, newest first
+    
+    int searchDepthFirst(int _depth); // iterative deepening alpha-beta from the current state, returns the index of its best child (-1 if it has none), NOTE leaves exactly one level under the current state with each child's score as its evaluation
+    
+    bool startDepthFirst(); // the first half of searchDepthFirst(), resets the counters and orders the current state's children, false if it has none
+    
+    bool deepenDepthFirst(int _depth); // the second half, searches the next depth and returns false once there is none to search (_depth reached, a forced king capture, the TimeManager or an abandoned depth), NOTE lets a caller interleave several searches a depth (or a slice, see sliceNodes) at a time
+    
+    std::chrono::steady_clock::time_point depthFirstStart; // iterations time from here
+    
+    TranspositionTable* tt; // nullptr searches without one, NOTE not owned so StateTrees on any number of threads can share one
+    int ttSession; // tag of this tree's entries in tt, 0 without a session
+    long ttProbes; // by the last searchDepthFirst()
+    long ttHits;
+    
+    AnalysisCache* analysisCache; // nullptr without one, otherwise every depth the search completes is stored and a deep enough result from an earlier search (or run) is played without searching, NOTE not owned
+    
+    bool answerFromCache(int _depth); // sets the current state's children, principalVariation and iterations from analysisCache's result for it if that's at least _depth deep, false otherwise
+    
+    TimeManager* timeManager; // nullptr searches every depth up to _depth, otherwise searchDepthFirst() stops deepening when it says so and abandons a depth at its hard limit
+    bool searchAborted; // the hard limit was reached, the search unwinds without scoring anything
+    
+    long sliceNodes; // 0 searches every depth through, otherwise deepenDepthFirst() abandons its depth (searchAborted) after this many nodes and sets sliceExpired
+    bool sliceExpired; // the next deepenDepthFirst() searches the abandoned depth again, NOTE lets a caller take turns between searches in the middle of a depth (see Server.cpp)
+    long sliceEnd; // searchNodes at which the running depth's slice runs out
+    
+    int legalMoveCount(GameState* _gs); // children of _gs that don't leave the mover's king attacked
+    
+    TimeControl clock; // the computer's clock, pushComputerState() searches with a TimeManager while it's running and charges the move to it
+    
+    float searchRoot(GameState* _root, int _depth, float _alpha, float _beta); // one pass of searchDepthFirst() over the current state's children, sets their evaluations and returns the best
+    
+    float searchRootMultiPV(GameState* _root, int _depth); // searchRoot() for searchOptions.multiPV lines, a move only needs an exact score while it can still make the best lines so the rest are scouted against the worst of them, fills in multiPVLines
+    
+    float searchChild(GameState* _gs, GameState* _child, int _depth, int _reduction, bool _scout, float _alpha, float _beta, int _ply); // alphaBeta() of _child, with _scout or a _reduction it's tried with a null window first and only searched properly if it beats the best move so far
+    
+    float alphaBeta(GameState* _gs, int _depth, float _alpha, float _beta, int _ply, bool _nullAllowed); // (recursive) white-relative score of _gs, fail-soft so outside (_alpha,_beta) it's only a bound
+    
+    float quiescence(GameState* _gs, float _alpha, float _beta, int _ply, int _qPly); // (recursive) alphaBeta() past the horizon, only captures and promotions are searched
+    
+    float staticEval(GameState* _gs); // evaluate() as a return value, counted in stats
+    
+    void genChildren(GameState* _gs, GenStage _stage = GenStage::ALL, uint64_t _skipSquares = 0); // adds the children of _gs the stage asks for, leaving out the moves of pieces on _skipSquares (bit 8*y+x), NOTE no budget or tablebase checks, genLevel() does those
+    
+    void genPieceChildren(GameState* _gs, int _x, int _y); // adds the children of the piece on (_x,_y) that genStage asks for, NOTE finishChildren() has to follow
+    
+    void finishChildren(GameState* _gs, int _first); // keys the children from _first on and scores the drawn ones, once nothing changes them anymore
+    
+    void updatePV(int _ply, const GameState* _child); // _child is the new best move at _ply, its line becomes row _ply of pvTable
+    
+    bool pvFirst(GameState* _gs, int _ply); // moves principalVariation's move at _ply to the front of _gs's children, false if it isn't one of them
+    
+    int orderChildren(GameState* _gs, int _first = 0); // orders the children from _first on, captures and promotions first (most valuable victim, least valuable attacker), then quiet moves in generation order, then captures losing material (searchOptions.see), returns how many come before the quiet moves
+    
+    bool genHashMove(GameState* _gs, uint16_t _move); // adds the child for _move (see ttMove()) and nothing else, false if it isn't a move of _gs (a key collision)
+    
+    void genKillers(GameState* _gs, int _ply, uint64_t &_generated, std::vector<std::unique_ptr<GameState>> &_later); // adds the killers at _ply that are quiet moves of _gs, the other quiet moves of their pieces go to _later and the pieces' squares to _generated
+    
+    void storeKiller(int _ply, const GameState* _child);
+    
+    // ---------- MONTE CARLO TREE SEARCH ----------
+    // searchMcts() grows the tree under the current state one playout at a time and keeps it, so the part below the move that gets played is reused by the next search
+    
+    long mctsPlayouts; // playouts of the last searchMcts()
+    double mctsMs;
+    
+    int searchMcts(long _playouts, double _seconds); // searchOptions.mctsThreads threads play out until _playouts or _seconds (0 for no limit) run out, returns the index of the most visited child (-1 if there is none), NOTE sets the children's evaluations and principalVariation
+    
     // ---------- MOVE FUNCTIONS ----------
     // these are passed the location of their respective piece and they generate all possible GameStates that the piece can cause and adds them as children to the parent GameState
     
@@ -121,11 +373,15 @@ public:
     void kingMove(GameState* _parentGS, int _x, int _y);
     
     // ----- Helpers
-    void evalCastleAbility(GameState* _gs); // changes _gs's castling bool's based on evaluation of castling ability NOTE 0 is false, 1 is queenside, 2 is kingsside, if 3 then both
+    GenStage genStage; // ALL except while genChildren() generates a single stage
+    
+    GameState* addChild(GameState* _parentGS, int _x1, int _y1, int _x2, int _y2); // adds the child where the piece on (_x1,_y1) went to (_x2,_y2) and returns it for any finishing touches, records the move and capture, resets halfmoveClock and promotes pawns
+    
+    void evalCastleAbility(GameState* _gs); // adds the castling children of the side to move
     
     void evalCheckStatus(GameState* _gs); // change's _gs's inCheck bool based on evaluation of board
     
-    void evalPawnPromotions(GameState* _gs); // change's _gs's inCheck bool based on evaluation of board
+    void evalPawnPromotions(GameState* _gs); // turns pawns of the side to move that stand on the last rank into queens, NOTE addChild() already promotes so only a hand-made board can need this
     
     void processStateGen(GameState* _parentGS, int _m1, int _n1, int _m2, int _n2);
     
@@ -134,6 +390,24 @@ public:
     bool madeDoubleMove(GameState* _gs, int _x, int _y); // determines whether the piece at a given position double-moved or not
     
     void evaluate(GameState* _gs); // evalutes a GameState, this part is the main factor in determining how the engine plays
+    
+    EvalCache evalCache; // evaluations by boardKey, NOTE clear it after changing anything evaluate() depends on (pawnStructure)
+    
+    void cachedEvaluate(GameState* _gs); // evaluate() (or evaluateNnue()) unless evalCache already holds the evaluation of _gs's board
+    
+    // ----- Neural network evaluation
+    const NnueNetwork* nnue; // evaluates instead of evaluate() when not nullptr, NOTE clear evalCache after switching
+    
+    void evaluateNnue(GameState* _gs); // falls back on evaluate() once a king has been captured
+    
+    const NnueAccumulator& nnueAccumulator(GameState* _gs, NnueAccumulator &_scratch); // updated from the parent's (refreshed for a root), GameStates with children keep theirs and the rest get _scratch
+    
+    // ----- Pawn structure
+    bool pawnStructure; // evaluate() adds doubled/isolated/passed pawn terms and king shields, false leaves the plain material and advancement sum (kept to benchmark against)
+    
+    PawnHashTable pawnHash; // caches evalPawnStructure() for evaluate()
+    
+    void evalPawnStructure(const GameState* _gs, PawnEntry &_entry); // fills in everything but the key
 };
 
 #endif
@@ -0,0 +1,152 @@
+#include <string>
+#include <cstdint>
+
+#include "Tablebase.hpp"
+
+#ifdef USE_SYZYGY
+extern "C" {
+#include "tbprobe.h"
+}
+#endif
+
+int countPieces(const GameState* _gs)
+{
+    int pieces = 0;
+    for (int y = 0; y < 8; y++)
+    {
+        for (int x = 0; x < 8; x++)
+        {
+            if (_gs->board[x][y] != PieceType::EMPTY) { pieces++; }
+        }
+    }
+    return pieces;
+}
+
+#ifdef USE_SYZYGY
+
+// ---------- FATHOM BACKEND ----------
+
+struct TbPosition
+{
+    uint64_t white, black, kings, queens, rooks, bishops, knights, pawns;
+    unsigned ep; // en passant target square, 0 if none
+    bool turn; // true if white to move
+};
+
+static bool hasCastlingRights(const GameState* _gs)
+{
+    bool white = (_gs->board[4][0] == PieceType::W_KING && !_gs->castled_W && ((!_gs->kingsideRookMoved_W && _gs->board[7][0] == PieceType::W_ROOK) || (!_gs->queensideRookMoved_W && _gs->board[0][0] == PieceType::W_ROOK)));
+    bool black = (_gs->board[4][7] == PieceType::B_KING && !_gs->castled_B && ((!_gs->kingsideRookMoved_B && _gs->board[7][7] == PieceType::B_ROOK) || (!_gs->queensideRookMoved_B && _gs->board[0][7] == PieceType::B_ROOK)));
+    return white || black;
+}
+
+static void toTbPosition(const GameState* _gs, TbPosition &_pos)
+{
+    _pos = TbPosition{0,0,0,0,0,0,0,0,0,_gs->whiteTurn};
+    for (int y = 0; y < 8; y++)
+    {
+        for (int x = 0; x < 8; x++)
+        {
+            PieceType piece = _gs->board[x][y];
+            if (piece == PieceType::EMPTY) { continue; }
+            uint64_t bit = 1ULL << (8*y + x); // NOTE Fathom squares are a1=0, b1=1 ... h8=63
+            if ((int)piece < COLOR_THRESHOLD) { _pos.white |= bit; }
+            else { _pos.black |= bit; }
+            switch(piece)
+            {
+                case (PieceType::W_KING): case (PieceType::B_KING): _pos.kings |= bit; break;
+                case (PieceType::W_QUEEN): case (PieceType::B_QUEEN): _pos.queens |= bit; break;
+                case (PieceType::W_ROOK): case (PieceType::B_ROOK): _pos.rooks |= bit; break;
+                case (PieceType::W_BISHOP): case (PieceType::B_BISHOP): _pos.bishops |= bit; break;
+                case (PieceType::W_KNIGHT): case (PieceType::B_KNIGHT): _pos.knights |= bit; break;
+                case (PieceType::W_PAWN): case (PieceType::B_PAWN): _pos.pawns |= bit; break;
+                default: break;
+            }
+        }
+    }
+    int epFile = enPassantFile(_gs);
+    if (epFile != -1) { _pos.ep = 8*(_gs->whiteTurn ? 5:2) + epFile; }
+}
+
+// converts a WDL result for the side to move into a white-relative evaluation, cursed wins and blessed losses are draws under the fifty-move rule
+static float wdlToEvaluation(unsigned _wdl, bool _whiteTurn)
+{
+    float evaluation = 0;
+    if (_wdl == TB_WIN) { evaluation = TB_WIN_EVALUATION; }
+    else if (_wdl == TB_LOSS) { evaluation = -TB_WIN_EVALUATION; }
+    return (_whiteTurn ? evaluation : -evaluation);
+}
+
+bool tbInit(const std::string &_path)
+{
+    return tb_init(_path.c_str()) && TB_LARGEST > 0;
+}
+
+void tbFree()
+{
+    tb_free();
+}
+
+int tbLargest()
+{
+    return (int)TB_LARGEST;
+}
+
+bool tbProbeWDL(const GameState* _gs, float &_evaluation)
+{
+    if (countPieces(_gs) > (int)TB_LARGEST || hasCastlingRights(_gs)) { return false; }
+    
+    TbPosition pos;
+    toTbPosition(_gs, pos);
+    unsigned wdl = tb_probe_wdl(pos.white, pos.black, pos.kings, pos.queens, pos.rooks, pos.bishops, pos.knights, pos.pawns, 0, 0, pos.ep, pos.turn);
+    if (wdl == TB_RESULT_FAILED) { return false; }
+    
+    _evaluation = wdlToEvaluation(wdl, _gs->whiteTurn);
+    return true;
+}
+
+bool tbProbeRoot(const GameState* _gs, int &_x1, int &_y1, int &_x2, int &_y2, float &_evaluation)
+{
+    if (countPieces(_gs) > (int)TB_LARGEST || hasCastlingRights(_gs)) { return false; }
+    
+    TbPosition pos;
+    toTbPosition(_gs, pos);
+    unsigned result = tb_probe_root(pos.white, pos.black, pos.kings, pos.queens, pos.rooks, pos.bishops, pos.knights, pos.pawns, 0, 0, pos.ep, pos.turn, nullptr);
+    if (result == TB_RESULT_FAILED || result == TB_RESULT_CHECKMATE || result == TB_RESULT_STALEMATE) { return false; }
+    
+    _x1 = TB_GET_FROM(result) % 8;
+    _y1 = TB_GET_FROM(result) / 8;
+    _x2 = TB_GET_TO(result) % 8;
+    _y2 = TB_GET_TO(result) / 8;
+    _evaluation = wdlToEvaluation(TB_GET_WDL(result), _gs->whiteTurn);
+    return true;
+}
+
+#else
+
+// ---------- NO BACKEND ----------
+
+bool tbInit(const std::string &_path)
+{
+    std::cout << "Built without Syzygy support, rebuild with make SYZYGY=/path/to/fathom/src\n";
+    return false;
+}
+
+void tbFree() {}
+
+int tbLargest()
+{
+    return 0;
+}
+
+bool tbProbeWDL(const GameState* _gs, float &_evaluation)
+{
+    return false;
+}
+
+bool tbProbeRoot(const GameState* _gs, int &_x1, int &_y1, int &_x2, int &_y2, float &_evaluation)
+{
+    return false;
+}
+
+#endif
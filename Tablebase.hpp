@@ -0,0 +1,30 @@
+#ifndef TABLEBASE_HPP
+#define TABLEBASE_HPP
+
+#include <string>
+
+#include "StateTree.hpp"
+
+/* Syzygy endgame tablebase probing
+ * 
+ * NOTE Decoding is done by Fathom (tbprobe.c), which memory-maps the .rtbw/.rtbz files itself. Build with "make SYZYGY=/path/to/fathom/src" to enable it,
+ * otherwise tbInit() always fails and tbLargest() stays 0 so none of the probes below are ever reached.
+ * 
+ * Positions with castling rights can't be in a tablebase and are never probed.
+*/
+
+const float TB_WIN_EVALUATION = 20000; // below the 100000 of a captured king and the 50000 game-over threshold in Main, above any material evaluation
+
+bool tbInit(const std::string &_path); // loads every table found in _path (separate directories with ':' or ';'), returns false if none were found
+
+void tbFree();
+
+int tbLargest(); // most pieces (kings included) of any loaded table, 0 if none
+
+bool tbProbeWDL(const GameState* _gs, float &_evaluation); // white-relative evaluation of _gs (TB_WIN_EVALUATION, 0 or -TB_WIN_EVALUATION), false if _gs can't be probed
+
+bool tbProbeRoot(const GameState* _gs, int &_x1, int &_y1, int &_x2, int &_y2, float &_evaluation); // move that keeps the best WDL result and makes the fastest DTZ progress, false if _gs can't be probed
+
+int countPieces(const GameState* _gs);
+
+#endif
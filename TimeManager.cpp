@@ -0,0 +1,86 @@
+#include <string>
+#include <chrono>
+#include <algorithm>
+
+#include "TimeManager.hpp"
+
+void TimeControl::set(double _base, double _increment, int _movesPerPeriod)
+{
+    base = _base;
+    increment = _increment;
+    movesPerPeriod = _movesPerPeriod;
+    remaining = _base;
+    movesToGo = _movesPerPeriod;
+}
+
+void TimeControl::moveMade(double _seconds)
+{
+    remaining -= _seconds;
+    if (remaining < 0) { return; } // NOTE flag fell, no increment saves it
+    remaining += increment;
+    if (movesPerPeriod > 0 && --movesToGo == 0)
+    {
+        remaining += base;
+        movesToGo = movesPerPeriod;
+    }
+}
+
+bool TimeControl::running() const
+{
+    return (base > 0);
+}
+
+TimeManager::TimeManager()
+{
+    softLimit = 0;
+    hardLimit = 0;
+    scale = 1;
+    lastScore = 0;
+    depths = 0;
+    stableDepths = 0;
+    dropped = false;
+    startTime = std::chrono::steady_clock::now();
+}
+
+void TimeManager::start(const TimeControl &_clock, int _legalMoves)
+{
+    startTime = std::chrono::steady_clock::now();
+    lastBestMove.clear();
+    lastScore = 0;
+    depths = 0;
+    stableDepths = 0;
+    dropped = false;
+    scale = 1;
+    
+    double available = std::max(_clock.remaining - TIME_SAFETY_MARGIN, 0.0);
+    int moves = (_clock.movesToGo > 0 ? std::min(_clock.movesToGo, TIME_MOVES_EXPECTED) : TIME_MOVES_EXPECTED);
+    softLimit = available/moves + TIME_INCREMENT_SHARE*_clock.increment;
+    hardLimit = std::min(TIME_HARD_MULTIPLE*softLimit, (_clock.movesToGo == 1 ? available : TIME_HARD_SHARE*available));
+    softLimit = std::min(softLimit, hardLimit);
+    if (_legalMoves <= 1) { softLimit = 0; } // NOTE the search still finishes its first depth, it has to return a move
+}
+
+double TimeManager::elapsed() const
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+bool TimeManager::hardLimitReached() const
+{
+    return (elapsed() >= hardLimit);
+}
+
+bool TimeManager::nextDepth(const std::string &_bestMove, float _evaluation, bool _whiteTurn)
+{
+    float score = (_whiteTurn ? _evaluation : -_evaluation);
+    stableDepths = (_bestMove == lastBestMove ? stableDepths+1 : 0);
+    if (depths > 0 && score < lastScore - TIME_SCORE_DROP) { dropped = true; } // NOTE for the rest of the move, one good depth doesn't mean the trouble is over
+    lastBestMove = _bestMove;
+    lastScore = score;
+    depths++;
+    
+    scale = 1;
+    if (stableDepths >= TIME_STABLE_DEPTHS) { scale *= TIME_STABLE_SCALE; }
+    if (dropped) { scale *= TIME_DROP_SCALE; }
+    return (elapsed() < TIME_NEXT_DEPTH_SHARE * std::min(scale*softLimit, hardLimit));
+}
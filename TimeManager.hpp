@@ -0,0 +1,75 @@
+#ifndef TIMEMANAGER_HPP
+#define TIMEMANAGER_HPP
+
+#include <string>
+#include <chrono>
+
+/* Time management for a game played on a clock
+ *
+ * Each move gets a soft limit, its share of the time left (the remaining time over the moves still to go, plus most of the increment), and a hard limit
+ * a few times larger but never more than a fraction of the clock. The depth-first search deepens until the soft limit says the next depth won't fit and
+ * abandons a depth that runs into the hard limit, playing the best move of the last complete one. The other searches just use the soft limit.
+ *
+ * The soft limit moves with the search:
+ * - a best move that has stayed the same for a few depths is unlikely to change, so it's played early
+ * - a score that drops from one depth to the next means trouble was found, so the search gets longer to find a way out
+ * - with only one legal move there's nothing to think about
+*/
+
+const double TIME_SAFETY_MARGIN = 0.05; // seconds kept back for everything around the search
+const int TIME_MOVES_EXPECTED = 30; // moves still to go when the time control doesn't say
+const double TIME_INCREMENT_SHARE = 0.75; // of the increment spent on each move
+const double TIME_HARD_MULTIPLE = 4; // hard limit over soft limit
+const double TIME_HARD_SHARE = 0.3; // of the clock the hard limit may use, all of it on the last move before the time control
+const double TIME_NEXT_DEPTH_SHARE = 0.5; // a new depth is only started this far into the soft limit, each takes several times as long as the last
+const int TIME_STABLE_DEPTHS = 3; // depths the best move must stay the same for before the search stops early
+const double TIME_STABLE_SCALE = 0.5;
+const float TIME_SCORE_DROP = 0.3; // pawns lost from one depth to the next that count as trouble
+const double TIME_DROP_SCALE = 2;
+const int TIME_MAX_DEPTH = 32; // depth-first searches on a clock go this deep at most
+
+struct TimeControl
+{
+    double base; // seconds for each period, 0 means no clock
+    double increment; // seconds added after every move
+    int movesPerPeriod; // moves until the clock is topped up with base again, 0 for the rest of the game
+    
+    double remaining; // seconds on the clock
+    int movesToGo; // moves left in this period, 0 if movesPerPeriod is
+    
+    TimeControl() { set(0, 0, 0); }
+    
+    void set(double _base, double _increment, int _movesPerPeriod); // starts a fresh clock
+    
+    void moveMade(double _seconds); // charges a move to the clock, remaining goes negative when the flag falls
+    
+    bool running() const; // true once set() gave the clock some time
+};
+
+class TimeManager
+{
+public:
+    TimeManager();
+    
+    void start(const TimeControl &_clock, int _legalMoves); // limits for the move about to be searched, timed from now
+    
+    double elapsed() const; // seconds since start()
+    
+    bool hardLimitReached() const;
+    
+    bool nextDepth(const std::string &_bestMove, float _evaluation, bool _whiteTurn); // called after each complete depth with its result, false when the search should stop
+    
+    double softLimit; // seconds, before the stability and score scaling
+    double hardLimit;
+    double scale; // current adjustment of softLimit
+
+private:
+    std::chrono::steady_clock::time_point startTime;
+    std::string lastBestMove;
+    float lastScore; // for the side to move
+    int depths;
+    int stableDepths;
+    bool dropped; // the score fell by TIME_SCORE_DROP at some depth of this move
+};
+
+#endif
@@ -0,0 +1,134 @@
+#include <string>
+#include <cmath>
+#include <iostream>
+
+#include "TimeManager.hpp"
+
+/*
+ * timetest - checks TimeManager's limits for a move and how nextDepth() scales them, and TimeControl's bookkeeping
+ *
+ * Usage: make test
+ *
+ * Prints every case that fails and exits with 1 if there were any, only nextDepth()'s answer depends on the time actually taken
+ */
+
+struct LimitCase
+{
+    double base, increment;
+    int movesPerPeriod;
+    double remaining; // seconds left when the move starts
+    int movesToGo;
+    int legalMoves;
+    double soft, hard; // expected
+};
+
+const double AVAILABLE = 60 - TIME_SAFETY_MARGIN;
+
+const LimitCase LIMIT_CASES[] = {
+    {60, 0, 0, 60, 0, 20, AVAILABLE/TIME_MOVES_EXPECTED, TIME_HARD_MULTIPLE*AVAILABLE/TIME_MOVES_EXPECTED}, // sudden death, the expected number of moves
+    {60, 2, 0, 60, 0, 20, AVAILABLE/TIME_MOVES_EXPECTED + TIME_INCREMENT_SHARE*2, TIME_HARD_MULTIPLE*(AVAILABLE/TIME_MOVES_EXPECTED + TIME_INCREMENT_SHARE*2)},
+    {60, 0, 40, 60, 10, 20, AVAILABLE/10, TIME_HARD_SHARE*AVAILABLE}, // hard limit capped at its share of the clock
+    {60, 0, 40, 60, 1, 20, AVAILABLE, AVAILABLE}, // the last move before the time control may use everything
+    {60, 0, 0, 60, 0, 1, 0, TIME_HARD_MULTIPLE*AVAILABLE/TIME_MOVES_EXPECTED}, // one legal move, nothing to think about
+    {60, 0, 0, 0.01, 0, 20, 0, 0}, // less than the safety margin left
+};
+
+static bool near(double _a, double _b)
+{
+    return std::fabs(_a - _b) < 1e-9;
+}
+
+int main()
+{
+    int failures = 0;
+    int total = 0;
+    
+    for (const LimitCase &test : LIMIT_CASES)
+    {
+        total++;
+        TimeControl clock;
+        clock.set(test.base, test.increment, test.movesPerPeriod);
+        clock.remaining = test.remaining;
+        clock.movesToGo = test.movesToGo;
+        TimeManager manager;
+        manager.start(clock, test.legalMoves);
+        if (!near(manager.softLimit, test.soft) || !near(manager.hardLimit, test.hard))
+        {
+            std::cout << " ##### FAIL " << test.remaining << " s left, " << test.movesToGo << " to go, " << test.legalMoves << " moves: soft " << manager.softLimit << " hard " << manager.hardLimit
+                      << ", expected " << test.soft << " and " << test.hard << " ##### \n";
+            failures++;
+        }
+    }
+    
+    // no time for a second depth
+    {
+        total++;
+        TimeControl clock;
+        clock.set(60, 0, 0);
+        TimeManager manager;
+        manager.start(clock, 1);
+        if (manager.nextDepth("e2e4", 0, true))
+        {
+            std::cout << " ##### FAIL a second depth with a soft limit of 0 ##### \n";
+            failures++;
+        }
+    }
+    
+    // a stable best move halves the soft limit, a score drop doubles it for the rest of the move, from the mover's side
+    {
+        total++;
+        TimeControl clock;
+        clock.set(3000, 0, 0);
+        TimeManager manager;
+        manager.start(clock, 20);
+        bool deepens = true;
+        std::string scales;
+        for (int depth = 0; depth <= TIME_STABLE_DEPTHS; depth++)
+        {
+            deepens = deepens && manager.nextDepth("e2e4", 0.1, true);
+            scales += std::to_string(manager.scale) + " ";
+        }
+        double stable = manager.scale;
+        deepens = deepens && manager.nextDepth("d2d4", 0.1 - 2*TIME_SCORE_DROP, true);
+        double dropped = manager.scale;
+        deepens = deepens && manager.nextDepth("d2d4", 1, true);
+        double recovered = manager.scale;
+        if (!deepens || !near(stable, TIME_STABLE_SCALE) || !near(dropped, TIME_DROP_SCALE) || !near(recovered, TIME_DROP_SCALE))
+        {
+            std::cout << " ##### FAIL scales " << scales << "then " << dropped << " and " << recovered << (deepens ? "" : ", stopped early") << " ##### \n";
+            failures++;
+        }
+        
+        total++;
+        TimeManager black;
+        black.start(clock, 20);
+        black.nextDepth("e7e5", -0.1, false);
+        black.nextDepth("e7e5", -0.1 + 2*TIME_SCORE_DROP, false); // better for white, worse for black
+        if (!near(black.scale, TIME_DROP_SCALE))
+        {
+            std::cout << " ##### FAIL black's score drop scaled by " << black.scale << " ##### \n";
+            failures++;
+        }
+    }
+    
+    // increments, periods and the flag
+    {
+        total++;
+        TimeControl clock;
+        clock.set(60, 2, 2);
+        clock.moveMade(10);
+        double first = clock.remaining;
+        clock.moveMade(10);
+        double second = clock.remaining;
+        int movesToGo = clock.movesToGo;
+        clock.moveMade(200);
+        if (!near(first, 52) || !near(second, 104) || movesToGo != 2 || clock.remaining >= 0)
+        {
+            std::cout << " ##### FAIL clock " << first << ", " << second << " (" << movesToGo << " to go), " << clock.remaining << " ##### \n";
+            failures++;
+        }
+    }
+    
+    std::cout << total-failures << "/" << total << " time checks passed\n";
+    return (failures == 0 ? 0 : 1);
+}
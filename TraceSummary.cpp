@@ -0,0 +1,211 @@
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+
+/*
+ * tracesum - summarizes a search trace written with chengine --trace
+ * 
+ * Usage: tracesum FILE [--top N] [--search ID]
+ * 
+ * Prints totals for the whole file, then the N slowest searches (default 5) or just search ID, each with its nodes per ply, branching factors and the root moves whose subtrees took the most nodes
+ */
+
+typedef std::map<std::string, std::string> Record;
+
+struct PlyRecord
+{
+    int ply;
+    long parents;
+    long children;
+    long maxChildren;
+};
+
+struct RootRecord
+{
+    std::string move;
+    long nodes;
+    double evaluation;
+};
+
+struct SearchRecord
+{
+    long id;
+    std::string fen;
+    std::string best;
+    double evaluation;
+    long nodes;
+    int depth;
+    double ms;
+    std::vector<PlyRecord> plies;
+    std::vector<RootRecord> roots;
+};
+
+// reads one flat JSON object, values are kept as text with quotes stripped
+static bool parseRecord(const std::string &_line, Record &_record)
+{
+    _record.clear();
+    size_t i = _line.find('{');
+    if (i == std::string::npos) { return false; }
+    i++;
+    while (i < _line.size())
+    {
+        size_t keyStart = _line.find('"', i);
+        if (keyStart == std::string::npos) { break; }
+        size_t keyEnd = _line.find('"', keyStart+1);
+        size_t colon = (keyEnd == std::string::npos ? std::string::npos : _line.find(':', keyEnd));
+        if (colon == std::string::npos) { return false; }
+        std::string key = _line.substr(keyStart+1, keyEnd-keyStart-1);
+        
+        size_t valueStart = colon+1;
+        std::string value;
+        if (valueStart < _line.size() && _line[valueStart] == '"')
+        {
+            size_t valueEnd = valueStart+1;
+            while (valueEnd < _line.size() && _line[valueEnd] != '"') { valueEnd += (_line[valueEnd] == '\\' ? 2:1); }
+            value = _line.substr(valueStart+1, valueEnd-valueStart-1);
+            i = valueEnd+1;
+        }
+        else
+        {
+            size_t valueEnd = _line.find_first_of(",}", valueStart);
+            if (valueEnd == std::string::npos) { return false; }
+            value = _line.substr(valueStart, valueEnd-valueStart);
+            i = valueEnd;
+        }
+        _record[key] = value;
+        i = _line.find_first_of(",}", i);
+        if (i == std::string::npos || _line[i] == '}') { break; }
+        i++;
+    }
+    return _record.count("type") != 0;
+}
+
+static long asLong(Record &_record, const std::string &_key) { return std::atol(_record[_key].c_str()); }
+
+static double asDouble(Record &_record, const std::string &_key) { return std::atof(_record[_key].c_str()); }
+
+static void printSearch(const SearchRecord &_search)
+{
+    std::cout << "\nsearch " << _search.id << ": " << _search.ms << " ms, " << _search.nodes << " nodes, depth " << _search.depth
+              << ", best " << _search.best << " (" << _search.evaluation << ")\n";
+    std::cout << "  " << _search.fen << '\n';
+    
+    std::cout << "  ply    parents   children  branching  max\n";
+    for (const PlyRecord &ply : _search.plies)
+    {
+        std::cout << "  " << std::setw(3) << ply.ply << std::setw(11) << ply.parents << std::setw(11) << ply.children
+                  << std::setw(11) << std::fixed << std::setprecision(2) << (ply.parents > 0 ? (double)ply.children/ply.parents : 0.0)
+                  << std::setw(5) << ply.maxChildren << '\n';
+        std::cout << std::defaultfloat << std::setprecision(6);
+    }
+    
+    std::vector<RootRecord> roots = _search.roots;
+    std::sort(roots.begin(), roots.end(), [](const RootRecord &_a, const RootRecord &_b) { return _a.nodes > _b.nodes; });
+    std::cout << "  heaviest root moves:\n";
+    for (int i = 0; i < (int)roots.size() && i < 5; i++)
+    {
+        double share = (_search.nodes > 0 ? 100.0*roots[i].nodes/_search.nodes : 0.0);
+        std::cout << "    " << std::setw(6) << roots[i].move << std::setw(11) << roots[i].nodes << " nodes " << std::setw(6) << std::fixed << std::setprecision(1) << share << "%"
+                  << std::defaultfloat << std::setprecision(6) << "  eval " << roots[i].evaluation << '\n';
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::cout << "Usage: tracesum FILE [--top N] [--search ID]\n";
+        return 1;
+    }
+    
+    int top = 5;
+    long onlySearch = -1;
+    for (int i = 2; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--top" && i+1 < argc) { top = std::atoi(argv[++i]); }
+        else if (arg == "--search" && i+1 < argc) { onlySearch = std::atol(argv[++i]); }
+        else
+        {
+            std::cout << "Unknown option " << arg << '\n';
+            return 1;
+        }
+    }
+    
+    std::ifstream input(argv[1]);
+    if (!input)
+    {
+        std::cout << "Couldn't open " << argv[1] << '\n';
+        return 1;
+    }
+    
+    std::map<long, SearchRecord> searches;
+    long levels = 0;
+    long budgetLevels = 0;
+    long badLines = 0;
+    std::string line;
+    Record record;
+    while (std::getline(input, line))
+    {
+        if (line.empty()) { continue; }
+        if (!parseRecord(line, record)) { badLines++; continue; }
+        
+        std::string type = record["type"];
+        SearchRecord &search = searches[asLong(record, "search")];
+        if (type == "level")
+        {
+            levels++;
+            if (record["budget_reached"] == "true") { budgetLevels++; }
+        }
+        else if (type == "ply") { search.plies.push_back(PlyRecord{(int)asLong(record, "ply"), asLong(record, "parents"), asLong(record, "children"), asLong(record, "max_children")}); }
+        else if (type == "root") { search.roots.push_back(RootRecord{record["move"], asLong(record, "nodes"), asDouble(record, "evaluation")}); }
+        else if (type == "search")
+        {
+            search.id = asLong(record, "search");
+            search.fen = record["fen"];
+            search.best = record["best"];
+            search.evaluation = asDouble(record, "evaluation");
+            search.nodes = asLong(record, "nodes");
+            search.depth = (int)asLong(record, "depth");
+            search.ms = asDouble(record, "ms");
+        }
+    }
+    
+    // searches cut off by a crash never wrote their summary line
+    std::vector<SearchRecord> finished;
+    double totalMs = 0;
+    long totalNodes = 0;
+    for (auto &entry : searches)
+    {
+        if (entry.second.fen.empty()) { continue; }
+        finished.push_back(entry.second);
+        totalMs += entry.second.ms;
+        totalNodes += entry.second.nodes;
+    }
+    
+    std::cout << finished.size() << " searches, " << levels << " levels generated (" << budgetLevels << " hit the node budget), "
+              << totalMs << " ms, " << totalNodes << " nodes";
+    if (totalMs > 0) { std::cout << ", " << (long)(totalNodes/(totalMs*1e-3)) << " nodes/s"; }
+    std::cout << '\n';
+    if (badLines > 0) { std::cout << badLines << " unreadable lines skipped\n"; }
+    
+    if (onlySearch != -1)
+    {
+        for (const SearchRecord &search : finished)
+        {
+            if (search.id == onlySearch) { printSearch(search); return 0; }
+        }
+        std::cout << "No finished search " << onlySearch << '\n';
+        return 1;
+    }
+    
+    std::sort(finished.begin(), finished.end(), [](const SearchRecord &_a, const SearchRecord &_b) { return _a.ms > _b.ms; });
+    for (int i = 0; i < (int)finished.size() && i < top; i++) { printSearch(finished[i]); }
+    
+    return 0;
+}
@@ -0,0 +1,135 @@
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <memory>
+
+#include "TranspositionTable.hpp"
+
+// data layout: score (float bits) 0-31, depth 32-39, bound 40-41, session 42-49, generation 50-57
+static uint64_t pack(float _score, int _depth, TTBound _bound, int _session, uint8_t _generation)
+{
+    uint32_t scoreBits;
+    std::memcpy(&scoreBits, &_score, sizeof(scoreBits));
+    return (uint64_t)scoreBits | ((uint64_t)(_depth & 0xFF) << 32) | ((uint64_t)_bound << 40) | ((uint64_t)(_session & 0xFF) << 42) | ((uint64_t)_generation << 50);
+}
+
+static int depthOf(uint64_t _data) { return (int)((_data >> 32) & 0xFF); }
+
+static int sessionOf(uint64_t _data) { return (int)((_data >> 42) & 0xFF); }
+
+static uint8_t generationOf(uint64_t _data) { return (uint8_t)((_data >> 50) & 0xFF); }
+
+const uint64_t MOVE_BITS = 0xFFFF; // of the check word
+
+static bool matches(uint64_t _check, uint64_t _data, uint64_t _key) { return ((_check ^ _data) & ~MOVE_BITS) == (_key & ~MOVE_BITS); }
+
+TranspositionTable::TranspositionTable(long _megabytes)
+{
+    long wanted = (_megabytes > 0 ? _megabytes : 1)*1024*1024 / (long)(sizeof(Entry)*TT_BUCKET);
+    buckets = 1;
+    while (buckets*2 <= wanted) { buckets *= 2; }
+    table.reset(new Entry[buckets*TT_BUCKET]);
+    for (int i = 0; i <= TT_MAX_SESSIONS; i++)
+    {
+        generations[i] = 0;
+        open[i] = false;
+    }
+    open[0] = true; // NOTE searches without a session, never closed
+    clear();
+}
+
+int TranspositionTable::openSession()
+{
+    for (int i = 1; i <= TT_MAX_SESSIONS; i++)
+    {
+        bool closed = false;
+        if (open[i].compare_exchange_strong(closed, true))
+        {
+            generations[i]++; // NOTE whatever a previous session with this tag left behind stays stale
+            return i;
+        }
+    }
+    return -1;
+}
+
+void TranspositionTable::closeSession(int _session)
+{
+    if (_session <= 0 || _session > TT_MAX_SESSIONS) { return; }
+    generations[_session]++;
+    open[_session] = false;
+}
+
+void TranspositionTable::newSearch(int _session)
+{
+    if (_session >= 0 && _session <= TT_MAX_SESSIONS) { generations[_session]++; }
+}
+
+bool TranspositionTable::current(uint64_t _data) const
+{
+    int session = sessionOf(_data);
+    return (open[session].load(std::memory_order_relaxed) && generations[session].load(std::memory_order_relaxed) == generationOf(_data));
+}
+
+bool TranspositionTable::probe(uint64_t _key, TTData &_data) const
+{
+    Entry* bucket = &table[(_key & (uint64_t)(buckets-1)) * TT_BUCKET];
+    for (int i = 0; i < TT_BUCKET; i++)
+    {
+        uint64_t data = bucket[i].data.load(std::memory_order_relaxed);
+        uint64_t check = bucket[i].check.load(std::memory_order_relaxed);
+        if (!matches(check, data, _key) || data == 0) { continue; }
+        
+        uint32_t scoreBits = (uint32_t)data;
+        std::memcpy(&_data.score, &scoreBits, sizeof(scoreBits));
+        _data.depth = depthOf(data);
+        _data.bound = (TTBound)((data >> 40) & 3);
+        _data.move = (uint16_t)((check ^ data) & MOVE_BITS);
+        return true;
+    }
+    return false;
+}
+
+void TranspositionTable::store(uint64_t _key, int _session, int _depth, float _score, TTBound _bound, uint16_t _move)
+{
+    Entry* bucket = &table[(_key & (uint64_t)(buckets-1)) * TT_BUCKET];
+    
+    // the same position, then an empty or stale entry, then the shallowest
+    Entry* victim = nullptr;
+    int victimWorth = 0;
+    for (int i = 0; i < TT_BUCKET; i++)
+    {
+        uint64_t data = bucket[i].data.load(std::memory_order_relaxed);
+        uint64_t check = bucket[i].check.load(std::memory_order_relaxed);
+        if (data != 0 && matches(check, data, _key))
+        {
+            if (current(data) && depthOf(data) > _depth && _bound != TTBound::EXACT) { return; } // NOTE a deeper result of this search is worth more than a shallower bound
+            if (_move == 0) { _move = (uint16_t)((check ^ data) & MOVE_BITS); }
+            victim = &bucket[i];
+            break;
+        }
+        int worth = (data == 0 || !current(data) ? -1 : depthOf(data));
+        if (victim == nullptr || worth < victimWorth)
+        {
+            victim = &bucket[i];
+            victimWorth = worth;
+        }
+    }
+    
+    uint64_t data = pack(_score, _depth, _bound, _session, generations[_session].load(std::memory_order_relaxed));
+    victim->data.store(data, std::memory_order_relaxed);
+    victim->check.store(((_key & ~MOVE_BITS) | _move) ^ data, std::memory_order_relaxed);
+}
+
+void TranspositionTable::clear()
+{
+    for (long i = 0; i < buckets*TT_BUCKET; i++)
+    {
+        table[i].check.store(0, std::memory_order_relaxed);
+        table[i].data.store(0, std::memory_order_relaxed);
+    }
+}
+
+long TranspositionTable::size() const
+{
+    return buckets*TT_BUCKET;
+}
@@ -0,0 +1,71 @@
+#ifndef TRANSPOSITIONTABLE_HPP
+#define TRANSPOSITIONTABLE_HPP
+
+#include <cstdint>
+#include <atomic>
+#include <memory>
+
+/* Transposition table, scores of depth-first search nodes shared by any number of StateTrees and threads
+ *
+ * Keyed by GameState::positionKey. Every entry is two 64-bit words written and read without locks, the key stored XORed with the data, so an entry torn by
+ * two threads writing at once no longer matches its key and is simply a miss. The low 16 bits of the key word carry the move instead, those bits of the
+ * key mostly went into picking the bucket anyway.
+ *
+ * Entries carry the session (a game, see Server.hpp) whose search stored them and that session's generation at the time. newSearch() moves a session
+ * to its next generation and closeSession() retires it, either way its older entries are the first to go when a bucket fills up, ahead of the shallowest
+ * entries of searches still running. Scores are white-relative bounds, mates counted from the node and not from the root.
+ *
+ * NOTE searches with different SearchOptions or evaluations shouldn't share a table, their scores aren't comparable
+*/
+
+const long TT_DEFAULT_MB = 64;
+const int TT_BUCKET = 4; // entries a key may go to
+const int TT_MAX_SESSIONS = 255; // session tags are 8 bits, 0 is for searches without a session
+
+enum struct TTBound : int {EXACT, LOWER, UPPER}; // LOWER means the score is at least the stored one
+
+struct TTData
+{
+    float score;
+    int depth;
+    TTBound bound;
+    uint16_t move; // the best or refuting move, see ttMove(), 0 if the search had none (every move failed low)
+};
+
+inline uint16_t ttMove(int _x1, int _y1, int _x2, int _y2) { return (uint16_t)((8*_y1+_x1) | (8*_y2+_x2) << 6); } // from square in bits 0-5, to square in 6-11, NOTE never 0 as from and to differ
+
+class TranspositionTable
+{
+public:
+    TranspositionTable(long _megabytes); // rounded down to a power of two buckets
+    
+    int openSession(); // a free session tag, -1 if all TT_MAX_SESSIONS are in use
+    
+    void closeSession(int _session);
+    
+    void newSearch(int _session); // the session's entries so far become replaceable
+    
+    bool probe(uint64_t _key, TTData &_data) const; // NOTE hits are counted by the caller, a shared counter would have every thread writing the same cache line
+    
+    void store(uint64_t _key, int _session, int _depth, float _score, TTBound _bound, uint16_t _move); // NOTE a _move of 0 keeps the move already stored for _key
+    
+    void clear();
+    
+    long size() const; // entries
+
+private:
+    struct Entry
+    {
+        std::atomic<uint64_t> check; // (key with the move in its low 16 bits) ^ data
+        std::atomic<uint64_t> data;
+    };
+    
+    bool current(uint64_t _data) const; // the entry is from its session's running generation
+    
+    std::unique_ptr<Entry[]> table;
+    long buckets;
+    std::atomic<uint8_t> generations[TT_MAX_SESSIONS+1];
+    std::atomic<bool> open[TT_MAX_SESSIONS+1];
+};
+
+#endif
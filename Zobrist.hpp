@@ -0,0 +1,40 @@
+#ifndef ZOBRIST_HPP
+#define ZOBRIST_HPP
+
+#include <cstdint>
+#include <string>
+
+#include "StateTree.hpp"
+
+/* NOTE Keys follow the Polyglot layout so that the same hash can be used to probe opening books:
+ * 
+ * 0   - 767 : piece on square, index 64*kind + 8*rank + file where kind is (black pawn, white pawn, black knight, white knight, ... black king, white king)
+ * 768 - 771 : castling rights, white kingside, white queenside, black kingside, black queenside
+ * 772 - 779 : en passant file, only when a pawn of the side to move can actually capture
+ * 780       : white to move
+ * 
+ * The built-in keys are Polyglot's Random64 table so standard .bin books hit without any setup, loadZobristKeys() can replace them with another table.
+*/
+
+const int ZOBRIST_KEYS = 781;
+const int ZOBRIST_CASTLE = 768;
+const int ZOBRIST_EN_PASSANT = 772;
+const int ZOBRIST_TURN = 780;
+
+const uint64_t POLYGLOT_START_KEY = 0x463b96181691fc9cULL; // key of the starting position with Polyglot's Random64 table
+
+extern uint64_t zobristKeys[ZOBRIST_KEYS];
+
+bool loadZobristKeys(const std::string &_path); // reads 781 "0x..." values to use instead of the built-in table, returns false and keeps the current keys if the file is unusable
+
+int zobristPieceKind(PieceType _piece); // Polyglot piece kind (0-11), -1 for EMPTY
+
+uint64_t zobristKey(const GameState* _gs); // full key of a GameState, computed from scratch
+
+uint64_t zobristSquareKey(PieceType _piece, int _x, int _y); // key of one piece on one square, 0 for EMPTY
+
+uint64_t zobristBoardKey(const GameState* _gs); // key of the piece placement alone, no castling, en passant or side to move (see GameState::boardKey)
+
+uint64_t zobristStateKey(const GameState* _gs); // the rest of the full key, castling, en passant and side to move, so that zobristKey() is zobristBoardKey() ^ zobristStateKey()
+
+#endif